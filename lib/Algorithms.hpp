@@ -6,6 +6,10 @@
 #include <cmath>
 #include <cstdint>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 
 // Return a sorted list with increasing order
 template<typename T>
@@ -100,6 +104,74 @@ inline T incremented ( T x )
 }
 
 
+// Return the index of the first element in a that is different from b, or n if they are all equal
+template<typename T>
+inline size_t firstMismatch ( const T *a, const T *b, size_t n )
+{
+    return std::mismatch ( a, a + n, b ).first - a;
+}
+
+// Return the index of the first element in a that is different from value, or n if they are all equal
+template<typename T>
+inline size_t firstNotEqual ( const T *a, T value, size_t n )
+{
+    return std::find_if ( a, a + n, [value] ( T x ) { return x != value; } ) - a;
+}
+
+#ifdef __SSE2__
+
+// Compare 16 uint16_t per iteration, then find the first mismatch in the bit mask of the mismatched bytes
+inline size_t firstMismatchSse2 ( const uint16_t *a, const uint16_t *b, const __m128i *value, size_t n )
+{
+    size_t i = 0;
+
+    for ( ; i + 16 <= n; i += 16 )
+    {
+        const __m128i b0 = ( value ? *value : _mm_loadu_si128 ( ( const __m128i * ) ( b + i ) ) );
+        const __m128i b1 = ( value ? *value : _mm_loadu_si128 ( ( const __m128i * ) ( b + i + 8 ) ) );
+
+        const __m128i eq0 = _mm_cmpeq_epi16 ( _mm_loadu_si128 ( ( const __m128i * ) ( a + i ) ), b0 );
+        const __m128i eq1 = _mm_cmpeq_epi16 ( _mm_loadu_si128 ( ( const __m128i * ) ( a + i + 8 ) ), b1 );
+
+        const uint32_t mask = ~ ( _mm_movemask_epi8 ( eq0 ) | ( _mm_movemask_epi8 ( eq1 ) << 16 ) );
+
+        if ( mask )
+            return i + __builtin_ctz ( mask ) / 2;
+    }
+
+    for ( ; i + 8 <= n; i += 8 )
+    {
+        const __m128i b0 = ( value ? *value : _mm_loadu_si128 ( ( const __m128i * ) ( b + i ) ) );
+
+        const __m128i eq0 = _mm_cmpeq_epi16 ( _mm_loadu_si128 ( ( const __m128i * ) ( a + i ) ), b0 );
+
+        const uint32_t mask = ~_mm_movemask_epi8 ( eq0 ) & 0xFFFF;
+
+        if ( mask )
+            return i + __builtin_ctz ( mask ) / 2;
+    }
+
+    for ( ; i < n; ++i )
+        if ( a[i] != ( value ? b[0] : b[i] ) )
+            return i;
+
+    return n;
+}
+
+inline size_t firstMismatch ( const uint16_t *a, const uint16_t *b, size_t n )
+{
+    return firstMismatchSse2 ( a, b, 0, n );
+}
+
+inline size_t firstNotEqual ( const uint16_t *a, uint16_t value, size_t n )
+{
+    const __m128i values = _mm_set1_epi16 ( value );
+    return firstMismatchSse2 ( a, &value, &values, n );
+}
+
+#endif // __SSE2__
+
+
 // Hash hash_combine function
 namespace std
 {
@@ -3,6 +3,7 @@
 #include "Constants.hpp"
 #include "Exceptions.hpp"
 #include "ErrorStrings.hpp"
+#include "TimerManager.hpp"
 
 #include <windows.h>
 
@@ -185,7 +186,9 @@ void Controller::joystickAxisEvent ( uint8_t axis, uint8_t value )
     if ( value != AXIS_CENTERED )
         _state |= keyMapped;
 
-    LOG_CONTROLLER ( this, "value=%c", getAxisSign ( value ) );
+    _stateTime = TimerManager::queryNowUs();
+
+    LOG_CONTROLLER_AT ( DEBUG, this, "value=%c", getAxisSign ( value ) );
 }
 
 void Controller::joystickHatEvent ( uint8_t hat, uint8_t value )
@@ -255,7 +258,9 @@ void Controller::joystickHatEvent ( uint8_t hat, uint8_t value )
     if ( value != 5 )
         _state |= keyMapped;
 
-    LOG_CONTROLLER ( this, "value=%u", value );
+    _stateTime = TimerManager::queryNowUs();
+
+    LOG_CONTROLLER_AT ( DEBUG, this, "value=%u", value );
 }
 
 void Controller::joystickButtonEvent ( uint8_t button, uint8_t value )
@@ -311,7 +316,9 @@ void Controller::joystickButtonEvent ( uint8_t button, uint8_t value )
     else
         _state &= ~keyMapped;
 
-    LOG_CONTROLLER ( this, "button=%d; value=%d", button, value );
+    _stateTime = TimerManager::queryNowUs();
+
+    LOG_CONTROLLER_AT ( DEBUG, this, "button=%d; value=%d", button, value );
 }
 
 static unordered_set<string> namesWithIndex;
@@ -15,6 +15,10 @@
     LOG ( "%s: controller=%08x; state=%08x; " FORMAT,                                                           \
           CONTROLLER->getName(), CONTROLLER, CONTROLLER->_state, ## __VA_ARGS__ )
 
+#define LOG_CONTROLLER_AT(LEVEL, CONTROLLER, FORMAT, ...)                                                       \
+    LOG_AT ( Input, LEVEL, "%s: controller=%08x; state=%08x; " FORMAT,                                          \
+             CONTROLLER->getName(), CONTROLLER, CONTROLLER->_state, ## __VA_ARGS__ )
+
 
 #define BIT_UP              ( 0x00000001u )
 #define BIT_DOWN            ( 0x00000002u )
@@ -247,6 +251,10 @@ public:
     uint32_t getPrevState() const { return _prevState; }
     uint32_t getState() const { return _state; }
 
+    // Get the time of the last state change in microseconds, 0 if unknown.
+    // This is written when polling, so it must be read with ControllerManager::mutex held.
+    uint64_t getStateTime() const { return _stateTime; }
+
     // Indicates if this is a keyboard / joystick controller
     bool isKeyboard() const { return ( _joystick.info.device == 0 ); }
     bool isJoystick() const { return ( _joystick.info.device != 0 ); }
@@ -272,6 +280,9 @@ private:
     // Controller states
     uint32_t _prevState = 0, _state = 0;
 
+    // Time of the last state change in microseconds
+    uint64_t _stateTime = 0;
+
     // Keyboard mappings
     KeyboardMappings _keyboardMappings;
 
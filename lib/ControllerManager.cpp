@@ -1,6 +1,7 @@
 #include "ControllerManager.hpp"
 #include "Exceptions.hpp"
 #include "ErrorStrings.hpp"
+#include "TimerManager.hpp"
 
 #define INITGUID
 #define DIRECTINPUT_VERSION 0x0800 // Need at least version 8
@@ -114,6 +115,7 @@ bool ControllerManager::check()
     if ( windowHandle == ( void * ) GetForegroundWindow() )
     {
         // Update keyboard controller state
+        const uint32_t prevState = keyboard._state;
         keyboard._state = 0;
 
         for ( uint8_t i = 0; i < 32; ++i )
@@ -124,6 +126,10 @@ bool ControllerManager::check()
             if ( GetKeyState ( keyboard._keyboardMappings.codes[i] ) & 0x80 )
                 keyboard._state |= ( 1u << i );
         }
+
+        // Keyboards have no events, so the state changed when it was first seen here
+        if ( keyboard._state != prevState )
+            keyboard._stateTime = TimerManager::queryNowUs();
     }
 
     DIJOYSTATE2 djs;
@@ -240,6 +246,9 @@ bool ControllerManager::check()
         ++it;
     }
 
+    if ( owner )
+        owner->controllersPolled();
+
     return true;
 }
 
@@ -28,6 +28,9 @@ public:
         virtual void joystickAttached ( Controller *controller ) = 0;
 
         virtual void joystickToBeDetached ( Controller *controller ) = 0;
+
+        // Called after each check for controller events, while the mutex is held
+        virtual void controllersPolled() {}
     };
 
     Owner *owner = 0;
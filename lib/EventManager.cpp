@@ -27,12 +27,13 @@ void EventManager::checkEvents ( uint64_t timeout )
     if ( ! _running )
         return;
 
-    if ( TimerManager::get().getNextExpiry() != UINT64_MAX )
+    if ( TimerManager::get().getNextExpiryUs() != UINT64_MAX )
     {
         uint64_t newTimeout = 1;
 
-        if ( TimerManager::get().getNextExpiry() > TimerManager::get().getNow() )
-            newTimeout = TimerManager::get().getNextExpiry() - TimerManager::get().getNow();
+        // Round up to whole milliseconds for select, so it doesn't return just before the timer expires
+        if ( TimerManager::get().getNextExpiryUs() > TimerManager::get().getNowUs() )
+            newTimeout = ( TimerManager::get().getNextExpiryUs() - TimerManager::get().getNowUs() + 999 ) / 1000;
 
         if ( newTimeout < timeout )
             timeout = newTimeout;
@@ -0,0 +1,72 @@
+#include "FramePacer.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+
+void FramePacer::setFps ( double fps )
+{
+    if ( fps <= 0 || ! std::isfinite ( fps ) || fps >= 1e6 )
+        _period = 0;
+    else
+        _period = 1e6 / fps;
+}
+
+void FramePacer::wait()
+{
+    uint64_t now = _clock.getNow();
+
+    _lastInterval = 0;
+    _lastJitter = 0;
+
+    if ( _period == 0 )
+    {
+        _last = now;
+        return;
+    }
+
+    // Start a new schedule on the first frame, or if too far behind to catch up without running fast
+    if ( _last == 0 || now > _deadline + FRAME_PACER_MAX_BEHIND * _period )
+    {
+        _deadline = now;
+        _last = now;
+        return;
+    }
+
+    _deadline += _period;
+
+    const uint64_t deadline = uint64_t ( ceil ( _deadline ) );
+
+    // Coarse sleep until shortly before the deadline
+    if ( now + _spinMargin < deadline )
+    {
+        const uint64_t target = deadline - _spinMargin;
+
+        _clock.sleep ( target - now );
+        now = _clock.getNow();
+
+        updateSpinMargin ( int64_t ( now ) - int64_t ( target ) );
+    }
+
+    // Spin the rest of the way
+    while ( now < deadline )
+        now = _clock.getNow();
+
+    _lastInterval = now - _last;
+    _lastJitter = int64_t ( now ) - int64_t ( deadline );
+
+    _last = now;
+}
+
+void FramePacer::updateSpinMargin ( int64_t oversleep )
+{
+    // Grow quickly when a sleep woke up late, then shrink slowly, like a peak detector
+    const int64_t needed = max<int64_t> ( oversleep, 0 ) + FRAME_PACER_SPIN_MARGIN / 4;
+
+    if ( needed > int64_t ( _spinMargin ) )
+        _spinMargin = min<uint64_t> ( needed, FRAME_PACER_MAX_SPIN_MARGIN );
+    else
+        _spinMargin -= ( _spinMargin - needed ) / 64;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+
+
+// Initial margin before each deadline to spin instead of sleep, in microseconds
+#define FRAME_PACER_SPIN_MARGIN     ( 2000 )
+
+// Maximum spin margin, so a very late sleep can't turn the pacer back into a busy-wait
+#define FRAME_PACER_MAX_SPIN_MARGIN ( 4000 )
+
+// Number of frames behind schedule before the schedule restarts, instead of running fast to catch up
+#define FRAME_PACER_MAX_BEHIND      ( 3 )
+
+
+// Paces frames against an absolute schedule of deadlines, so timing errors don't accumulate into drift.
+//
+// Each wait sleeps until shortly before the deadline, then spins the rest of the way. The spin margin adapts to
+// how late the OS wakes up from a sleep, so the pacer spins as little as possible while still hitting the deadline.
+// The clock is injectable, so the pacing can be unit tested and benchmarked outside the game.
+class FramePacer
+{
+public:
+
+    struct Clock
+    {
+        // Get the current monotonic time in microseconds
+        virtual uint64_t getNow() = 0;
+
+        // Sleep for at least the given number of microseconds, this may sleep longer
+        virtual void sleep ( uint64_t microseconds ) = 0;
+    };
+
+    FramePacer ( Clock& clock ) : _clock ( clock ) {}
+
+    // Set the target FPS, applies from the next frame. Zero or infinite FPS disables waiting.
+    void setFps ( double fps );
+
+    // Wait until the next frame deadline
+    void wait();
+
+    // Interval since the previous frame, and how far this frame ended after its deadline, in microseconds.
+    // Both are zero if the last wait didn't pace the frame, ie the first frame or a restarted schedule.
+    uint64_t getLastInterval() const { return _lastInterval; }
+    int64_t getLastJitter() const { return _lastJitter; }
+
+    // Current spin margin in microseconds
+    uint64_t getSpinMargin() const { return _spinMargin; }
+
+private:
+
+    Clock& _clock;
+
+    // Frame period in microseconds, zero to not wait
+    double _period = 1e6 / 60;
+
+    // Absolute time of the next deadline, fractional to avoid drift from rounding the period
+    double _deadline = 0;
+
+    // Time the last wait returned, zero before the first frame
+    uint64_t _last = 0;
+
+    uint64_t _spinMargin = FRAME_PACER_SPIN_MARGIN;
+
+    uint64_t _lastInterval = 0;
+
+    int64_t _lastJitter = 0;
+
+    // Adapt the spin margin to how late a sleep woke up
+    void updateSpinMargin ( int64_t oversleep );
+};
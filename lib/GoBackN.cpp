@@ -46,8 +46,8 @@ void GoBackN::timerExpired ( Timer *timer )
 
         const MsgPtr& msg = *_sendListPos;
 
-        LOG ( "Sending '%s'; sequence=%u; sendSequence=%d",
-              msg, msg->getAs<SerializableSequence>().getSequence(), _sendSequence );
+        LOG_AT ( GoBackN, DEBUG, "Sending '%s'; sequence=%u; sendSequence=%d",
+                 msg, msg->getAs<SerializableSequence>().getSequence(), _sendSequence );
 
         owner->goBackNSendRaw ( this, msg );
         ++_sendListPos;
@@ -55,7 +55,7 @@ void GoBackN::timerExpired ( Timer *timer )
 
     if ( _keepAlive )
     {
-        LOG ( "this=%08x; keepAlive=%llu; countDown=%d", this, _keepAlive, _countDown );
+        LOG_AT ( GoBackN, DEBUG, "this=%08x; keepAlive=%llu; countDown=%d", this, _keepAlive, _countDown );
 
         if ( _countDown )
         {
@@ -63,7 +63,7 @@ void GoBackN::timerExpired ( Timer *timer )
         }
         else
         {
-            LOG ( "owner->goBackNTimeout ( this=%08x ); owner=%08x", this, owner );
+            LOG_AT ( GoBackN, INFO, "owner->goBackNTimeout ( this=%08x ); owner=%08x", this, owner );
             owner->goBackNTimeout ( this );
             return;
         }
@@ -89,7 +89,7 @@ void GoBackN::sendViaGoBackN ( SerializableSequence *message )
 
 void GoBackN::sendViaGoBackN ( const MsgPtr& msg )
 {
-    LOG ( "Adding '%s'; sendSequence=%d", msg, _sendSequence + 1 );
+    LOG_AT ( GoBackN, DEBUG, "Adding '%s'; sendSequence=%d", msg, _sendSequence + 1 );
 
     ASSERT ( msg->getBaseType() == BaseType::SerializableSequence );
     ASSERT ( _sendList.empty() || _sendList.back()->getAs<SerializableSequence>().getSequence() == _sendSequence );
@@ -143,7 +143,7 @@ void GoBackN::recvFromSocket ( const MsgPtr& msg )
     {
         refreshKeepAlive();
 
-        LOG ( "this=%08x; keepAlive=%llu; countDown=%d", this, _keepAlive, _countDown );
+        LOG_AT ( GoBackN, DEBUG, "this=%08x; keepAlive=%llu; countDown=%d", this, _keepAlive, _countDown );
 
         checkAndStartTimer();
     }
@@ -155,7 +155,7 @@ void GoBackN::recvFromSocket ( const MsgPtr& msg )
     // Filter non-sequential messages
     if ( msg->getBaseType() != BaseType::SerializableSequence )
     {
-        LOG ( "Received '%s'", msg );
+        LOG_AT ( GoBackN, DEBUG, "Received '%s'", msg );
         owner->goBackNRecvRaw ( this, msg );
         return;
     }
@@ -168,7 +168,7 @@ void GoBackN::recvFromSocket ( const MsgPtr& msg )
         if ( sequence > _ackSequence )
             _ackSequence = sequence;
 
-        LOG ( "Got AckSequence; sequence=%u; sendSequence=%u", sequence, _sendSequence );
+        LOG_AT ( GoBackN, DEBUG, "Got AckSequence; sequence=%u; sendSequence=%u", sequence, _sendSequence );
 
         // Remove messages from sendList with sequence <= the ACKed sequence
         while ( !_sendList.empty() && _sendList.front()->getAs<SerializableSequence>().getSequence() <= sequence )
@@ -185,7 +185,7 @@ void GoBackN::recvFromSocket ( const MsgPtr& msg )
         return;
     }
 
-    LOG ( "Received '%s'; sequence=%u; recvSequence=%u", msg, sequence, _recvSequence );
+    LOG_AT ( GoBackN, DEBUG, "Received '%s'; sequence=%u; recvSequence=%u", msg, sequence, _recvSequence );
 
     ++_recvSequence;
 
@@ -204,7 +204,8 @@ void GoBackN::recvFromSocket ( const MsgPtr& msg )
 
             if ( !msg.get() || msg->getMsgType() != splitMsg.origMsgType || consumed != _recvBuffer.size() )
             {
-                LOG ( "Failed to recreate '%s' from [ %u bytes ]", splitMsg.origMsgType, _recvBuffer.size() );
+                LOG_AT ( GoBackN, WARN, "Failed to recreate '%s' from [ %u bytes ]",
+                         splitMsg.origMsgType, _recvBuffer.size() );
                 msg.reset();
             }
 
@@ -212,7 +213,7 @@ void GoBackN::recvFromSocket ( const MsgPtr& msg )
 
             if ( msg )
             {
-                LOG ( "Recreated '%s'", msg );
+                LOG_AT ( GoBackN, DEBUG, "Recreated '%s'", msg );
                 owner->goBackNRecvMsg ( this, msg );
             }
         }
@@ -231,7 +232,7 @@ void GoBackN::setSendInterval ( uint64_t interval )
 
     refreshKeepAlive();
 
-    LOG ( "interval=%llu; countDown=%d", _interval, _countDown );
+    LOG_AT ( GoBackN, INFO, "interval=%llu; countDown=%d", _interval, _countDown );
 }
 
 void GoBackN::setKeepAlive ( uint64_t timeout )
@@ -240,12 +241,12 @@ void GoBackN::setKeepAlive ( uint64_t timeout )
 
     refreshKeepAlive();
 
-    LOG ( "keepAlive=%llu; countDown=%d", _keepAlive, _countDown );
+    LOG_AT ( GoBackN, INFO, "keepAlive=%llu; countDown=%d", _keepAlive, _countDown );
 }
 
 void GoBackN::reset()
 {
-    LOG ( "this=%08x; sendTimer=%08x", this, _sendTimer.get() );
+    LOG_AT ( GoBackN, INFO, "this=%08x; sendTimer=%08x", this, _sendTimer.get() );
 
     _sendSequence = _recvSequence = 0;
     _sendList.clear();
@@ -319,6 +320,9 @@ void GoBackN::load ( cereal::BinaryInputArchive& ar )
 
 void GoBackN::logSendList() const
 {
+    if ( ! LOG_ENABLED ( GoBackN, DEBUG ) )
+        return;
+
     LOG_LIST ( _sendList, formatSerializableSequence );
 }
 
@@ -11,6 +11,9 @@
 using namespace std;
 
 
+const IpAddrPort NullAddress;
+
+
 shared_ptr<addrinfo> getAddrInfo ( const string& addr, uint16_t port, bool isV4, bool passive )
 {
     addrinfo addrConf, *addrRes = 0;
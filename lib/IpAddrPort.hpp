@@ -94,7 +94,7 @@ private:
 };
 
 
-const IpAddrPort NullAddress;
+extern const IpAddrPort NullAddress;
 
 
 // Hash function
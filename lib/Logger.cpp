@@ -2,11 +2,15 @@
 #include "Algorithms.hpp"
 #include "TimerManager.hpp"
 
+#include <cstring>
+#include <cstdlib>
+
 using namespace std;
 
 
 #ifdef DISABLE_LOGGING
 
+Logger::~Logger() {}
 void Logger::initialize ( const string& filePath, uint32_t _options ) {}
 void Logger::deinitialize() {}
 void Logger::flush() {}
@@ -14,8 +18,47 @@ void Logger::log ( const char *srcFile, int srcLine, const char *srcFunc, const
 
 #else
 
+LogHex::LogHex ( const void *bytes, size_t length ) : length ( min<size_t> ( length, LOG_HEX_SIZE ) )
+{
+    memcpy ( this->bytes, bytes, this->length );
+}
+
+ostream& operator<< ( ostream& os, const LogHex& hex )
+{
+    return ( os << formatAsHex ( hex.bytes, hex.length ) );
+}
+
+
+// Set on the writer thread, so flushing from a message it is writing doesn't wait on itself
+static thread_local bool isWriterThread = false;
+
+
+Logger::~Logger()
+{
+    if ( ! _writerRunning )
+        return;
+
+    // The writer should be stopped by deinitialize, but at process exit it may have already been terminated,
+    // so it can't be joined. The queued messages are only written if it wasn't terminated in the middle of a write.
+    _writerRunning = false;
+
+    _writer->release();
+    _writer.release();
+
+    TryLock fileLock ( _fileMutex );
+
+    if ( ! fileLock.isLocked() )
+        return;
+
+    writeQueued();
+    fflush ( _fd );
+}
+
 void Logger::initialize ( const string& filePath, uint32_t _options )
 {
+    // Write out anything queued for the old file first
+    stopWriter();
+
 #ifdef LOGGER_MUTEXED
     LOCK ( _mutex );
 #endif
@@ -58,6 +101,9 @@ void Logger::initialize ( const string& filePath, uint32_t _options )
         _logId = generateRandomId();
 
     _initialized = true;
+
+    if ( _fd && ( _options & LOG_ASYNC ) )
+        startWriter();
 }
 
 void Logger::deinitialize()
@@ -65,6 +111,8 @@ void Logger::deinitialize()
     if ( ! _initialized )
         return;
 
+    stopWriter();
+
 #ifdef LOGGER_MUTEXED
     LOCK ( _mutex );
 #endif
@@ -82,10 +130,26 @@ void Logger::deinitialize()
 
 void Logger::flush()
 {
+    if ( _writerRunning && ! isWriterThread )
+    {
+        _flushRequested = true;
+
+        LOCK ( _writerMutex );
+
+        _writerCond.broadcast();
+
+        while ( _flushRequested && _writerRunning )
+            _writerCond.wait ( _writerMutex );
+
+        return;
+    }
+
 #ifdef LOGGER_MUTEXED
     LOCK ( _mutex );
 #endif
 
+    LOCK ( _fileMutex );
+
     fflush ( _fd );
 }
 
@@ -94,28 +158,40 @@ void Logger::log ( const char *srcFile, int srcLine, const char *srcFunc, const
     if ( ! _fd )
         return;
 
+    if ( _writerRunning )
+    {
+        const size_t size = strlen ( logMessage ) + 1;
+
+        push ( srcFile, srcLine, srcFunc, 0, 0, size, [&] ( void *data ) { memcpy ( data, logMessage, size ); } );
+        return;
+    }
+
 #ifdef LOGGER_MUTEXED
     LOCK ( _mutex );
 #endif
 
+    LOCK ( _fileMutex );
+
+    write ( srcFile, srcLine, srcFunc, ::time ( 0 ), TimerManager::queryNowUs(), logMessage );
+    fflush ( _fd );
+}
+
+void Logger::write ( const char *srcFile, int srcLine, const char *srcFunc, time_t wallTime, uint64_t time,
+                     const char *logMessage )
+{
     bool hasPrefix = false;
 
     if ( _options & ( LOG_GM_TIME | LOG_LOCAL_TIME ) )
     {
-        time_t t;
-        time ( &t );
-
         tm *ts;
         if ( _options & LOG_GM_TIME )
-            ts = gmtime ( &t );
+            ts = gmtime ( &wallTime );
         else
-            ts = localtime ( &t );
+            ts = localtime ( &wallTime );
 
         strftime ( _buffer, sizeof ( _buffer ), "%H:%M:%S", ts );
 
-        const uint64_t now = TimerManager::get().getNow ( true );
-
-        fprintf ( _fd, "%s.%03u:", _buffer, ( uint32_t ) ( now % 1000 ) );
+        fprintf ( _fd, "%s.%03u:", _buffer, ( uint32_t ) ( ( time / 1000 ) % 1000 ) );
         hasPrefix = true;
     }
 
@@ -127,18 +203,215 @@ void Logger::log ( const char *srcFile, int srcLine, const char *srcFunc, const
 
     if ( _options & LOG_FUNC_NAME )
     {
-        string shortFunc ( srcFunc );
-        shortFunc = shortFunc.substr ( 0, shortFunc.find ( '(' ) );
-        fprintf ( _fd, "%s:", shortFunc.c_str() );
+        const char *end = strchr ( srcFunc, '(' );
+        fprintf ( _fd, "%.*s:", int ( end ? end - srcFunc : strlen ( srcFunc ) ), srcFunc );
         hasPrefix = true;
     }
 
     fprintf ( _fd, ( hasPrefix ? " %s\n" : "%s\n" ), logMessage );
+}
+
+size_t Logger::writeQueued()
+{
+    LOCK ( _fileMutex );
+
+    size_t count = 0;
+
+    const auto writeRecord = [&] ( Record& record )
+    {
+        // Queued messages are timestamped relative to initialization, since the wall clock is read much later
+        const time_t wallTime = _baseWallTime + time_t ( ( record.time - _baseTime ) / 1000000 );
+
+        if ( record.formatter )
+        {
+            write ( record.srcFile, record.srcLine, record.srcFunc, wallTime, record.time,
+                    record.formatter ( record.fmt, record.getData() ).c_str() );
+        }
+        else
+        {
+            write ( record.srcFile, record.srcLine, record.srcFunc, wallTime, record.time,
+                    ( const char * ) record.getData() );
+        }
+
+        free ( record.overflow );
+        record.overflow = 0;
+    };
+
+    while ( _ring->pop ( writeRecord ) )
+        ++count;
+
+    const uint32_t dropped = _dropped;
+
+    if ( dropped != _droppedReported )
+    {
+        fprintf ( _fd, "Dropped %u log messages\n", dropped - _droppedReported );
+        _droppedReported = dropped;
+    }
+
+    return count;
+}
+
+void Logger::WriterThread::run()
+{
+    isWriterThread = true;
+
+    uint64_t lastFlush = TimerManager::queryNowUs();
+    bool dirty = false;
+
+    while ( logger._writerRunning )
+    {
+        dirty |= ( logger.writeQueued() > 0 );
+
+        const uint64_t now = TimerManager::queryNowUs();
+
+        if ( logger._flushRequested
+                || ( dirty && now - lastFlush >= 1000ULL * logger._flushInterval ) )
+        {
+            {
+                Lock lock ( logger._fileMutex );
+                fflush ( logger._fd );
+            }
+
+            lastFlush = now;
+            dirty = false;
+
+            if ( logger._flushRequested )
+            {
+                Lock lock ( logger._writerMutex );
+                logger._flushRequested = false;
+                logger._writerCond.broadcast();
+            }
+        }
+
+        Lock lock ( logger._writerMutex );
+
+        // Producers only signal while this is set, see push
+        logger._writerWaiting = true;
+        atomic_thread_fence ( memory_order_seq_cst );
+
+        if ( logger._ring->empty() && logger._writerRunning && ! logger._flushRequested )
+        {
+            // Sleep until signalled, or until the pending data is due to be flushed
+            if ( dirty && logger._flushInterval )
+                logger._writerCond.wait ( logger._writerMutex, logger._flushInterval );
+            else
+                logger._writerCond.wait ( logger._writerMutex );
+        }
+
+        logger._writerWaiting = false;
+    }
+}
+
+void Logger::startWriter()
+{
+    if ( _writerRunning )
+        return;
+
+    if ( ! _ring )
+        _ring.reset ( new RecordRing() );
+
+    _baseWallTime = ::time ( 0 );
+    _baseTime = TimerManager::queryNowUs();
+
+    _writerRunning = true;
+
+    _writer.reset ( new WriterThread ( *this ) );
+    _writer->start();
+}
+
+void Logger::stopWriter()
+{
+    if ( ! _writerRunning )
+        return;
+
+    // New messages are written synchronously from here
+    {
+        LOCK ( _writerMutex );
+        _writerRunning = false;
+        _writerCond.broadcast();
+    }
+
+    _writer->join();
+    _writer.reset();
+
+    // Write the messages pushed while the writer was stopping
+    writeQueued();
+
+    LOCK ( _fileMutex );
     fflush ( _fd );
 }
 
 #endif // DISABLE_LOGGING
 
+static const char *categoryNames[NumLogCategories] = { "net", "gbn", "rollback", "input", "ui", "frame" };
+
+static const char *levelNames[] = { "trace", "debug", "info", "warn", "error", "off" };
+
+
+Logger::Logger()
+{
+    for ( auto& level : _levels )
+        level = LOG_DEFAULT_LEVEL;
+}
+
+bool Logger::setLevels ( const string& spec )
+{
+    bool valid = true;
+
+    for ( const string& part : split ( spec, "," ) )
+    {
+        const vector<string> keyValue = split ( trimmed ( part ), "=" );
+
+        if ( keyValue.size() != 2 )
+        {
+            valid = false;
+            continue;
+        }
+
+        const string category = lowerCase ( trimmed ( keyValue[0] ) );
+        const string level = lowerCase ( trimmed ( keyValue[1] ) );
+
+        const auto lit = find ( begin ( levelNames ), end ( levelNames ), level );
+
+        if ( lit == end ( levelNames ) )
+        {
+            valid = false;
+            continue;
+        }
+
+        const uint8_t value = uint8_t ( lit - begin ( levelNames ) );
+
+        if ( category == "*" )
+        {
+            for ( auto& level : _levels )
+                level = value;
+            continue;
+        }
+
+        const auto cit = find ( begin ( categoryNames ), end ( categoryNames ), category );
+
+        if ( cit == end ( categoryNames ) )
+        {
+            valid = false;
+            continue;
+        }
+
+        _levels[cit - begin ( categoryNames )] = value;
+    }
+
+    return valid;
+}
+
+string Logger::getLevels() const
+{
+    string levels;
+
+    for ( uint8_t i = 0; i < NumLogCategories; ++i )
+        levels += format ( "%s%s=%s", ( i ? "," : "" ), categoryNames[i], levelNames[_levels[i]] );
+
+    return levels;
+}
+
 Logger& Logger::get()
 {
     static Logger instance;
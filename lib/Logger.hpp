@@ -2,9 +2,17 @@
 
 #include "Thread.hpp"
 #include "StringUtils.hpp"
+#include "MpscRing.hpp"
+#include "TimerManager.hpp"
 
 #include <string>
+#include <memory>
+#include <atomic>
+#include <tuple>
+#include <new>
+#include <type_traits>
 #include <cstdio>
+#include <cstdlib>
 #include <ctime>
 
 
@@ -13,9 +21,95 @@
 #define LOG_FILE_LINE   ( 0x04 )    // Log file:line per message
 #define LOG_FUNC_NAME   ( 0x08 )    // Log the function name per message
 #define PID_IN_FILENAME ( 0x10 )    // Add the PID to the log filename
+#define LOG_ASYNC       ( 0x20 )    // Queue messages for a background thread to format and write
 
 #define LOG_DEFAULT_OPTIONS ( LOG_GM_TIME | LOG_FILE_LINE | LOG_FUNC_NAME )
 
+// Number of queued messages in async mode, messages are dropped if the queue is full
+#define LOG_RING_SIZE           ( 4096 )
+
+// Message or argument bytes stored inline in each queued record, anything larger is copied to the heap
+#define LOG_RECORD_MESSAGE_SIZE ( 224 )
+
+// Maximum number of bytes in a LogHex argument, so it fits inline in a queued record
+#define LOG_HEX_SIZE            ( LOG_RECORD_MESSAGE_SIZE - 4 )
+
+// Levels of categorized messages, see LOG_AT
+#define LOG_LEVEL_TRACE         ( 0 )       // Per packet / per frame details
+#define LOG_LEVEL_DEBUG         ( 1 )
+#define LOG_LEVEL_INFO          ( 2 )
+#define LOG_LEVEL_WARN          ( 3 )
+#define LOG_LEVEL_ERROR         ( 4 )
+#define LOG_LEVEL_OFF           ( 5 )
+
+// Categorized messages below this level are compiled out
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL           LOG_LEVEL_TRACE
+#endif
+
+// Initial runtime level of each category
+#define LOG_DEFAULT_LEVEL       LOG_LEVEL_DEBUG
+
+
+// Categories of messages, each with its own runtime level
+enum LogCategory : uint8_t
+{
+    LogNet,
+    LogGoBackN,
+    LogRollback,
+    LogInput,
+    LogUi,
+    LogFrame,
+
+    NumLogCategories
+};
+
+
+// Character types, pointers to these are usually strings
+template<typename T>
+struct IsLogCharType
+{
+    static const bool value = std::is_same<T, char>::value || std::is_same<T, signed char>::value
+                              || std::is_same<T, unsigned char>::value || std::is_same<T, wchar_t>::value
+                              || std::is_same<T, char8_t>::value || std::is_same<T, char16_t>::value
+                              || std::is_same<T, char32_t>::value;
+};
+
+// Argument types that can be copied as is and formatted later by the writer thread. Strings and objects are
+// formatted at the call site instead, since they may change or be freed before the message is written.
+template<typename T>
+struct IsDeferredLogArg
+{
+    static const bool value = std::is_arithmetic<T>::value || std::is_enum<T>::value
+                              || ( std::is_pointer<T>::value
+                                   && ! IsLogCharType<typename std::remove_cv<
+                                                      typename std::remove_pointer<T>::type>::type>::value );
+};
+
+#ifndef DISABLE_LOGGING
+
+// Bytes to log as hex. Unlike formatAsHex, the bytes are copied so formatting can be deferred.
+struct LogHex
+{
+    uint32_t length;
+
+    uint8_t bytes[LOG_HEX_SIZE];
+
+    LogHex ( const void *bytes, size_t length );
+};
+
+static_assert ( sizeof ( LogHex ) <= LOG_RECORD_MESSAGE_SIZE, "LogHex must fit inline in a queued record" );
+
+std::ostream& operator<< ( std::ostream& os, const LogHex& hex );
+
+template<>
+struct IsDeferredLogArg<LogHex>
+{
+    static const bool value = true;
+};
+
+#endif // NOT DISABLE_LOGGING
+
 
 class Logger
 {
@@ -24,22 +118,68 @@ public:
     // Session ID
     std::string sessionId;
 
-    // Basic constructor
-    Logger() {}
+    // Basic constructor / destructor
+    Logger();
+    ~Logger();
 
     // Initialize / deinitialize logging
     void initialize ( const std::string& filePath = "", uint32_t options = LOG_DEFAULT_OPTIONS );
     void deinitialize();
 
-    // Flush to file
+    bool isInitialized() const { return _initialized; }
+
+    // Flush to file, in async mode this waits until all queued messages are written
     void flush();
 
+    // Set how often the file is flushed in async mode. 0 flushes after every batch of messages, otherwise at
+    // most once per interval in milliseconds, which is faster but loses more on a crash. Sync mode always flushes.
+    void setFlushInterval ( uint32_t milliseconds ) { _flushInterval = milliseconds; }
+
+    // Number of messages dropped because the async queue was full
+    uint32_t getNumDropped() const { return _dropped; }
+
     // Log the system version
     void logVersion();
 
+    // Indicates if messages of a category at the given level should be logged
+    bool isEnabled ( LogCategory category, uint8_t level ) const
+    {
+        return ( level >= _levels[category].load ( std::memory_order_relaxed ) );
+    }
+
+    // Set the runtime level of a category
+    void setLevel ( LogCategory category, uint8_t level ) { _levels[category] = level; }
+
+    // Set levels from a spec like "net=warn,gbn=off", where "*" sets all categories.
+    // Returns false if any part of the spec is invalid, the valid parts are still applied.
+    bool setLevels ( const std::string& spec );
+
+    // Get the levels of all categories in the same format
+    std::string getLevels() const;
+
     // Log a message with source file, line, and function
     void log ( const char *srcFile, int srcLine, const char *srcFunc, const char *logMessage );
 
+    // Log a message from a format string and arguments. In async mode, if the format is a literal and all the
+    // arguments are deferrable, they are queued as is and only formatted by the writer thread.
+    template<typename F, typename ... V>
+    void logFormat ( const char *srcFile, int srcLine, const char *srcFunc, const F& fmt, const V& ... vals )
+    {
+        if ( ! _fd )
+            return;
+
+        if constexpr ( std::is_array<F>::value && ( IsDeferredLogArg<V>::value && ... ) )
+        {
+            if ( _writerRunning )
+            {
+                pushDeferred ( srcFile, srcLine, srcFunc, fmt, vals... );
+                return;
+            }
+        }
+
+        log ( srcFile, srcLine, srcFunc, format ( fmt, vals... ).c_str() );
+    }
+
     // Get the singleton instance
     static Logger& get();
 
@@ -63,6 +203,139 @@ private:
     // Flag to indicate if initialized
     bool _initialized = false;
 
+    // Formats a record from its format string and copied arguments
+    typedef std::string ( *Formatter ) ( const char *fmt, const void *args );
+
+    // Queued message for async mode, the source and format strings are literals so only the pointers are kept
+    struct Record
+    {
+        const char *srcFile, *srcFunc;
+
+        int srcLine;
+
+        // Monotonic time of the message in microseconds
+        uint64_t time;
+
+        // Formats the data as arguments to fmt, or null if the data is the formatted message
+        Formatter formatter;
+        const char *fmt;
+
+        // Heap copy of data that doesn't fit inline, otherwise null
+        void *overflow;
+
+        alignas ( 8 ) char data[LOG_RECORD_MESSAGE_SIZE];
+
+        const void *getData() const { return overflow ? overflow : data; }
+    };
+
+    typedef MpscRing<Record, LOG_RING_SIZE> RecordRing;
+
+    // Background thread that formats and writes the queued messages
+    class WriterThread : public Thread
+    {
+    public:
+        Logger& logger;
+
+        WriterThread ( Logger& logger ) : logger ( logger ) {}
+
+        void run() override;
+    };
+
+    std::unique_ptr<RecordRing> _ring;
+
+    std::unique_ptr<WriterThread> _writer;
+
+    std::atomic<bool> _writerRunning { false }, _flushRequested { false };
+
+    // Set while the writer thread is waiting for messages
+    std::atomic<bool> _writerWaiting { false };
+
+    std::atomic<uint32_t> _dropped { 0 };
+
+    // Number of dropped messages already noted in the file
+    uint32_t _droppedReported = 0;
+
+    // Runtime level of each category, read without locking by every categorized message
+    std::atomic<uint8_t> _levels[NumLogCategories];
+
+    uint32_t _flushInterval = 0;
+
+    // Wall clock and monotonic times at initialization, to timestamp queued messages
+    time_t _baseWallTime = 0;
+    uint64_t _baseTime = 0;
+
+    // Held while writing to the file, and to wake the writer thread
+    Mutex _fileMutex, _writerMutex;
+    CondVar _writerCond;
+
+    // Write one message to the file with the prefixes enabled by the options
+    void write ( const char *srcFile, int srcLine, const char *srcFunc, time_t wallTime, uint64_t time,
+                 const char *logMessage );
+
+    // Queue a message for the writer thread, fill ( void * ) copies size bytes of data into the record
+    template<typename F>
+    void push ( const char *srcFile, int srcLine, const char *srcFunc, Formatter formatter, const char *fmt,
+                size_t size, const F& fill )
+    {
+        const uint64_t time = TimerManager::queryNowUs();
+
+        const bool pushed = _ring->push ( [&] ( Record& record )
+        {
+            record.srcFile = srcFile;
+            record.srcFunc = srcFunc;
+            record.srcLine = srcLine;
+            record.time = time;
+            record.formatter = formatter;
+            record.fmt = fmt;
+            record.overflow = ( size <= sizeof ( record.data ) ? 0 : malloc ( size ) );
+
+            fill ( record.overflow ? record.overflow : record.data );
+        } );
+
+        // Never block the caller on a full queue, it is usually the game thread
+        if ( ! pushed )
+        {
+            ++_dropped;
+            return;
+        }
+
+        // Only wake the writer thread if it is idle. The fence pairs with the one in WriterThread::run, so either
+        // the writer sees this message before it waits, or this sees it waiting and signals it.
+        std::atomic_thread_fence ( std::memory_order_seq_cst );
+
+        if ( _writerWaiting.load ( std::memory_order_relaxed ) )
+        {
+            LOCK ( _writerMutex );
+            _writerCond.signal();
+        }
+    }
+
+    // Queue the arguments to be formatted by the writer thread
+    template<typename ... V>
+    void pushDeferred ( const char *srcFile, int srcLine, const char *srcFunc, const char *fmt, const V& ... vals )
+    {
+        typedef std::tuple<V...> Args;
+
+        static_assert ( std::is_trivially_destructible<Args>::value, "Deferred log arguments must be trivial" );
+
+        push ( srcFile, srcLine, srcFunc, &formatDeferred<V...>, fmt, sizeof ( Args ),
+               [&] ( void *data ) { new ( data ) Args ( vals... ); } );
+    }
+
+    template<typename ... V>
+    static std::string formatDeferred ( const char *fmt, const void *args )
+    {
+        return std::apply ( [fmt] ( const V& ... vals ) { return format ( fmt, vals... ); },
+                            *static_cast<const std::tuple<V...> *> ( args ) );
+    }
+
+    // Write all the queued messages, returns the number written
+    size_t writeQueued();
+
+    // Start / stop the writer thread, stopping writes any remaining messages
+    void startWriter();
+    void stopWriter();
+
     // Optionally mutexed logging
 #ifdef LOGGER_MUTEXED
     Mutex _mutex;
@@ -75,17 +348,40 @@ private:
 #define LOG_TO(...)
 #define LOG(...)
 #define LOG_LIST(...)
+#define LOG_AT(...)
+#define LOG_ENABLED(...) ( false )
+#define LOG_FLUSH()
 
 #else
 
 #define LOG_TO(LOGGER, FORMAT, ...)                                                                                    \
     do {                                                                                                               \
-        LOGGER.log ( __BASE_FILE__, __LINE__, __PRETTY_FUNCTION__, format ( FORMAT, ## __VA_ARGS__ ).c_str() );        \
+        LOGGER.logFormat ( __BASE_FILE__, __LINE__, __PRETTY_FUNCTION__, FORMAT, ## __VA_ARGS__ );                     \
     } while ( 0 )
 
 #define LOG(FORMAT, ...)                                                                                               \
     do {                                                                                                               \
-        Logger::get().log ( __BASE_FILE__, __LINE__, __PRETTY_FUNCTION__, format ( FORMAT, ## __VA_ARGS__ ).c_str() ); \
+        Logger::get().logFormat ( __BASE_FILE__, __LINE__, __PRETTY_FUNCTION__, FORMAT, ## __VA_ARGS__ );              \
+    } while ( 0 )
+
+// Flush to file, in async mode this waits until all queued messages are written
+#define LOG_FLUSH()                                                                                                    \
+    do {                                                                                                               \
+        Logger::get().flush();                                                                                         \
+    } while ( 0 )
+
+// Indicates if a categorized message would be logged, eg LOG_ENABLED ( Net, TRACE )
+#define LOG_ENABLED(CATEGORY, LEVEL)                                                                                   \
+    ( LOG_LEVEL_ ## LEVEL >= LOG_MIN_LEVEL && Logger::get().isEnabled ( Log ## CATEGORY, LOG_LEVEL_ ## LEVEL ) )
+
+// Log a categorized message, eg LOG_AT ( GoBackN, DEBUG, "sequence=%u", sequence ).
+// Nothing is evaluated unless the category is at or below the level, and the check itself is compiled out
+// if the level is below LOG_MIN_LEVEL.
+#define LOG_AT(CATEGORY, LEVEL, FORMAT, ...)                                                                           \
+    do {                                                                                                               \
+        if constexpr ( LOG_LEVEL_ ## LEVEL >= LOG_MIN_LEVEL )                                                          \
+            if ( Logger::get().isEnabled ( Log ## CATEGORY, LOG_LEVEL_ ## LEVEL ) )                                    \
+                LOG ( FORMAT, ## __VA_ARGS__ );                                                                        \
     } while ( 0 )
 
 #define LOG_LIST(LIST, TO_STRING)                                                                                      \
@@ -113,6 +409,7 @@ private:
             break;                                                                                                     \
         LOG ( "Assertion '%s' failed", #ASSERTION );                                                                   \
         PRINT ( "Assertion '%s' failed", #ASSERTION );                                                                 \
+        LOG_FLUSH();                                                                                                   \
         abort();                                                                                                       \
     } while ( 0 )
 
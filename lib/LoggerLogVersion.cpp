@@ -12,6 +12,8 @@ void Logger::logVersion() {}
 
 void Logger::logVersion()
 {
+    LOCK ( _fileMutex );
+
     fprintf ( _fd, "LogId '%s'\n", _logId.c_str() );
     fprintf ( _fd, "Version '%s' { '%s', '%s', '%s' }\n", LocalVersion.code.c_str(),
               LocalVersion.major().c_str(), LocalVersion.minor().c_str(), LocalVersion.suffix().c_str() );
@@ -0,0 +1,100 @@
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+
+#ifdef _WIN32
+
+bool MappedFile::open ( const string& file )
+{
+    close();
+
+    HANDLE handle = CreateFileA ( file.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, 0 );
+
+    if ( handle == INVALID_HANDLE_VALUE )
+        return false;
+
+    LARGE_INTEGER size;
+
+    if ( ! GetFileSizeEx ( handle, &size ) || size.QuadPart == 0 )
+    {
+        CloseHandle ( handle );
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA ( handle, 0, PAGE_READONLY, 0, 0, 0 );
+    CloseHandle ( handle );
+
+    if ( ! mapping )
+        return false;
+
+    // The view keeps the mapping alive
+    _data = ( const char * ) MapViewOfFile ( mapping, FILE_MAP_READ, 0, 0, 0 );
+    CloseHandle ( mapping );
+
+    if ( ! _data )
+        return false;
+
+    _size = size.QuadPart;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if ( _data )
+        UnmapViewOfFile ( _data );
+
+    _data = 0;
+    _size = 0;
+}
+
+#else
+
+bool MappedFile::open ( const string& file )
+{
+    close();
+
+    const int fd = ::open ( file.c_str(), O_RDONLY );
+
+    if ( fd < 0 )
+        return false;
+
+    struct stat st;
+
+    if ( fstat ( fd, &st ) != 0 || st.st_size == 0 )
+    {
+        ::close ( fd );
+        return false;
+    }
+
+    void *data = mmap ( 0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    ::close ( fd );
+
+    if ( data == MAP_FAILED )
+        return false;
+
+    _data = ( const char * ) data;
+    _size = st.st_size;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if ( _data )
+        munmap ( ( void * ) _data, _size );
+
+    _data = 0;
+    _size = 0;
+}
+
+#endif // _WIN32
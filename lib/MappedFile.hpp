@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+
+    MappedFile() {}
+
+    MappedFile ( const MappedFile& ) = delete;
+
+    MappedFile& operator= ( const MappedFile& ) = delete;
+
+    ~MappedFile() { close(); }
+
+    // Map the file, returns false if it can't be opened or is empty
+    bool open ( const std::string& file );
+
+    void close();
+
+    bool isOpen() const { return ( _data != 0 ); }
+
+    const char *data() const { return _data; }
+
+    size_t size() const { return _size; }
+
+private:
+
+    const char *_data = 0;
+
+    size_t _size = 0;
+};
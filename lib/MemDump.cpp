@@ -34,6 +34,41 @@ void MemDumpBase::saveDump ( char *&dump ) const
         ptr.saveDump ( dump );
 }
 
+void MemDumpBase::saveDump ( char *&dump, StateHasher& hash ) const
+{
+    ASSERT ( dump != 0 );
+
+    const char *addr = getAddr();
+
+    if ( addr )
+    {
+        size_t offset = 0;
+
+        for ( const MemDumpPtr& ptr : ptrs )
+        {
+            ASSERT ( ptr.srcOffset >= offset );
+
+            hash.copy ( addr + offset, dump + offset, ptr.srcOffset - offset );
+
+            offset = ptr.srcOffset + 4;
+            copy ( addr + ptr.srcOffset, addr + offset, dump + ptr.srcOffset );
+            hash.update ( uint32_t ( * ( const uint32_t * ) ( addr + ptr.srcOffset ) != 0 ) );
+        }
+
+        hash.copy ( addr + offset, dump + offset, size - offset );
+    }
+    else
+    {
+        memset ( dump, 0, size );
+        hash.update ( dump, size );
+    }
+
+    dump += size;
+
+    for ( const MemDumpPtr& ptr : ptrs )
+        ptr.saveDump ( dump, hash );
+}
+
 void MemDumpBase::loadDump ( const char *&dump ) const
 {
     ASSERT ( dump != 0 );
@@ -123,41 +158,43 @@ void MemDumpList::update()
         totalSize += mem.getTotalSize();
 }
 
+// All sizes and addresses are serialized as 32 bits, so the format is the same for the game and native host builds
+
 void MemDumpBase::save ( BinaryOutputArchive& ar ) const
 {
-    ar ( size, ptrs.size() );
+    ar ( uint32_t ( size ), uint32_t ( ptrs.size() ) );
     for ( const MemDumpPtr& ptr : ptrs )
         ptr.save ( ar );
 }
 
 void MemDumpPtr::save ( BinaryOutputArchive& ar ) const
 {
-    ar ( srcOffset, dstOffset );
+    ar ( uint32_t ( srcOffset ), uint32_t ( dstOffset ) );
     MemDumpBase::save ( ar );
 }
 
 void MemDump::save ( BinaryOutputArchive& ar ) const
 {
-    uint32_t val = ( uint32_t ) addr;
+    uint32_t val = ( uint32_t ) ( uintptr_t ) addr;
     ar ( val );
     MemDumpBase::save ( ar );
 }
 
 void MemDumpList::save ( BinaryOutputArchive& ar ) const
 {
-    ar ( totalSize, addrs.size() );
+    ar ( uint32_t ( totalSize ), uint32_t ( addrs.size() ) );
     for ( const MemDump& mem : addrs )
         mem.save ( ar );
 }
 
-static vector<MemDumpPtr> loadPtrs ( size_t count, BinaryInputArchive& ar )
+static vector<MemDumpPtr> loadPtrs ( uint32_t count, BinaryInputArchive& ar )
 {
     vector<MemDumpPtr> ret;
     ret.reserve ( count );
 
-    for ( size_t i = 0; i < count; ++i )
+    for ( uint32_t i = 0; i < count; ++i )
     {
-        size_t srcOffset, dstOffset, size, ptrsCount;
+        uint32_t srcOffset, dstOffset, size, ptrsCount;
         ar ( srcOffset, dstOffset, size, ptrsCount );
 
         if ( ptrsCount )
@@ -171,19 +208,19 @@ static vector<MemDumpPtr> loadPtrs ( size_t count, BinaryInputArchive& ar )
 
 void MemDumpList::load ( BinaryInputArchive& ar )
 {
-    size_t count;
-    ar ( totalSize, count );
+    uint32_t total, count;
+    ar ( total, count );
+    totalSize = total;
 
-    for ( size_t i = 0; i < count; ++i )
+    for ( uint32_t i = 0; i < count; ++i )
     {
-        uint32_t addr;
-        size_t size, ptrsCount;
+        uint32_t addr, size, ptrsCount;
         ar ( addr, size, ptrsCount );
 
         if ( ptrsCount )
-            append ( { ( char * ) addr, size, loadPtrs ( ptrsCount, ar ) } );
+            append ( { ( char * ) ( uintptr_t ) addr, size, loadPtrs ( ptrsCount, ar ) } );
         else
-            append ( { ( char * ) addr, size } );
+            append ( { ( char * ) ( uintptr_t ) addr, size } );
     }
 }
 
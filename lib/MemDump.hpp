@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Logger.hpp"
+#include "StateHasher.hpp"
 
 #include <cereal/archives/binary.hpp>
 
@@ -34,6 +35,10 @@ public:
     void saveDump ( char *&dump ) const;
     void loadDump ( const char *&dump ) const;
 
+    // Save the memory dump and hash it in the same pass. Child pointer values are hashed as null / non-null only,
+    // since heap addresses aren't the same across processes.
+    void saveDump ( char *&dump, StateHasher& hash ) const;
+
     // Get the total size of this memory dump
     size_t getTotalSize() const;
 
@@ -83,7 +88,8 @@ public:
 
         ASSERT ( srcOffset + 4 <= parent->size );
 
-        char *dstAddr = * ( char ** ) ( parent->getAddr() + srcOffset );
+        // The game's pointers are always 32 bits, this lets the same layout be tested natively on 64 bit hosts
+        char *dstAddr = ( char * ) ( uintptr_t ) * ( uint32_t * ) ( parent->getAddr() + srcOffset );
 
         if ( dstAddr == 0 )
             return 0;
@@ -137,11 +143,11 @@ public:
 
     // Construct a memory dump with a memory range
     MemDump ( uint32_t start, uint32_t end )
-        : MemDumpBase ( end - start ), addr ( ( char * ) start ) {}
+        : MemDumpBase ( end - start ), addr ( ( char * ) ( uintptr_t ) start ) {}
 
     // Construct a memory dump with a memory range, with child pointers
     MemDump ( uint32_t start, uint32_t end, const std::vector<MemDumpPtr>& ptrs )
-        : MemDumpBase ( end - start, ptrs ), addr ( ( char * ) start ) {}
+        : MemDumpBase ( end - start, ptrs ), addr ( ( char * ) ( uintptr_t ) start ) {}
 
     // Copy constructor
     MemDump ( const MemDump& a )
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+
+// Bounded lock-free queue for many producer threads and a single consumer thread.
+//
+// Each cell has a sequence number that says whether it is free for the producer of a given position, or ready for
+// the consumer, so producers only contend on one atomic increment and never wait for each other or the consumer.
+// Values are filled and consumed in place through callbacks, so large records aren't copied.
+template<typename T, size_t N>
+class MpscRing
+{
+    static_assert ( N >= 2 && ( N & ( N - 1 ) ) == 0, "MpscRing size must be a power of 2" );
+
+public:
+
+    MpscRing()
+    {
+        for ( size_t i = 0; i < N; ++i )
+            _cells[i].sequence.store ( uint32_t ( i ), std::memory_order_relaxed );
+    }
+
+    // Reserve a cell and fill it with fill ( T& ), returns false without calling fill if the ring is full.
+    // Safe to call from any thread.
+    template<typename F>
+    bool push ( const F& fill )
+    {
+        uint32_t pos = _enqueuePos.load ( std::memory_order_relaxed );
+        Cell *cell;
+
+        for ( ;; )
+        {
+            cell = &_cells[pos & ( N - 1 )];
+
+            const int32_t diff = int32_t ( cell->sequence.load ( std::memory_order_acquire ) - pos );
+
+            if ( diff == 0 )
+            {
+                if ( _enqueuePos.compare_exchange_weak ( pos, pos + 1, std::memory_order_relaxed ) )
+                    break;
+            }
+            else if ( diff < 0 )
+            {
+                // The consumer hasn't freed this cell yet
+                return false;
+            }
+            else
+            {
+                pos = _enqueuePos.load ( std::memory_order_relaxed );
+            }
+        }
+
+        fill ( cell->value );
+
+        cell->sequence.store ( pos + 1, std::memory_order_release );
+        return true;
+    }
+
+    // Pass the oldest value to consume ( T& ) and free its cell, returns false if the ring is empty.
+    // Only one thread may consume.
+    template<typename F>
+    bool pop ( const F& consume )
+    {
+        Cell& cell = _cells[_dequeuePos & ( N - 1 )];
+
+        if ( int32_t ( cell.sequence.load ( std::memory_order_acquire ) - ( _dequeuePos + 1 ) ) < 0 )
+            return false;
+
+        consume ( cell.value );
+
+        cell.sequence.store ( _dequeuePos + N, std::memory_order_release );
+        ++_dequeuePos;
+        return true;
+    }
+
+    // Indicates if there are no values ready to consume, only meaningful from the consumer thread
+    bool empty() const
+    {
+        const Cell& cell = _cells[_dequeuePos & ( N - 1 )];
+
+        return ( int32_t ( cell.sequence.load ( std::memory_order_acquire ) - ( _dequeuePos + 1 ) ) < 0 );
+    }
+
+    static constexpr size_t size() { return N; }
+
+private:
+
+    struct Cell
+    {
+        std::atomic<uint32_t> sequence;
+
+        T value;
+    };
+
+    std::array<Cell, N> _cells;
+
+    // Producers share the enqueue position, keep it away from the consumer's cache line
+    alignas ( 64 ) std::atomic<uint32_t> _enqueuePos { 0 };
+
+    alignas ( 64 ) uint32_t _dequeuePos = 0;
+};
@@ -25,7 +25,7 @@ void Pinger::start()
     ASSERT ( numPings > 0 );
 
     if ( owner )
-        owner->pingerSendPing ( this, MsgPtr ( new Ping ( TimerManager::get().getNow ( true ) ) ) );
+        owner->pingerSendPing ( this, MsgPtr ( new Ping ( TimerManager::get().getNowUs ( true ) ) ) );
 
     _pingCount = 1;
 
@@ -61,14 +61,15 @@ void Pinger::gotPong ( const MsgPtr& ping )
 
     if ( _pinging )
     {
-        const uint64_t now = TimerManager::get().getNow();
+        const uint64_t now = TimerManager::get().getNowUs ( true );
 
         if ( now < ping->getAs<Ping>().timestamp )
             return;
 
-        const uint64_t latency = ( now - ping->getAs<Ping>().timestamp ) / 2;
+        // Keep the sub-millisecond part, which matters for LAN latencies
+        const double latency = ( now - ping->getAs<Ping>().timestamp ) / 2000.0;
 
-        LOG ( "latency=%llu ms", latency );
+        LOG ( "latency=%.3f ms", latency );
 
         _stats.addSample ( latency );
     }
@@ -97,7 +98,7 @@ void Pinger::timerExpired ( Timer *timer )
     }
 
     if ( owner )
-        owner->pingerSendPing ( this, MsgPtr ( new Ping ( TimerManager::get().getNow() ) ) );
+        owner->pingerSendPing ( this, MsgPtr ( new Ping ( TimerManager::get().getNowUs() ) ) );
 
     ++_pingCount;
 
@@ -7,6 +7,7 @@
 
 struct Ping : public SerializableMessage
 {
+    // Send time in microseconds, this is only read by the sender
     uint64_t timestamp;
 
     Ping ( uint64_t timestamp ) : timestamp ( timestamp ) {}
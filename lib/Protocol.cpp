@@ -9,7 +9,6 @@ using namespace std;
 using namespace cereal;
 
 // Useful options for debugging and testing
-// #define LOG_PROTOCOL
 // #define FORCE_COMPRESSION
 // #define DISABLE_UPDATE_HASH
 // #define DISABLE_CHECK_HASH
@@ -87,12 +86,13 @@ string Protocol::encode ( const MsgPtr& msg )
         getMD5 ( ss.str(), &msg->_hash[0] );
         msg->_hashValid = false;
 
-#ifdef LOG_PROTOCOL
-        LOG ( "%s", msg->getMsgType() );
-        if ( ss.str().size() <= 256 )
-            LOG ( "data=[ %s ]", formatAsHex ( ss.str() ) );
-        LOG ( "hash=[ %s ]", formatAsHex ( msg->_hash, msg->_hash.size() ) );
-#endif
+        if ( LOG_ENABLED ( Net, TRACE ) )
+        {
+            LOG ( "%s", msg->getMsgType() );
+            if ( ss.str().size() <= 256 )
+                LOG ( "data=[ %s ]", formatAsHex ( ss.str() ) );
+            LOG ( "hash=[ %s ]", formatAsHex ( &msg->_hash[0], msg->_hash.size() ) );
+        }
     }
 #endif // NOT DISABLE_UPDATE_HASH
 
@@ -119,9 +119,7 @@ MsgPtr Protocol::decode ( const char *bytes, size_t len, size_t& consumed )
     // Decode with compression
     DecodeResult result = decodeStageTwo ( bytes, len, consumed, type, data );
 
-#ifdef LOG_PROTOCOL
-    LOG ( "decodeStageTwo: result=%s", result );
-#endif
+    LOG_AT ( Net, TRACE, "decodeStageTwo: result=%s", result );
 
     if ( result == DecodeResult::Failed )
     {
@@ -129,10 +127,8 @@ MsgPtr Protocol::decode ( const char *bytes, size_t len, size_t& consumed )
         return NullMsg;
     }
 
-#ifdef LOG_PROTOCOL
     if ( data.size() <= 256 )
-        LOG ( "decodeStageTwo: data=[ %s ]", formatAsHex ( data ) );
-#endif
+        LOG_AT ( Net, TRACE, "decodeStageTwo: data=[ %s ]", formatAsHex ( data ) );
 
     istringstream ss ( data, stringstream::binary );
     BinaryInputArchive archive ( ss );
@@ -161,23 +157,17 @@ MsgPtr Protocol::decode ( const char *bytes, size_t len, size_t& consumed )
     }
     catch ( const cereal::Exception& exc )
     {
-#ifdef LOG_PROTOCOL
-        LOG ( "type=%s; cereal::Exception: '%s'", type, exc.what() );
-#endif
+        LOG_AT ( Net, TRACE, "type=%s; cereal::Exception: '%s'", type, exc.what() );
         msg.reset();
     }
     catch ( const std::exception& exc )
     {
-#ifdef LOG_PROTOCOL
-        LOG ( "type=%s; std::exception: '%s'", type, exc.what() );
-#endif
+        LOG_AT ( Net, TRACE, "type=%s; std::exception: '%s'", type, exc.what() );
         msg.reset();
     }
     catch ( ... )
     {
-#ifdef LOG_PROTOCOL
-        LOG ( "type=%s; Unknown exception!", type );
-#endif
+        LOG_AT ( Net, TRACE, "type=%s; Unknown exception!", type );
         msg.reset();
     }
 
@@ -203,16 +193,17 @@ MsgPtr Protocol::decode ( const char *bytes, size_t len, size_t& consumed )
     // Check if the hash is correct
     if ( ! checkMD5 ( &data[0], dataSize - msg->_hash.size(), &msg->_hash[0] ) )
     {
-#ifdef LOG_PROTOCOL
-        LOG ( "hash check failed for %s", type );
-        LOG ( "data=[ %s ]", formatAsHex ( &data[0], dataSize - msg->_hash.size() ) );
-        LOG ( "hash    =[ %s ]", formatAsHex ( msg->_hash, msg->_hash.size() ) );
+        if ( LOG_ENABLED ( Net, TRACE ) )
+        {
+            LOG ( "hash check failed for %s", type );
+            LOG ( "data=[ %s ]", formatAsHex ( &data[0], dataSize - msg->_hash.size() ) );
+            LOG ( "hash    =[ %s ]", formatAsHex ( &msg->_hash[0], msg->_hash.size() ) );
 
-        char hash[msg->_hash.size()];
-        gethash ( &data[0], dataSize - msg->_hash.size(), hash );
+            char hash[16];
+            getMD5 ( &data[0], dataSize - msg->_hash.size(), hash );
 
-        LOG ( "expected=[ %s ]", formatAsHex ( hash, msg->_hash.size() ) );
-#endif
+            LOG ( "expected=[ %s ]", formatAsHex ( hash, sizeof ( hash ) ) );
+        }
         return NullMsg;
     }
 #endif // NOT DISABLE_UPDATE_HASH
@@ -278,25 +269,19 @@ DecodeResult decodeStageTwo ( const char *bytes, size_t len, size_t& consumed, M
     }
     catch ( const cereal::Exception& exc )
     {
-#ifdef LOG_PROTOCOL
-        LOG ( "cereal::Exception: '%s'", type, exc.what() );
-#endif
+        LOG_AT ( Net, TRACE, "cereal::Exception: '%s'", exc.what() );
         consumed = 0;
         return DecodeResult::Failed;
     }
     catch ( const std::exception& exc )
     {
-#ifdef LOG_PROTOCOL
-        LOG ( "std::exception: '%s'", type, exc.what() );
-#endif
+        LOG_AT ( Net, TRACE, "std::exception: '%s'", exc.what() );
         consumed = 0;
         return DecodeResult::Failed;
     }
     catch ( ... )
     {
-#ifdef LOG_PROTOCOL
-        LOG ( "Unknown exception!" );
-#endif
+        LOG_AT ( Net, TRACE, "Unknown exception!" );
         consumed = 0;
         return DecodeResult::Failed;
     }
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "Protocol.hpp"
+
+#include <cereal/types/vector.hpp>
+
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+
+// Streaming quantile sketch with a fixed relative error, in the style of DDSketch.
+//
+// Samples are counted in logarithmic buckets, so any quantile is within QUANTILE_SKETCH_ACCURACY of the true value,
+// relative to the value. Merging adds the bucket counts, which gives exactly the same sketch as adding all the samples
+// to one sketch. The buckets are stored densely from the lowest to highest bucket used, and the lowest buckets are
+// collapsed together past QUANTILE_SKETCH_MAX_BUCKETS, which only happens for samples more than 1e8 times apart.
+// Samples at or below QUANTILE_SKETCH_MIN_VALUE, including negative samples, are all counted as 0.
+
+
+// Relative accuracy of the quantiles
+#define QUANTILE_SKETCH_ACCURACY    ( 0.01 )
+
+// Maximum number of buckets
+#define QUANTILE_SKETCH_MAX_BUCKETS ( 1024 )
+
+// Samples at or below this are counted as 0
+#define QUANTILE_SKETCH_MIN_VALUE   ( 1e-3 )
+
+
+class QuantileSketch
+{
+public:
+
+    void addSample ( double value, uint32_t count = 1 )
+    {
+        if ( value <= QUANTILE_SKETCH_MIN_VALUE )
+        {
+            _zeroCount += count;
+            return;
+        }
+
+        const int32_t index = ( int32_t ) std::ceil ( std::log ( value ) / logGamma() );
+
+        // The bucket may have been collapsed into the lowest one
+        grow ( index, index );
+        _counts[std::max<int32_t> ( 0, index - _offset )] += count;
+    }
+
+    void merge ( const QuantileSketch& sketch )
+    {
+        _zeroCount += sketch._zeroCount;
+
+        if ( sketch._counts.empty() )
+            return;
+
+        grow ( sketch._offset, sketch._offset + int32_t ( sketch._counts.size() ) - 1 );
+
+        for ( size_t i = 0; i < sketch._counts.size(); ++i )
+            _counts[std::max<int32_t> ( 0, sketch._offset + int32_t ( i ) - _offset )] += sketch._counts[i];
+    }
+
+    void reset()
+    {
+        _zeroCount = 0;
+        _offset = 0;
+        _counts.clear();
+    }
+
+    uint64_t getNumSamples() const
+    {
+        uint64_t count = _zeroCount;
+
+        for ( uint32_t c : _counts )
+            count += c;
+
+        return count;
+    }
+
+    // Get the value at the given quantile, from 0 to 1, returns 0 if there are no samples
+    double getQuantile ( double q ) const
+    {
+        const uint64_t count = getNumSamples();
+
+        if ( count == 0 )
+            return 0;
+
+        const uint64_t rank = ( uint64_t ) ( std::min ( std::max ( q, 0.0 ), 1.0 ) * ( count - 1 ) );
+
+        uint64_t seen = _zeroCount;
+
+        if ( rank < seen )
+            return 0;
+
+        for ( size_t i = 0; i < _counts.size(); ++i )
+        {
+            seen += _counts[i];
+
+            // The midpoint of the bucket ( gamma^(i-1), gamma^i ] in relative terms
+            if ( rank < seen )
+                return 2 * std::exp ( ( _offset + int32_t ( i ) ) * logGamma() ) / ( gamma() + 1 );
+        }
+
+        return 0;
+    }
+
+    CEREAL_CLASS_BOILERPLATE ( _zeroCount, _offset, _counts )
+
+private:
+
+    // Number of samples counted as 0
+    uint64_t _zeroCount = 0;
+
+    // Bucket index of _counts[0]
+    int32_t _offset = 0;
+
+    // Mapping: bucket index - _offset -> count, where bucket i contains the values ( gamma^(i-1), gamma^i ]
+    std::vector<uint32_t> _counts;
+
+    static double gamma() { return ( 1 + QUANTILE_SKETCH_ACCURACY ) / ( 1 - QUANTILE_SKETCH_ACCURACY ); }
+
+    static double logGamma()
+    {
+        static const double value = std::log ( gamma() );
+        return value;
+    }
+
+    // Make room for the bucket indices [lo, hi], collapsing the lowest buckets if there are too many
+    void grow ( int32_t lo, int32_t hi )
+    {
+        if ( _counts.empty() )
+        {
+            _offset = lo;
+            _counts.resize ( hi - lo + 1, 0 );
+        }
+        else if ( lo < _offset )
+        {
+            _counts.insert ( _counts.begin(), _offset - lo, 0 );
+            _offset = lo;
+        }
+
+        if ( hi >= _offset + int32_t ( _counts.size() ) )
+            _counts.resize ( hi - _offset + 1, 0 );
+
+        if ( _counts.size() <= QUANTILE_SKETCH_MAX_BUCKETS )
+            return;
+
+        const size_t excess = _counts.size() - QUANTILE_SKETCH_MAX_BUCKETS;
+
+        for ( size_t i = 0; i < excess; ++i )
+            _counts[excess] += _counts[i];
+
+        _counts.erase ( _counts.begin(), _counts.begin() + excess );
+        _offset += excess;
+    }
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+
+// Single writer sequence lock for publishing small values to other threads.
+//
+// The writer never waits, and readers never block the writer; a reader only retries if it raced with a store.
+// The value is copied through relaxed atomic words, so a torn read is never undefined behaviour, it is just
+// detected by the sequence number and retried. Multiple writers must be serialized externally.
+template<typename T>
+class SeqLock
+{
+    static_assert ( std::is_trivially_copyable<T>::value, "SeqLock requires a trivially copyable type" );
+
+public:
+
+    SeqLock()
+    {
+        const T value = T();
+
+        Words words = {{ 0 }};
+        std::memcpy ( &words[0], &value, sizeof ( T ) );
+
+        for ( size_t i = 0; i < words.size(); ++i )
+            _words[i].store ( words[i], std::memory_order_relaxed );
+    }
+
+    // Publish a new value, only one thread may store at a time
+    void store ( const T& value )
+    {
+        Words words = {{ 0 }};
+        std::memcpy ( &words[0], &value, sizeof ( T ) );
+
+        const uint32_t sequence = _sequence.load ( std::memory_order_relaxed );
+
+        // An odd sequence marks a store in progress
+        _sequence.store ( sequence + 1, std::memory_order_relaxed );
+        std::atomic_thread_fence ( std::memory_order_release );
+
+        for ( size_t i = 0; i < words.size(); ++i )
+            _words[i].store ( words[i], std::memory_order_relaxed );
+
+        _sequence.store ( sequence + 2, std::memory_order_release );
+    }
+
+    // Try to read the value once, returns false if a store was in progress
+    bool tryLoad ( T& value ) const
+    {
+        const uint32_t before = _sequence.load ( std::memory_order_acquire );
+
+        if ( before & 1 )
+            return false;
+
+        Words words;
+
+        for ( size_t i = 0; i < words.size(); ++i )
+            words[i] = _words[i].load ( std::memory_order_relaxed );
+
+        std::atomic_thread_fence ( std::memory_order_acquire );
+
+        if ( _sequence.load ( std::memory_order_relaxed ) != before )
+            return false;
+
+        std::memcpy ( &value, &words[0], sizeof ( T ) );
+        return true;
+    }
+
+    // Read the value, retrying until it isn't torn by a concurrent store
+    T load() const
+    {
+        T value;
+
+        while ( ! tryLoad ( value ) )
+            ;
+
+        return value;
+    }
+
+    // Number of stores so far
+    uint32_t getVersion() const { return _sequence.load ( std::memory_order_acquire ) / 2; }
+
+private:
+
+    typedef std::array<uint32_t, ( sizeof ( T ) + 3 ) / 4> Words;
+
+    std::atomic<uint32_t> _sequence { 0 };
+
+    std::array<std::atomic<uint32_t>, ( sizeof ( T ) + 3 ) / 4> _words;
+};
@@ -233,12 +233,12 @@ bool Socket::send ( const char *buffer, size_t len )
 
         if ( isTCP() )
         {
-            LOG_SOCKET ( this, "send ( [ %u bytes ] )", len );
+            LOG_SOCKET_AT ( DEBUG, this, "send ( [ %u bytes ] )", len );
             sentBytes = ::send ( _fd, buffer, len, 0 );
         }
         else
         {
-            LOG_SOCKET ( this, "sendto ( [ %u bytes ], '%s' )", len, address );
+            LOG_SOCKET_AT ( DEBUG, this, "sendto ( [ %u bytes ], '%s' )", len, address );
             sentBytes = ::sendto ( _fd, buffer, len, 0,
                                    address.getAddrInfo()->ai_addr, address.getAddrInfo()->ai_addrlen );
         }
@@ -288,7 +288,7 @@ bool Socket::send ( const char *buffer, size_t len, const IpAddrPort& address )
 
     while ( totalBytes < len || len == 0 )
     {
-        LOG_SOCKET ( this, "sendto ( [ %u bytes ], '%s' )", len, address );
+        LOG_SOCKET_AT ( DEBUG, this, "sendto ( [ %u bytes ], '%s' )", len, address );
         int sentBytes = ::sendto ( _fd, buffer, len, 0,
                                    address.getAddrInfo()->ai_addr, address.getAddrInfo()->ai_addrlen );
 
@@ -413,7 +413,7 @@ void Socket::socketRead()
     // Simulated packet loss
     if ( rand() % 100 < _packetLoss )
     {
-        LOG ( "Discarding [ %u bytes ] from '%s'", bufferLen, address );
+        LOG_AT ( Net, DEBUG, "Discarding [ %u bytes ] from '%s'", bufferLen, address );
         return;
     }
 #endif
@@ -421,7 +421,7 @@ void Socket::socketRead()
     // Raw read mode
     if ( _isRaw )
     {
-        LOG ( "Read [ %u bytes ] from '%s'", bufferLen, address );
+        LOG_AT ( Net, DEBUG, "Read [ %u bytes ] from '%s'", bufferLen, address );
 
         if ( owner )
             owner->socketRead ( this, bufferStart, bufferLen, address );
@@ -430,18 +430,26 @@ void Socket::socketRead()
 
     // Increment the buffer position
     _readPos += bufferLen;
-    LOG ( "Read [ %u bytes ] from '%s'; %u bytes remaining in buffer", bufferLen, address, _readPos );
+    LOG_AT ( Net, DEBUG, "Read [ %u bytes ] from '%s'; %u bytes remaining in buffer", bufferLen, address, _readPos );
 
     // Handle zero byte packets
     if ( bufferLen == 0 )
     {
-        LOG ( "Decoded 'NullMsg' using [ 0 bytes ]" );
+        LOG_AT ( Net, DEBUG, "Decoded 'NullMsg' using [ 0 bytes ]" );
         socketRead ( NullMsg, address );
         return;
     }
 
-    if ( bufferLen <= 256 )
-        LOG ( "Hex: %s", formatAsHex ( bufferStart, bufferLen ) );
+    // Packets longer than one LogHex are logged in two parts, which are queued with a heap copy
+    if ( bufferLen <= LOG_HEX_SIZE )
+    {
+        LOG_AT ( Net, DEBUG, "Hex: %s", LogHex ( bufferStart, bufferLen ) );
+    }
+    else if ( bufferLen <= 256 )
+    {
+        LOG_AT ( Net, DEBUG, "Hex: %s %s", LogHex ( bufferStart, LOG_HEX_SIZE ),
+                 LogHex ( bufferStart + LOG_HEX_SIZE, bufferLen - LOG_HEX_SIZE ) );
+    }
 
     // Check if the first byte is a valid message type
     if ( _readPos >= sizeof ( MsgType ) && ! ::Protocol::checkMsgType ( * ( MsgType * ) &_readBuffer[0] ) )
@@ -464,7 +472,8 @@ void Socket::socketRead()
         if ( ! msg.get() )
             return;
 
-        LOG ( "Decoded '%s' using [ %u bytes ]; %u bytes remaining in buffer", msg, consumedBytes, _readPos );
+        LOG_AT ( Net, DEBUG, "Decoded '%s' using [ %u bytes ]; %u bytes remaining in buffer",
+                 msg, consumedBytes, _readPos );
         socketRead ( msg, address );
 
         // Abort if the socket is de-allocated
@@ -15,6 +15,10 @@
     LOG ( "%s socket=%08x; fd=%08x; state=%s; address='%s'; isRaw=%u; " FORMAT,                                     \
           SOCKET->protocol, SOCKET, SOCKET->_fd, SOCKET->_state, SOCKET->address, SOCKET->_isRaw, ## __VA_ARGS__ )
 
+#define LOG_SOCKET_AT(LEVEL, SOCKET, FORMAT, ...)                                                                   \
+    LOG_AT ( Net, LEVEL, "%s socket=%08x; fd=%08x; state=%s; address='%s'; isRaw=%u; " FORMAT,                      \
+             SOCKET->protocol, SOCKET, SOCKET->_fd, SOCKET->_state, SOCKET->address, SOCKET->_isRaw, ## __VA_ARGS__ )
+
 
 // Forward declarations
 struct _WSAPROTOCOL_INFOA;
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+// Streaming 64 bit hash for large blocks of game state, NOT cryptographic.
+//
+// The inner loop is in the style of XXH3: 8 independent 64 bit accumulators, each updated with a 32x32->64 bit
+// multiply, so with SSE2 each pair of lanes is one pmuludq and there are no 64x64 bit multiplies on i686.
+// The accumulators are scrambled every block of stripes, and folded together with an avalanche at the end,
+// so the result only depends on the bytes hashed. The scalar version gives the same hashes.
+class StateHasher
+{
+public:
+
+    StateHasher() { reset(); }
+
+    void reset()
+    {
+        for ( size_t i = 0; i < NumLanes; ++i )
+            _acc[i] = key ( i );
+
+        _bufferLen = 0;
+        _numStripes = 0;
+        _totalLen = 0;
+    }
+
+    void update ( const void *data, size_t len )
+    {
+        const char *bytes = ( const char * ) data;
+
+        _totalLen += len;
+
+        // Fill the partial stripe first
+        if ( _bufferLen )
+        {
+            const size_t n = std::min ( len, StripeLen - _bufferLen );
+            memcpy ( _buffer + _bufferLen, bytes, n );
+            _bufferLen += n;
+            bytes += n;
+            len -= n;
+
+            if ( _bufferLen < StripeLen )
+                return;
+
+            stripes<false> ( _buffer, 0, 1 );
+            _bufferLen = 0;
+        }
+
+        const size_t count = len / StripeLen;
+        stripes<false> ( bytes, 0, count );
+        bytes += count * StripeLen;
+        len -= count * StripeLen;
+
+        memcpy ( _buffer, bytes, len );
+        _bufferLen = len;
+    }
+
+    template<typename T>
+    void update ( const T& value )
+    {
+        update ( &value, sizeof ( value ) );
+    }
+
+    // Copy bytes and hash them in the same pass, each stripe is hashed from the registers it was copied with
+    void copy ( const char *src, char *dst, size_t len )
+    {
+        // Complete a partial stripe first
+        if ( _bufferLen )
+        {
+            const size_t n = std::min ( len, StripeLen - _bufferLen );
+            memcpy ( dst, src, n );
+            update ( dst, n );
+            src += n;
+            dst += n;
+            len -= n;
+
+            if ( _bufferLen )
+                return;
+        }
+
+        const size_t count = len / StripeLen;
+        _totalLen += count * StripeLen;
+        stripes<true> ( src, dst, count );
+        src += count * StripeLen;
+        dst += count * StripeLen;
+        len -= count * StripeLen;
+
+        memcpy ( dst, src, len );
+        update ( dst, len );
+    }
+
+    uint64_t digest() const
+    {
+        uint64_t acc[NumLanes];
+        std::copy ( _acc, _acc + NumLanes, acc );
+
+        // Pad the last partial stripe with zeros, the total length is mixed in below
+        if ( _bufferLen )
+        {
+            char last[StripeLen] = { 0 };
+            memcpy ( last, _buffer, _bufferLen );
+            accumulate ( acc, last );
+        }
+
+        uint64_t h = _totalLen * Prime64_1;
+
+        for ( size_t i = 0; i < NumLanes; ++i )
+        {
+            h ^= avalanche ( acc[i] ^ key ( i + NumLanes ) );
+            h = rotl ( h, 27 ) * Prime64_1 + Prime64_4;
+        }
+
+        return avalanche ( h );
+    }
+
+private:
+
+    static constexpr size_t NumLanes = 8;
+
+    static constexpr size_t StripeLen = NumLanes * sizeof ( uint64_t );
+
+    static constexpr size_t StripesPerBlock = 16;
+
+    static constexpr uint64_t Prime32_1 = 0x9E3779B1ULL;
+    static constexpr uint64_t Prime64_1 = 0x9E3779B185EBCA87ULL;
+    static constexpr uint64_t Prime64_2 = 0xC2B2AE3D27D4EB4FULL;
+    static constexpr uint64_t Prime64_3 = 0x165667B19E3779F9ULL;
+    static constexpr uint64_t Prime64_4 = 0x85EBCA77C2B2AE63ULL;
+
+    uint64_t _acc[NumLanes];
+
+    char _buffer[StripeLen];
+
+    size_t _bufferLen;
+
+    size_t _numStripes;
+
+    uint64_t _totalLen;
+
+    static constexpr uint64_t rotl ( uint64_t x, int r ) { return ( x << r ) | ( x >> ( 64 - r ) ); }
+
+    // Per lane keys, generated with splitmix64
+    static constexpr uint64_t key ( size_t i )
+    {
+        uint64_t z = ( i + 1 ) * 0x9E3779B97F4A7C15ULL;
+        z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+        z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+        return z ^ ( z >> 31 );
+    }
+
+    static uint64_t avalanche ( uint64_t h )
+    {
+        h ^= h >> 33;
+        h *= Prime64_2;
+        h ^= h >> 29;
+        h *= Prime64_3;
+        h ^= h >> 32;
+        return h;
+    }
+
+    static void accumulate ( uint64_t *acc, const char *bytes )
+    {
+        uint64_t data[NumLanes];
+        memcpy ( data, bytes, StripeLen );
+
+        for ( size_t i = 0; i < NumLanes; ++i )
+        {
+            const uint64_t k = data[i] ^ key ( i );
+            acc[i ^ 1] += data[i];
+            acc[i] += uint64_t ( uint32_t ( k ) ) * uint64_t ( uint32_t ( k >> 32 ) );
+        }
+    }
+
+    static uint64_t scramble ( uint64_t acc, size_t i ) { return ( acc ^ ( acc >> 47 ) ^ key ( i ) ) * Prime32_1; }
+
+    // Accumulate whole stripes, and also copy them to dst if Copy
+    template<bool Copy>
+    void stripes ( const char *src, char *dst, size_t count )
+    {
+#ifdef __SSE2__
+        static const uint64_t keys[NumLanes] = { key ( 0 ), key ( 1 ), key ( 2 ), key ( 3 ),
+                                                 key ( 4 ), key ( 5 ), key ( 6 ), key ( 7 ) };
+
+        const __m128i prime = _mm_set1_epi32 ( int ( Prime32_1 ) );
+
+        __m128i acc[NumLanes / 2], k[NumLanes / 2];
+
+        for ( size_t i = 0; i < NumLanes / 2; ++i )
+        {
+            acc[i] = _mm_loadu_si128 ( ( const __m128i * ) &_acc[2 * i] );
+            k[i] = _mm_loadu_si128 ( ( const __m128i * ) &keys[2 * i] );
+        }
+
+        for ( ; count; --count, src += StripeLen, dst += ( Copy ? StripeLen : 0 ) )
+        {
+            for ( size_t i = 0; i < NumLanes / 2; ++i )
+            {
+                const __m128i data = _mm_loadu_si128 ( ( const __m128i * ) src + i );
+
+                if ( Copy )
+                    _mm_storeu_si128 ( ( __m128i * ) dst + i, data );
+
+                // Same as accumulate: add the data to the swapped lane, and the low * high halves of data ^ key
+                const __m128i x = _mm_xor_si128 ( data, k[i] );
+                const __m128i product = _mm_mul_epu32 ( x, _mm_shuffle_epi32 ( x, _MM_SHUFFLE ( 2, 3, 0, 1 ) ) );
+
+                acc[i] = _mm_add_epi64 ( acc[i], _mm_shuffle_epi32 ( data, _MM_SHUFFLE ( 1, 0, 3, 2 ) ) );
+                acc[i] = _mm_add_epi64 ( acc[i], product );
+            }
+
+            if ( ++_numStripes < StripesPerBlock )
+                continue;
+
+            _numStripes = 0;
+
+            // Same as scramble, the 64 bit multiply by a 32 bit prime is done as two 32x32->64 bit multiplies
+            for ( size_t i = 0; i < NumLanes / 2; ++i )
+            {
+                const __m128i x = _mm_xor_si128 ( _mm_xor_si128 ( acc[i], _mm_srli_epi64 ( acc[i], 47 ) ), k[i] );
+                const __m128i high = _mm_mul_epu32 ( _mm_srli_epi64 ( x, 32 ), prime );
+
+                acc[i] = _mm_add_epi64 ( _mm_mul_epu32 ( x, prime ), _mm_slli_epi64 ( high, 32 ) );
+            }
+        }
+
+        for ( size_t i = 0; i < NumLanes / 2; ++i )
+            _mm_storeu_si128 ( ( __m128i * ) &_acc[2 * i], acc[i] );
+#else
+        for ( ; count; --count, src += StripeLen, dst += ( Copy ? StripeLen : 0 ) )
+        {
+            if ( Copy )
+                memcpy ( dst, src, StripeLen );
+
+            accumulate ( _acc, src );
+
+            if ( ++_numStripes < StripesPerBlock )
+                continue;
+
+            _numStripes = 0;
+
+            for ( size_t i = 0; i < NumLanes; ++i )
+                _acc[i] = scramble ( _acc[i], i );
+        }
+#endif // __SSE2__
+    }
+};
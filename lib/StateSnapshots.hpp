@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+
+
+// File of saved rollback states, written by DllRollbackManager::dumpStates and read by tools/DesyncBisect.cpp.
+// The header is followed by numStates records in chronological order, each one is the uint64_t IndexedFrame value
+// followed by stateSize bytes, in the same order as MemDumpList::saveDump.
+#define STATE_SNAPSHOTS_MAGIC "CCSNAP01"
+
+struct StateSnapshotsHeader
+{
+    char magic[8];
+
+    uint32_t stateSize;
+
+    uint32_t numStates;
+};
+
+
+// File of raw game memory captured over consecutive frames, written by DllMemoryCapture and read by
+// tools/MemCoverage.cpp. The header is followed by numRanges RawSnapshotsRange, then one record per frame until the
+// end of the file, each one is the uint64_t IndexedFrame value followed by frameSize bytes of all ranges in order.
+#define RAW_SNAPSHOTS_MAGIC "CCRAW001"
+
+struct RawSnapshotsHeader
+{
+    char magic[8];
+
+    uint32_t numRanges;
+
+    uint32_t frameSize;
+};
+
+struct RawSnapshotsRange
+{
+    uint32_t addr;
+
+    uint32_t size;
+};
@@ -2,6 +2,7 @@
 
 #include "Protocol.hpp"
 #include "Logger.hpp"
+#include "QuantileSketch.hpp"
 
 #include <cmath>
 #include <limits>
@@ -26,6 +27,8 @@ public:
         ++_count;
         _mean += delta / _count;
         _sumOfSquaredDeltas += delta * ( value - _mean );
+
+        _quantiles.addSample ( value );
     }
 
     void reset()
@@ -33,6 +36,7 @@ public:
         _count = 0;
         _worst = -std::numeric_limits<double>::infinity();
         _mean = _sumOfSquaredDeltas = 0.0;
+        _quantiles.reset();
     }
 
     size_t getNumSamples() const
@@ -76,15 +80,33 @@ public:
         return getStdDev() / std::sqrt ( _count );
     }
 
+    // Get the sample at the given quantile, from 0 to 1, within 1% of the actual value
+    double getQuantile ( double q ) const
+    {
+        if ( _count < 1 )
+            return 0;
+
+        return std::min ( _quantiles.getQuantile ( q ), _worst );
+    }
+
     void merge ( const Statistics& stats )
     {
+        if ( stats._count == 0 )
+            return;
+
+        // http://en.wikipedia.org/wiki/Algorithms_for_calculating_variance#Parallel_algorithm
+        const double delta = stats._mean - _mean;
+        const size_t count = _count + stats._count;
+
         _worst = std::max ( _worst, stats._worst );
-        _mean = ( _mean * _count + stats._mean * stats._count ) / ( _count + stats._count );
-        _sumOfSquaredDeltas += stats._sumOfSquaredDeltas;
-        _count += stats._count;
+        _sumOfSquaredDeltas += stats._sumOfSquaredDeltas + delta * delta * _count * stats._count / count;
+        _mean = ( _mean * _count + stats._mean * stats._count ) / count;
+        _count = count;
+
+        _quantiles.merge ( stats._quantiles );
     }
 
-    PROTOCOL_MESSAGE_BOILERPLATE ( Statistics, _count, _worst, _mean, _sumOfSquaredDeltas )
+    PROTOCOL_MESSAGE_BOILERPLATE ( Statistics, _count, _worst, _mean, _sumOfSquaredDeltas, _quantiles )
 
 private:
 
@@ -98,5 +120,8 @@ private:
 
     // Sum of (latency - mean)^2 for each latency value
     double _sumOfSquaredDeltas = 0.0;
+
+    // Distribution of the samples
+    QuantileSketch _quantiles;
 };
 
@@ -46,6 +46,12 @@ public:
         pthread_mutex_unlock ( &_mutex );
     }
 
+    // Lock without waiting, returns false if another thread holds the lock
+    bool tryLock()
+    {
+        return ( pthread_mutex_trylock ( &_mutex ) == 0 );
+    }
+
     friend class CondVar;
 
 private:
@@ -77,6 +83,28 @@ private:
 #define LOCK(MUTEX) Lock lock ## MUTEX ( MUTEX )
 
 
+class TryLock
+{
+public:
+
+    TryLock ( Mutex& mutex ) : _mutex ( mutex ), _locked ( mutex.tryLock() ) {}
+
+    ~TryLock()
+    {
+        if ( _locked )
+            _mutex.unlock();
+    }
+
+    bool isLocked() const { return _locked; }
+
+private:
+
+    Mutex& _mutex;
+
+    bool _locked;
+};
+
+
 class CondVar
 {
 public:
@@ -14,7 +14,7 @@ Timer::~Timer()
     TimerManager::get().remove ( this );
 }
 
-void Timer::start ( uint64_t delay )
+void Timer::startUs ( uint64_t delay )
 {
     _delay = delay;
 }
@@ -18,11 +18,16 @@ public:
     Timer ( Owner *owner );
     ~Timer();
 
-    void start ( uint64_t delay );
+    // Start the timer with a delay in milliseconds
+    void start ( uint64_t delay ) { startUs ( 1000 * delay ); }
+
+    // Start the timer with a delay in microseconds
+    void startUs ( uint64_t delay );
 
     void stop();
 
-    uint64_t getDelay() const { return _delay; }
+    uint64_t getDelay() const { return _delay / 1000; }
+    uint64_t getDelayUs() const { return _delay; }
 
     bool isStarted() const { return ( _delay > 0 || _expiry > 0 ); }
 
@@ -30,6 +35,7 @@ public:
 
 private:
 
+    // Delay and expiry time in microseconds
     uint64_t _delay = 0, _expiry = 0;
 };
 
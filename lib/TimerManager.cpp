@@ -16,15 +16,35 @@ void TimerManager::updateNow()
     if ( _useHiResTimer )
     {
         QueryPerformanceCounter ( ( LARGE_INTEGER * ) &_ticks );
-        _now = ( 1000 * _ticks ) / _ticksPerSecond;
+
+        // Split the conversion so the multiply can't overflow, even with a high tick frequency and uptime
+        _nowUs = ( _ticks / _ticksPerSecond ) * 1000000 + ( ( _ticks % _ticksPerSecond ) * 1000000 ) / _ticksPerSecond;
     }
     else
     {
         // Note: timeGetTime should be called between timeBeginPeriod / timeEndPeriod to ensure accuracy
-        _now = timeGetTime();
+        _nowUs = 1000ULL * timeGetTime();
     }
 }
 
+uint64_t TimerManager::queryNowUs()
+{
+    // Initialized once by the first caller, since this is called from any thread, eg by the log writer thread
+    static const uint64_t ticksPerSecond = []
+    {
+        LARGE_INTEGER frequency;
+        return ( QueryPerformanceFrequency ( &frequency ) ? uint64_t ( frequency.QuadPart ) : 0 );
+    } ();
+
+    if ( ! ticksPerSecond )
+        return 1000ULL * timeGetTime();
+
+    uint64_t ticks;
+    QueryPerformanceCounter ( ( LARGE_INTEGER * ) &ticks );
+
+    return ( ticks / ticksPerSecond ) * 1000000 + ( ( ticks % ticksPerSecond ) * 1000000 ) / ticksPerSecond;
+}
+
 void TimerManager::check()
 {
     if ( ! _initialized )
@@ -37,7 +57,7 @@ void TimerManager::check()
             if ( _activeTimers.find ( timer ) != _activeTimers.end() )
                 continue;
 
-            LOG ( "Added timer %08x; delay='%llu ms'", timer, timer->_delay );
+            LOG ( "Added timer %08x; delay='%llu us'", timer, timer->_delay );
             _activeTimers.insert ( timer );
         }
 
@@ -56,7 +76,7 @@ void TimerManager::check()
         _changed = false;
     }
 
-    _nextExpiry = UINT64_MAX;
+    _nextExpiryUs = UINT64_MAX;
 
     if ( _activeTimers.empty() )
         return;
@@ -68,7 +88,7 @@ void TimerManager::check()
         if ( _allocatedTimers.find ( timer ) == _allocatedTimers.end() )
             continue;
 
-        if ( timer->_expiry > 0 && _now >= timer->_expiry )
+        if ( timer->_expiry > 0 && _nowUs >= timer->_expiry )
         {
             LOG ( "Expired timer %08x", timer );
 
@@ -85,14 +105,14 @@ void TimerManager::check()
 
         if ( timer->_delay > 0 )
         {
-            LOG ( "Started timer %08x; delay='%llu ms'", timer, timer->_delay );
+            LOG ( "Started timer %08x; delay='%llu us'", timer, timer->_delay );
 
-            timer->_expiry = _now + timer->_delay;
+            timer->_expiry = _nowUs + timer->_delay;
             timer->_delay = 0;
         }
 
-        if ( timer->_expiry > 0 && timer->_expiry < _nextExpiry )
-            _nextExpiry = timer->_expiry;
+        if ( timer->_expiry > 0 && timer->_expiry < _nextExpiryUs )
+            _nextExpiryUs = timer->_expiry;
     }
 }
 
@@ -30,12 +30,25 @@ public:
     // Indicates if using the hi-res timer
     bool isHiRes() const { return _useHiResTimer; }
 
+    // Get the current monotonic time in microseconds
+    uint64_t getNowUs() const { return _nowUs; }
+    uint64_t getNowUs ( bool update ) { if ( update ) updateNow(); return _nowUs; }
+
+    // Query the monotonic time in microseconds without updating the current time, safe to call from any thread
+    static uint64_t queryNowUs();
+
     // Get the current time in milliseconds
-    uint64_t getNow() const { return _now; }
-    uint64_t getNow ( bool update ) { if ( update ) updateNow(); return _now; }
+    uint64_t getNow() const { return _nowUs / 1000; }
+    uint64_t getNow ( bool update ) { return getNowUs ( update ) / 1000; }
+
+    // Get the next time when a timer will expire in microseconds, UINT64_MAX if no timers are running
+    uint64_t getNextExpiryUs() const { return _nextExpiryUs; }
 
-    // Get the next time when a timer will expire
-    uint64_t getNextExpiry() const { return _nextExpiry; }
+    // Get the next time when a timer will expire in milliseconds, rounded up so it isn't before the expiry
+    uint64_t getNextExpiry() const
+    {
+        return ( _nextExpiryUs == UINT64_MAX ? UINT64_MAX : ( _nextExpiryUs + 999 ) / 1000 );
+    }
 
     // Get the singleton instance
     static TimerManager& get();
@@ -51,11 +64,11 @@ private:
     // Hi-res timer variables
     uint64_t _ticksPerSecond = 0, _ticks = 0;
 
-    // The current time in milliseconds
-    uint64_t _now = 0;
+    // The current time in microseconds
+    uint64_t _nowUs = 0;
 
-    // The next time when a timer will expire
-    uint64_t _nextExpiry = 0;
+    // The next time when a timer will expire in microseconds
+    uint64_t _nextExpiryUs = 0;
 
     // Flag to indicate the set of allocated timers has changed
     bool _changed = false;
@@ -11,6 +11,7 @@ static vector<Version> breakingVersions =
 {
     "2.1e", // Changed protocol by adding UdpControl::Disconnect
     "3.0a.019", // Changed round over logic
+    "3.1.007", // Changed PlayerInputs by adding round trip times, input delay and frame advantage, and PingStats by adding latency quantiles
 };
 
 
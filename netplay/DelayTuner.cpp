@@ -0,0 +1,119 @@
+#include "DelayTuner.hpp"
+#include "Messages.hpp"
+#include "Algorithms.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+
+// Same as computeDelay, but for a round trip time
+static int computeDelayFromRtt ( uint32_t rtt )
+{
+    return ( int ) ceil ( ( rtt / 2.0 ) / ( 1000.0 / 60 ) );
+}
+
+
+void DelayTuner::stamp ( PlayerInputs& playerInputs, uint64_t now ) const
+{
+    playerInputs.sendTime = uint32_t ( now );
+
+    if ( ! _remoteTime )
+        return;
+
+    playerInputs.echoTime = _remoteTime;
+    playerInputs.echoDelay = uint16_t ( min<uint64_t> ( now - _remoteReceived, UINT16_MAX ) );
+}
+
+void DelayTuner::received ( const PlayerInputs& playerInputs, uint64_t now )
+{
+    if ( playerInputs.sendTime )
+    {
+        _remoteTime = playerInputs.sendTime;
+        _remoteReceived = now;
+    }
+
+    if ( ! playerInputs.echoTime || playerInputs.echoTime == _lastEcho )
+        return;
+
+    _lastEcho = playerInputs.echoTime;
+
+    // The time the remote held our timestamp isn't part of the round trip
+    const uint32_t rtt = uint32_t ( now ) - playerInputs.echoTime - playerInputs.echoDelay;
+
+    if ( rtt <= DELAY_TUNER_MAX_RTT )
+        addSample ( rtt );
+}
+
+void DelayTuner::addSample ( uint32_t rtt )
+{
+    if ( _samples.size() < DELAY_TUNER_WINDOW )
+    {
+        _samples.push_back ( rtt );
+        return;
+    }
+
+    _samples[_next] = rtt;
+    _next = ( _next + 1 ) % DELAY_TUNER_WINDOW;
+}
+
+void DelayTuner::addRollback ( uint32_t depth )
+{
+    ++_numRollbacks;
+    _rollbackFrames += depth;
+}
+
+uint32_t DelayTuner::getRtt ( uint32_t percentile ) const
+{
+    if ( _samples.empty() )
+        return 0;
+
+    vector<uint32_t> sorted = _samples;
+    const size_t i = min ( sorted.size() - 1, sorted.size() * min ( percentile, 100u ) / 100 );
+
+    nth_element ( sorted.begin(), sorted.begin() + i, sorted.end() );
+    return sorted[i];
+}
+
+uint8_t DelayTuner::propose ( uint8_t delay, uint8_t rollback, uint8_t maxDelay )
+{
+    const uint32_t numRollbacks = _numRollbacks, rollbackFrames = _rollbackFrames;
+
+    _numRollbacks = _rollbackFrames = 0;
+
+    if ( _samples.size() < DELAY_TUNER_MIN_SAMPLES )
+        return delay;
+
+    // Enough delay that the rollback window covers almost every input, otherwise the game has to wait,
+    // and enough that most inputs only need a shallow rollback.
+    int target = max ( computeDelayFromRtt ( getRtt ( 99 ) ) - int ( rollback ),
+                       computeDelayFromRtt ( getRtt ( 90 ) ) - DELAY_TUNER_TARGET_DEPTH );
+
+    // The rollbacks that happened are deeper than the latency suggests, eg due to frame rate differences
+    if ( numRollbacks && rollbackFrames > numRollbacks * ( DELAY_TUNER_TARGET_DEPTH + 1 ) )
+        target = max ( target, delay + 1 );
+
+    target = clamped<int> ( target, 0, maxDelay );
+
+    LOG ( "rtt: p50=%u p90=%u p99=%u ms; rollbacks=%u frames=%u; delay=%u target=%d",
+          getRtt ( 50 ), getRtt ( 90 ), getRtt ( 99 ), numRollbacks, rollbackFrames, delay, target );
+
+    // Only move one frame at a time so a short latency spike doesn't swing the delay
+    if ( target > delay )
+        return delay + 1;
+
+    if ( target < delay )
+        return delay - 1;
+
+    return delay;
+}
+
+void DelayTuner::clear()
+{
+    _samples.clear();
+    _next = 0;
+    _remoteTime = _lastEcho = 0;
+    _remoteReceived = 0;
+    _numRollbacks = _rollbackFrames = 0;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+// Number of round trip time samples kept for the percentiles, about 10 seconds of input messages
+#define DELAY_TUNER_WINDOW          ( 600 )
+
+// Minimum number of round trip time samples before proposing a delay
+#define DELAY_TUNER_MIN_SAMPLES     ( 120 )
+
+// Rollback depth in frames that is acceptable for most inputs, more than this should be traded for delay
+#define DELAY_TUNER_TARGET_DEPTH    ( 3 )
+
+// Max proposed delay, same as the Ctrl + Number hotkeys
+#define DELAY_TUNER_MAX_DELAY       ( 9 )
+
+// Round trip times above this are dropped as invalid, in milliseconds
+#define DELAY_TUNER_MAX_RTT         ( 5000 )
+
+
+struct PlayerInputs;
+
+
+// Estimates the round trip time during a match from timestamps piggybacked on the input messages, and proposes the
+// input delay for the next round from the latency percentiles and the depth of the rollbacks that actually happened.
+class DelayTuner
+{
+public:
+
+    // Stamp outgoing inputs with the local time, echoing the last remote timestamp
+    void stamp ( PlayerInputs& playerInputs, uint64_t now ) const;
+
+    // Sample the round trip time from the echoed timestamp of incoming inputs
+    void received ( const PlayerInputs& playerInputs, uint64_t now );
+
+    // Add a round trip time sample in milliseconds
+    void addSample ( uint32_t rtt );
+
+    // Record a rollback of the given depth in frames
+    void addRollback ( uint32_t depth );
+
+    size_t getNumSamples() const { return _samples.size(); }
+
+    // Get the round trip time at the given percentile, from 0 to 100, in milliseconds
+    uint32_t getRtt ( uint32_t percentile ) const;
+
+    // Propose the input delay for the next round, given the current delay and rollback frames.
+    // The delay only moves one frame per call, and the rollback depths are reset after each call.
+    uint8_t propose ( uint8_t delay, uint8_t rollback, uint8_t maxDelay );
+
+    void clear();
+
+private:
+
+    // Circular buffer of the last round trip time samples
+    std::vector<uint32_t> _samples;
+
+    size_t _next = 0;
+
+    // Last remote timestamp and the local time it was received
+    uint32_t _remoteTime = 0;
+    uint64_t _remoteReceived = 0;
+
+    // Last echoed timestamp, so each round trip is only sampled once
+    uint32_t _lastEcho = 0;
+
+    // Rollbacks since the last proposal
+    uint32_t _numRollbacks = 0, _rollbackFrames = 0;
+};
@@ -0,0 +1,213 @@
+#include "InputPredictor.hpp"
+
+#include <unordered_map>
+#include <algorithm>
+
+using namespace std;
+
+
+// Direction bits of an input, see COMBINE_INPUT
+#define DIRECTION_MASK ( 0x000Fu )
+
+
+// Same input as the last confirmed input, this is the default behaviour without a predictor
+class HoldLastPredictor : public InputPredictor
+{
+public:
+
+    PredictorType getType() const override { return PredictorType::HoldLast; }
+
+    uint16_t predict ( uint32_t ahead ) const override { return _last; }
+};
+
+
+// Directions are held, but buttons that were just pressed are predicted to be released after a tap
+class ButtonReleasePredictor : public InputPredictor
+{
+public:
+
+    PredictorType getType() const override { return PredictorType::ButtonRelease; }
+
+    uint16_t predict ( uint32_t ahead ) const override
+    {
+        const uint16_t direction = ( _last & DIRECTION_MASK );
+
+        if ( _last == direction || _held >= PREDICTOR_HOLD_FRAMES )
+            return _last;
+
+        if ( _held + ahead > PREDICTOR_TAP_FRAMES )
+            return direction;
+
+        return _last;
+    }
+};
+
+
+// Learns from the confirmed inputs of this player how long each input is held, and what it changes to after each
+// hold duration. An input is predicted to change when most of the holds that lasted this long ended at this duration.
+class LearnedPredictor : public InputPredictor
+{
+public:
+
+    PredictorType getType() const override { return PredictorType::Learned; }
+
+    void observe ( uint16_t input ) override
+    {
+        // Only changes are counted, and only if the hold duration is known
+        if ( _held && input != _last )
+        {
+            Holds& holds = _holds[_last];
+            const uint32_t duration = min<uint32_t> ( _held, PREDICTOR_HOLD_FRAMES );
+
+            ++holds.ended[duration];
+
+            if ( duration < PREDICTOR_HOLD_FRAMES )
+            {
+                Next& next = holds.next[duration];
+                const uint32_t count = ++next.counts[input];
+
+                ++next.total;
+
+                if ( count > next.bestCount )
+                {
+                    next.best = input;
+                    next.bestCount = count;
+                }
+            }
+        }
+
+        InputPredictor::observe ( input );
+    }
+
+    uint16_t predict ( uint32_t ahead ) const override
+    {
+        uint16_t input = _last;
+        uint32_t held = _held;
+
+        // Without a hold duration since the last reset the input is held
+        if ( ! held )
+            return input;
+
+        for ( uint32_t i = 0; i < ahead; ++i )
+        {
+            const uint16_t next = predictNext ( input, held );
+
+            if ( next == input )
+            {
+                ++held;
+            }
+            else
+            {
+                input = next;
+                held = 1;
+            }
+        }
+
+        return input;
+    }
+
+private:
+
+    struct Next
+    {
+        unordered_map<uint16_t, uint32_t> counts;
+        uint32_t total = 0;
+        uint16_t best = 0;
+        uint32_t bestCount = 0;
+    };
+
+    struct Holds
+    {
+        // Number of holds that ended after each duration, the last entry counts the long holds
+        uint32_t ended[PREDICTOR_HOLD_FRAMES + 1] = { 0 };
+
+        // Mapping: hold duration -> next input -> count
+        Next next[PREDICTOR_HOLD_FRAMES];
+    };
+
+    // Mapping: input -> holds of that input
+    unordered_map<uint16_t, Holds> _holds;
+
+    // Predict the input after the given input has been held for the given number of frames
+    uint16_t predictNext ( uint16_t input, uint32_t held ) const
+    {
+        // Long holds are expected to continue
+        if ( held >= PREDICTOR_HOLD_FRAMES )
+            return input;
+
+        const auto it = _holds.find ( input );
+
+        if ( it == _holds.end() )
+            return input;
+
+        const Holds& holds = it->second;
+
+        // Number of holds that lasted at least this long
+        uint32_t lasted = 0;
+        for ( uint32_t i = held; i <= PREDICTOR_HOLD_FRAMES; ++i )
+            lasted += holds.ended[i];
+
+        const Next& next = holds.next[held];
+
+        // Only change if most holds this long ended here, and most of those changed to the same input
+        if ( lasted < PREDICTOR_MIN_SAMPLES
+                || holds.ended[held] * 2 <= lasted
+                || next.bestCount * 2 <= next.total )
+            return input;
+
+        return next.best;
+    }
+};
+
+
+void InputPredictor::observe ( uint16_t input )
+{
+    if ( _held && input == _last )
+    {
+        ++_held;
+        return;
+    }
+
+    _last = input;
+    _held = 1;
+}
+
+void InputPredictor::reset()
+{
+    // Keep the last input, since the next index continues from it until there are new inputs
+    _held = 0;
+}
+
+InputPredictor *InputPredictor::create ( PredictorType type )
+{
+    switch ( type.value )
+    {
+        case PredictorType::HoldLast:
+            return new HoldLastPredictor();
+
+        case PredictorType::ButtonRelease:
+            return new ButtonReleasePredictor();
+
+        case PredictorType::Learned:
+            return new LearnedPredictor();
+
+        default:
+            return 0;
+    }
+}
+
+PredictorType InputPredictor::parseType ( const string& name )
+{
+    const string lower = lowerCase ( name );
+
+    if ( lower == "hold" || lower == "holdlast" )
+        return PredictorType::HoldLast;
+
+    if ( lower == "release" || lower == "buttonrelease" )
+        return PredictorType::ButtonRelease;
+
+    if ( lower == "learned" )
+        return PredictorType::Learned;
+
+    return PredictorType::Unknown;
+}
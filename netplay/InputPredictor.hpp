@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Enum.hpp"
+
+#include <string>
+#include <cstdint>
+
+
+// Number of frames a button is expected to be tapped for
+#define PREDICTOR_TAP_FRAMES        ( 3 )
+
+// Number of frames after which a button is considered held, instead of tapped, and any input is predicted to stay held
+#define PREDICTOR_HOLD_FRAMES       ( 12 )
+
+// Minimum number of learned holds of an input, that lasted at least as long as the current one, before they are trusted
+#define PREDICTOR_MIN_SAMPLES       ( 8 )
+
+
+ENUM ( PredictorType, HoldLast, ButtonRelease, Learned );
+
+
+// Predicts the remote input for frames after the last confirmed input, when rollback runs ahead of the remote.
+// A predictor only sees the confirmed inputs in order, so the same history always gives the same predictions.
+class InputPredictor
+{
+public:
+
+    virtual ~InputPredictor() {}
+
+    virtual PredictorType getType() const = 0;
+
+    // Observe the next confirmed input
+    virtual void observe ( uint16_t input );
+
+    // Forget the inputs of the previous transition index, any learned statistics are kept
+    virtual void reset();
+
+    // Predict the input at the given number of frames after the last confirmed input, ahead starts from 1
+    virtual uint16_t predict ( uint32_t ahead ) const = 0;
+
+    // Create a predictor of the given type, returns 0 if unknown
+    static InputPredictor *create ( PredictorType type );
+
+    // Get a predictor type from its name, eg "learned", returns Unknown if invalid
+    static PredictorType parseType ( const std::string& name );
+
+protected:
+
+    // Last confirmed input
+    uint16_t _last = 0;
+
+    // Number of consecutive frames the last input was held, 0 if no inputs since reset
+    uint32_t _held = 0;
+};
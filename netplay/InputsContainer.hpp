@@ -2,12 +2,98 @@
 
 #include "Constants.hpp"
 #include "Logger.hpp"
+#include "Algorithms.hpp"
 
 #include <vector>
 #include <algorithm>
 
 
+// Initial number of indices in an InputsRing, this grows by doubling if needed
+#define INPUTS_RING_INDICES         ( 64 )
+
+// Number of frames reserved for each index in an InputsRing
+#define INPUTS_RING_FRAMES          ( 60 * 60 )
+
+
+// Ring of per-index frame buffers, this replaces std::vector<std::vector<T>> as the storage of an InputsContainer.
+// Erasing older indices only moves the head of the ring, and the frame buffers of erased indices are reused
+// with their capacity, so there is no allocation in the steady state. All the frames of the live indices are kept,
+// since they are needed for spectators and exporting replays.
 template<typename T>
+class InputsRing
+{
+public:
+
+    InputsRing() : _slots ( INPUTS_RING_INDICES ) {}
+
+    size_t size() const { return _size; }
+
+    bool empty() const { return ( _size == 0 ); }
+
+    std::vector<T>& operator[] ( size_t i ) { return _slots[ ( _head + i ) & ( _slots.size() - 1 ) ]; }
+
+    const std::vector<T>& operator[] ( size_t i ) const { return _slots[ ( _head + i ) & ( _slots.size() - 1 ) ]; }
+
+    std::vector<T>& back() { return ( *this ) [ _size - 1 ]; }
+
+    const std::vector<T>& back() const { return ( *this ) [ _size - 1 ]; }
+
+    // New indices are empty
+    void resize ( size_t size )
+    {
+        if ( size > _slots.size() )
+            grow ( size );
+
+        for ( size_t i = _size; i < size; ++i )
+        {
+            std::vector<T>& frames = ( *this ) [ i ];
+            frames.clear();
+
+            if ( frames.capacity() < INPUTS_RING_FRAMES )
+                frames.reserve ( INPUTS_RING_FRAMES );
+        }
+
+        _size = size;
+    }
+
+    void clear()
+    {
+        _head = 0;
+        _size = 0;
+    }
+
+    void eraseFront ( size_t count )
+    {
+        count = std::min ( count, _size );
+        _head = ( _head + count ) & ( _slots.size() - 1 );
+        _size -= count;
+    }
+
+private:
+
+    // Power of 2 number of frame buffers
+    std::vector<std::vector<T>> _slots;
+
+    size_t _head = 0, _size = 0;
+
+    void grow ( size_t size )
+    {
+        size_t capacity = _slots.size();
+        while ( capacity < size )
+            capacity *= 2;
+
+        std::vector<std::vector<T>> slots ( capacity );
+
+        for ( size_t i = 0; i < _size; ++i )
+            slots[i].swap ( ( *this ) [ i ] );
+
+        _slots.swap ( slots );
+        _head = 0;
+    }
+};
+
+
+template<typename T, typename S = std::vector<std::vector<T>>>
 class InputsContainer
 {
 public:
@@ -15,11 +101,13 @@ public:
     // Get a single input for the given index:frame, returns 0 if none.
     T get ( uint32_t index, uint32_t frame ) const
     {
+        T t;
+
         if ( index >= _inputs.size() || _inputs[index].empty() )
-            return lastInputBefore ( index );
+            return ( getPrediction ( index, frame, t ) ? t : lastInputBefore ( index ) );
 
         if ( frame >= _inputs[index].size() )
-            return _inputs[index].back();
+            return ( getPrediction ( index, frame, t ) ? t : _inputs[index].back() );
 
         return _inputs[index][frame];
     }
@@ -67,17 +155,17 @@ public:
     {
         if ( index >= checkStartingFromIndex )
         {
-            IndexedFrame f;
-            size_t i;
+            const size_t i = firstChanged ( index, frame, t, n );
 
-            for ( i = 0, f = {{ frame, index }}; i < n; ++i, ++f.parts.frame )
+            // Indicate changed if the input is different from the last known or predicted input
+            if ( i < n )
             {
-                if ( get ( f.parts.index, f.parts.frame ) == t[i] )
-                    continue;
-
-                // Indicate changed if the input is different from the last known input
+                const IndexedFrame f = {{ uint32_t ( frame + i ), index }};
                 _lastChangedFrame.value = std::min ( _lastChangedFrame.value, f.value );
-                break;
+
+                // The frames after the changed frame will be re-run, so they can be predicted again
+                if ( index == _predictionIndex )
+                    truncatePredictions ( f.parts.frame );
             }
         }
 
@@ -108,6 +196,36 @@ public:
     void clear()
     {
         _inputs.clear();
+        clearPredictions();
+    }
+
+    // Set the predicted input for a frame after the end of the given index, which is returned by get() until the
+    // actual input is set. Only predictions for one index are kept, and they should be set in increasing frames.
+    void setPrediction ( uint32_t index, uint32_t frame, T t )
+    {
+        if ( index != _predictionIndex || frame < _predictionStart || frame > _predictionStart + _predictions.size() )
+        {
+            _predictionIndex = index;
+            _predictionStart = frame;
+            _predictions.clear();
+        }
+
+        if ( frame == _predictionStart + _predictions.size() )
+            _predictions.push_back ( t );
+        else
+            _predictions[frame - _predictionStart] = t;
+    }
+
+    bool hasPrediction ( uint32_t index, uint32_t frame ) const
+    {
+        return ( index == _predictionIndex && frame >= _predictionStart
+                 && frame < _predictionStart + _predictions.size() );
+    }
+
+    void clearPredictions()
+    {
+        _predictionIndex = UINT_MAX;
+        _predictions.clear();
     }
 
     bool empty() const
@@ -147,9 +265,17 @@ public:
     void eraseIndexOlderThan ( size_t index )
     {
         if ( index + 1 >= _inputs.size() )
-            _inputs.clear();
+        {
+            clear();
+            return;
+        }
+
+        eraseFront ( _inputs, index );
+
+        if ( _predictionIndex != UINT_MAX && _predictionIndex >= index )
+            _predictionIndex -= index;
         else
-            _inputs.erase ( _inputs.begin(), _inputs.begin() + index );
+            clearPredictions();
     }
 
     IndexedFrame getLastChangedFrame() const
@@ -165,11 +291,93 @@ public:
 private:
 
     // Mapping: index -> frame -> input
-    std::vector<std::vector<T>> _inputs;
+    S _inputs;
 
     // Last frame of input that changed
     IndexedFrame _lastChangedFrame = MaxIndexedFrame;
 
+    // Predicted inputs for the frames [_predictionStart, _predictionStart + _predictions.size()) of one index
+    std::vector<T> _predictions;
+    uint32_t _predictionIndex = UINT_MAX;
+    uint32_t _predictionStart = 0;
+
+    bool getPrediction ( uint32_t index, uint32_t frame, T& t ) const
+    {
+        if ( ! hasPrediction ( index, frame ) )
+            return false;
+
+        t = _predictions[frame - _predictionStart];
+        return true;
+    }
+
+    void truncatePredictions ( uint32_t frame )
+    {
+        if ( frame <= _predictionStart )
+            _predictions.clear();
+        else if ( frame < _predictionStart + _predictions.size() )
+            _predictions.resize ( frame - _predictionStart );
+    }
+
+    // Get the offset of the first of n inputs that is different from get(), or n if they are all the same
+    size_t firstChanged ( uint32_t index, uint32_t frame, const T *t, size_t n ) const
+    {
+        const bool hasInputs = ( index < _inputs.size() && ! _inputs[index].empty() );
+        const size_t end = ( hasInputs ? _inputs[index].size() : 0 );
+        const T last = ( hasInputs ? _inputs[index].back() : lastInputBefore ( index ) );
+
+        size_t i = 0;
+
+        // Compare against the known inputs
+        if ( frame < end )
+        {
+            const size_t count = std::min<size_t> ( n, end - frame );
+
+            i = firstMismatch ( t, &_inputs[index][frame], count );
+
+            if ( i < count )
+                return i;
+        }
+
+        // Then the predicted inputs, or the last known input for frames without a prediction
+        while ( i < n )
+        {
+            const uint32_t f = frame + i;
+            size_t count, j;
+
+            if ( hasPrediction ( index, f ) )
+            {
+                count = std::min<size_t> ( n - i, _predictionStart + _predictions.size() - f );
+                j = firstMismatch ( t + i, &_predictions[f - _predictionStart], count );
+            }
+            else
+            {
+                count = n - i;
+
+                if ( index == _predictionIndex && f < _predictionStart )
+                    count = std::min<size_t> ( count, _predictionStart - f );
+
+                j = firstNotEqual ( t + i, last, count );
+            }
+
+            i += j;
+
+            if ( j < count )
+                return i;
+        }
+
+        return n;
+    }
+
+    static void eraseFront ( std::vector<std::vector<T>>& inputs, size_t count )
+    {
+        inputs.erase ( inputs.begin(), inputs.begin() + count );
+    }
+
+    static void eraseFront ( InputsRing<T>& inputs, size_t count )
+    {
+        inputs.eraseFront ( count );
+    }
+
     // Get the last known input BEFORE the given index. Defaults to 0 if unknown.
     T lastInputBefore ( uint32_t index ) const
     {
@@ -190,3 +398,8 @@ private:
         return 0;
     }
 };
+
+
+// InputsContainer with ring storage, see InputsRing
+template<typename T>
+using RingInputsContainer = InputsContainer<T, InputsRing<T>>;
@@ -415,6 +415,28 @@ struct SyncHash : public SerializableSequence
 };
 
 
+struct StateHash : public SerializableSequence
+{
+    IndexedFrame indexedFrame = {{ 0, 0 }};
+
+    // Hash of the full rollback state, see DllRollbackManager::saveState
+    uint64_t hash = 0;
+
+    StateHash ( IndexedFrame indexedFrame, uint64_t hash ) : indexedFrame ( indexedFrame ), hash ( hash ) {}
+
+    bool operator== ( const StateHash& other ) const
+    {
+        return ( indexedFrame.value == other.indexedFrame.value && hash == other.hash );
+    }
+
+    std::string str() const override { return format ( "StateHash[%s]", indexedFrame ); }
+
+    std::string dump() const { return format ( "[%s] %s", indexedFrame, formatAsHex ( &hash, sizeof ( hash ) ) ); }
+
+    PROTOCOL_MESSAGE_BOILERPLATE ( StateHash, indexedFrame.value, hash )
+};
+
+
 struct MenuIndex : public SerializableSequence
 {
     uint32_t index = 0;
@@ -486,11 +508,22 @@ struct PlayerInputs : public SerializableMessage, public BaseInputs
     // Represents the input range [frame - NUM_INPUTS + 1, frame + 1)
     std::array<uint16_t, NUM_INPUTS> inputs;
 
+    // Local time in milliseconds when sent, and the last remote sendTime received with the milliseconds since then.
+    // This samples the round trip time in-band, see DelayTuner. Zero if not set.
+    uint32_t sendTime = 0, echoTime = 0;
+    uint16_t echoDelay = 0;
+
+    // Input delay of the sender, so the receiver knows the sender's current frame, and the sender's frame advantage
+    // in eighths of a frame. These keep the frames of both sides aligned, see TimeSync.
+    uint8_t inputDelay = 0;
+    int8_t frameAdvantage = 0;
+
     PlayerInputs ( IndexedFrame indexedFrame ) { this->indexedFrame = indexedFrame; }
 
     std::string str() const override { return format ( "PlayerInputs[%s]", indexedFrame ); }
 
-    PROTOCOL_MESSAGE_BOILERPLATE ( PlayerInputs, indexedFrame.value, inputs )
+    PROTOCOL_MESSAGE_BOILERPLATE ( PlayerInputs, indexedFrame.value, inputs, sendTime, echoTime, echoDelay,
+                                   inputDelay, frameAdvantage )
 };
 
 
@@ -24,6 +24,9 @@ ENUM ( Options,
        DefaultRollback,
        Fullscreen,
        AutoReplaySave,
+       AutoDelay,
+       LogLevels,
+       BinarySyncLog,
        // Debug options
        FrameLimiter,
        Tests,
@@ -34,6 +37,7 @@ ENUM ( Options,
        PidLog,
        SyncTest,
        Replay,
+       Predictor,
        // Special options
        NoFork,
        AppDir,
@@ -1,5 +1,7 @@
 #include "ReplayCreator.hpp"
 #include "StringUtils.hpp"
+#include "MappedFile.hpp"
+#include "Algorithms.hpp"
 
 #include <iostream>
 #include <iomanip>
@@ -10,18 +12,19 @@
 #include <string.h>
 #include <sstream>
 #include <map>
+#include <climits>
 using namespace std;
 
 void ReplayCreator::dump(ReplayCreator::ReplayFile rf, char* fname) {
     ofstream outfile;
     outfile.open(fname, ios::binary | ios::out);
     //cout << "dumping" << endl;
-    outfile.write((char*)&rf, 0x60);
+    outfile.write((char*)static_cast<ReplayHeader*>(&rf), sizeof(ReplayHeader));
     //cout << rf.numRounds << endl;
     for (int j=0; j < rf.numRounds; ++j) {
       //cout << j << endl;
       ReplayCreator::Round round = rf.rounds[j];
-      outfile.write((char*)&round, 0x8C);
+      outfile.write((char*)static_cast<RoundStart*>(&round), sizeof(RoundStart));
       outfile.write((char*)&round.lenp1Inputs, 4);
       for (int i = 0; i < round.lenp1Inputs; ++i) {
         ReplayCreator::Input in = round.p1Inputs[i];
@@ -43,168 +46,109 @@ void ReplayCreator::dump(ReplayCreator::ReplayFile rf, char* fname) {
       for (int i = 0; i < round.lenRng; ++i) {
         outfile.write((char*)&round.rngstates[i], 4);
       }
-      outfile.write((char*)&round.nine, 4*36);
+      outfile.write((char*)static_cast<RoundEnd*>(&round), sizeof(RoundEnd));
     }
     outfile.close();
 }
 
-void ReplayCreator::load(ReplayCreator::ReplayFile* rf, char* fname) {
-    ifstream infile;
-    infile.open(fname, ios::binary | ios::in);
-    infile.read((char*)rf, 0x60);
-    //cout << formatAsHex((void*) rf, 0x60) << endl;
-    //cout << endl;
+static_assert ( sizeof ( ReplayCreator::ReplayHeader ) == 0x60, "Replay header size" );
+static_assert ( sizeof ( ReplayCreator::RoundStart ) == 0x8C, "Round start size" );
+static_assert ( sizeof ( ReplayCreator::RoundEnd ) == 144, "Round end size" );
+static_assert ( sizeof ( ReplayCreator::Input ) == 6, "Input size" );
+
+// Bounds checked reads from the replay data
+struct ReplayReader
+{
+    const char *data;
+    size_t size, pos;
+
+    size_t remaining() const { return size - pos; }
+
+    bool read ( void *dest, size_t bytes )
+    {
+        if ( remaining() < bytes )
+            return false;
+        memcpy ( dest, data + pos, bytes );
+        pos += bytes;
+        return true;
+    }
+
+    // Read a length prefixed array of fixed size elements
+    template<typename T>
+    bool readArray ( int& len, vector<T>& values )
+    {
+        if ( ! read ( &len, 4 ) || len < 0 || size_t ( len ) > remaining() / sizeof ( T ) )
+            return false;
+        values.resize ( len );
+        // Empty vectors may not have any storage
+        return ( len == 0 || read ( values.data(), len * sizeof ( T ) ) );
+    }
+};
+
+bool ReplayCreator::load(ReplayCreator::ReplayFile* rf, const char* fname) {
+    MappedFile file;
+    if ( ! file.open ( fname ) ) {
+        LOG( "Failed to read '%s'", fname );
+        return false;
+    }
+    return parse( rf, file.data(), file.size() );
+}
+
+bool ReplayCreator::parse(ReplayCreator::ReplayFile* rf, const char* data, size_t size) {
+    ReplayReader reader = { data, size, 0 };
+    rf->rounds.clear();
+    if ( ! reader.read( static_cast<ReplayHeader*>( rf ), sizeof( ReplayHeader ) ) ) {
+        LOG( "Replay header truncated" );
+        return false;
+    }
+    // Smallest possible round, so a bad round count can't allocate more than the file could hold
+    const size_t minRoundSize = sizeof( RoundStart ) + 5 * 4 + sizeof( RoundEnd );
+    if ( rf->numRounds < 0 || size_t( rf->numRounds ) > reader.remaining() / minRoundSize ) {
+        LOG( "Invalid round count %d", rf->numRounds );
+        return false;
+    }
+    rf->rounds.resize( rf->numRounds );
     for (int j=0; j < rf->numRounds; ++j) {
-      ReplayCreator::Round roundObj;
-      ReplayCreator::Round* round = &roundObj;
-      infile.read((char*)round, 0x8C);
-      //cout << formatAsHex((void*) round, 0x8c) << endl;
-      infile.read((char*)&(round->lenp1Inputs), 4);
-      //printf("Player1\n");
-      //printf("%d %d\n", round->lenp1Inputs, round->lenp2Inputs);
-      ReplayCreator::Input in;
-      for (int i = 0; i < round->lenp1Inputs; ++i) {
-        infile.read((char*)&in, 6);
-        round->p1Inputs.push_back(in);
-      }
-      infile.read((char*)&(round->lenp2Inputs), 4);
-      //printf("Player2\n");
-      //printf("%d %d\n", round->lenp1Inputs, round->lenp2Inputs);
-      for (int i = 0; i < round->lenp2Inputs; ++i) {
-        infile.read((char*)&in, 6);
-        //cout << formatAsHex((void*) &in, 6) << endl;
-        //cout << "preprint" << endl;
-        //printInput2(in);
-        //cout << "postprint" << endl;
-        round->p2Inputs.push_back(in);
-      }
-      // A copy of p1/p2's inputs, with some directions changed. May or not appear.
+      ReplayCreator::Round& round = rf->rounds[j];
+      // A copy of p1/p2's inputs, with some directions changed, is in p3/p4. May or not appear.
       // Don't know why this exists either, doesn't seem to do anything
       // Probably something to do with controllers
-      infile.read((char*)&(round->lenp3Inputs), 4);
-      //cout << formatAsHex((void*) &(round->lenp3Inputs), 4) << endl;
-      //printf("Player3\n");
-      //printf("%d\n", round->lenp3Inputs);
-      for (int i = 0; i < round->lenp3Inputs; ++i) {
-          infile.read((char*)&in, 6);
-          //cout << formatAsHex((void*) &in, 6) << endl;
-          //cout << "preprint" << endl;
-          //printInput2(in);
-          //cout << "postprint" << endl;
-          round->p3Inputs.push_back(in);
-      }
-      infile.read((char*)&(round->lenp4Inputs), 4);
-      //printf("Player4\n");
-      //printf("%d\n", round->lenp4Inputs);
-      for (int i = 0; i < round->lenp4Inputs; ++i) {
-          infile.read((char*)&in, 6);
-          //cout << formatAsHex((void*) &in, 6) << endl;
-          //cout << "preprint" << endl;
-          //printInput2(in);
-          //cout << "postprint" << endl;
-          round->p4Inputs.push_back(in);
-      }
-
-      infile.read((char*)&(round->lenRng), 4);
-      int tmp;
-      for (int i = 0; i < round->lenRng; ++i) {
-        infile.read((char*)&tmp, 4);
-        //cout << formatAsHex((void*) &tmp, 4) << endl;
-        round->rngstates.push_back(tmp);
+      if ( ! reader.read( static_cast<RoundStart*>( &round ), sizeof( RoundStart ) ) ||
+           ! reader.readArray( round.lenp1Inputs, round.p1Inputs ) ||
+           ! reader.readArray( round.lenp2Inputs, round.p2Inputs ) ||
+           ! reader.readArray( round.lenp3Inputs, round.p3Inputs ) ||
+           ! reader.readArray( round.lenp4Inputs, round.p4Inputs ) ||
+           ! reader.readArray( round.lenRng, round.rngstates ) ||
+           ! reader.read( static_cast<RoundEnd*>( &round ), sizeof( RoundEnd ) ) ) {
+        LOG( "Replay round %d truncated at offset %u", j, uint32_t( reader.pos ) );
+        rf->rounds.clear();
+        return false;
       }
-      infile.read((char*)&(round->nine), 144);
-      //cout << formatAsHex((void*) round->nine, 144) << endl;
-      //cout << "aa" << endl;
-      rf->rounds.push_back(roundObj);
     }
+    return true;
 }
-void ReplayCreator::fixReplay(ReplayCreator::ReplayFile* rf, char* fname, MoveData* prior) {
-    //cout << "fix replay" << endl;
-    LOG( "asdf" );
-    ifstream infile;
-    infile.open(fname);
-    string line;
-    getline(infile,line);
-    //cout << line << endl;
-    int rounds = stoi(line);
-    LOG( "line: %s", line);
-    //cout << "rounds " << rounds << endl;
-    LOG( "rounds: %d", rounds );
-    for (int i = 0; i < rounds; ++i) {
+void ReplayCreator::fixReplay(ReplayCreator::ReplayFile* rf, char* fname, MoveData*) {
+    RawReplay rounds;
+    if ( ! loadRawInputs( rounds, fname ) )
+        return;
+    fixReplay( rf, rounds );
+}
+
+void ReplayCreator::fixReplay(ReplayCreator::ReplayFile* rf, const RawReplay& rounds) {
+    LOG( "rounds: %d", rounds.size() );
+    for (size_t i = 0; i < rounds.size() && i < rf->rounds.size(); ++i) {
         rf->rounds[i].p1Inputs.clear();
         rf->rounds[i].p2Inputs.clear();
-        getline(infile,line);
-        LOG( "line: %s", line);
-        int frames = stoi(line);
         LOG( "round number: %d", i);
-        LOG( "frames: %d", frames );
-        //cout << "round number  " << i << endl;
-        //cout << "frames " << frames << endl;
-
-        MoveData p1data = {};
-        MoveData p2data = {};
-
-        /*
-        int duration = 0;
-        int numInputs = 0;
-        uint8_t button = 0;
-        uint8_t lastButton = 0;
-        uint8_t direction = 0;
-        uint8_t lastDirection = 0;
-        uint8_t down = 0;
-        uint8_t lastDown = 0;
-        uint8_t up = 0;
-        uint8_t lastUp = 0;
-        bool last = true;
-
-        int duration2 = 0;
-        int numInputs2 = 0;
-        uint8_t button2 = 0;
-        uint8_t lastButton2 = 0;
-        uint8_t direction2 = 0;
-        uint8_t lastDirection2 = 0;
-        uint8_t down2 = 0;
-        uint8_t lastDown2 = 0;
-        uint8_t up2 = 0;
-        uint8_t lastUp2 = 0;
-        bool last2 = true;
-        */
-
-        vector<string> frameInputs1;
-        vector<string> frameInputs2;
-        for (int j = 0; j < frames; ++j) {
-            string p1Input;
-            string p2Input;
-            getline(infile,p1Input,' ');
-            //LOG( "p1Input: %s", p1Input);
-            getline(infile,p2Input);
-            //LOG( "p2Input: %s", p2Input);
-            frameInputs1.push_back( p1Input );
-            frameInputs2.push_back( p2Input );
-
-        }
-        //cout << "endframeread" << endl;
-        //cout << "p1 " <<  endl;
-        LOG( "writeInputs" );
+        LOG( "frames: %d", rounds[i][0].size() );
         writeInputs( rf->rounds[i].p1Inputs,
-                     frameInputs1,
+                     rounds[i][0],
                      NULL );
-                     //&prior[0] );
-        //cout << "p2 " << endl;
-        //frameInputs2.erase(frameInputs2.begin(), frameInputs2.begin()+3);
         writeInputs( rf->rounds[i].p2Inputs,
-                     frameInputs2, NULL ); //&prior[1] );
+                     rounds[i][1], NULL );
         rf->rounds[i].lenp1Inputs = rf->rounds[i].p1Inputs.size();
         rf->rounds[i].lenp2Inputs = rf->rounds[i].p2Inputs.size();
-
-    }
-
-    for (Input in : rf->rounds[0].p1Inputs ) {
-      //printInput2(in);
     }
-
-    //cout << "endfix" << endl;
-
 }
 
 uint8_t ReplayCreator::getDirection(unsigned int x) {
@@ -440,8 +384,7 @@ void ReplayCreator::printInput( ReplayCreator::Input input ) {
 }
 
 void ReplayCreator::readFrameInput( ReplayCreator::MoveData* m,
-                                    string frameInput ) {
-    unsigned int rawinput = std::stoul(frameInput, nullptr, 16);
+                                    unsigned int rawinput ) {
     m->direction = getDirection(rawinput);
     m->button = getButton(rawinput);
     m->down = BUTTON_DOWN(m->lastButton, m->button);
@@ -459,7 +402,7 @@ void ReplayCreator::copyToInput( ReplayCreator::MoveData* m,
 
 
 void ReplayCreator::writeInputs( vector<ReplayCreator::Input> &inputs,
-                                 vector<string> &rawinputs, MoveData* prior ) {
+                                 const vector<uint16_t> &rawinputs, MoveData* prior ) {
     MoveData data = {};
     bool first = true;
     bool printing = false;
@@ -468,7 +411,7 @@ void ReplayCreator::writeInputs( vector<ReplayCreator::Input> &inputs,
     input.button4 = 0;
     //cout << "writeInputs " << endl;
     int loc = 0;
-    for ( string s : rawinputs ) {
+    for ( uint16_t s : rawinputs ) {
         if (printing) {
           cout << "rawstring " << s << endl;
           cout << data.duration << endl;
@@ -611,3 +554,221 @@ void ReplayCreator::printReplay( ReplayFile* rf, int start, int end, int round)
       printInput3(p2[i]);
   }
 }
+
+void ReplayCreator::expandInputs( const vector<Input>& inputs, FrameInputs& frames ) {
+    size_t total = 0;
+    for ( const Input& input : inputs )
+        total += input.duration;
+    frames.resize( total );
+    uint16_t *frame = frames.data();
+    for ( const Input& input : inputs ) {
+        frame = fill_n( frame, input.duration, uint16_t( input.direction | ( input.buttonHold << 8 ) ) );
+    }
+}
+
+void ReplayCreator::expandReplay( ReplayFile* rf, FrameReplay& frames ) {
+    frames.resize( rf->rounds.size() );
+    for ( size_t i = 0; i < rf->rounds.size(); ++i ) {
+        expandInputs( rf->rounds[i].p1Inputs, frames[i][0] );
+        expandInputs( rf->rounds[i].p2Inputs, frames[i][1] );
+    }
+}
+
+// Read a number and skip to the next space or line, returns false at the end of the data
+static bool readNumber( const char*& pos, const char* end, int base, uint32_t& value ) {
+    const char *start = pos;
+    for ( value = 0; pos < end; ++pos ) {
+        const char c = *pos;
+        uint32_t digit;
+        if ( c >= '0' && c <= '9' )
+            digit = c - '0';
+        else if ( base == 16 && c >= 'a' && c <= 'f' )
+            digit = c - 'a' + 10;
+        else if ( base == 16 && c >= 'A' && c <= 'F' )
+            digit = c - 'A' + 10;
+        else
+            break;
+        value = value * base + digit;
+    }
+    if ( pos == start )
+        return false;
+    while ( pos < end && ( *pos == ' ' || *pos == '\r' || *pos == '\n' ) )
+        ++pos;
+    return true;
+}
+
+bool ReplayCreator::loadRaw( FrameReplay& frames, const char* fname ) {
+    RawReplay rounds;
+    if ( ! loadRawInputs( rounds, fname ) )
+        return false;
+    frames.resize( rounds.size() );
+    for ( size_t i = 0; i < rounds.size(); ++i ) {
+        for ( int p = 0; p < 2; ++p ) {
+            frames[i][p].resize( rounds[i][p].size() );
+            for ( size_t j = 0; j < rounds[i][p].size(); ++j )
+                frames[i][p][j] = getDirection( rounds[i][p][j] ) | ( getButton( rounds[i][p][j] ) << 8 );
+        }
+    }
+    return true;
+}
+
+bool ReplayCreator::loadRawInputs( RawReplay& rounds, const char* fname ) {
+    MappedFile file;
+    if ( ! file.open( fname ) ) {
+        LOG( "Failed to read '%s'", fname );
+        rounds.clear();
+        return false;
+    }
+    if ( ! parseRawInputs( rounds, file.data(), file.size() ) ) {
+        LOG( "'%s' is truncated", fname );
+        return false;
+    }
+    return true;
+}
+
+bool ReplayCreator::parseRawInputs( RawReplay& rounds, const char* data, size_t size ) {
+    rounds.clear();
+    const size_t header = sizeof( REPLAY_RAW_MAGIC ) - 1;
+    if ( size > header && memcmp( data, REPLAY_RAW_MAGIC, header ) == 0 ) {
+        if ( data[header] != REPLAY_RAW_VERSION ) {
+            LOG( "Unsupported .repraw version %u", uint8_t( data[header] ) );
+            return false;
+        }
+        // Each round is the number of frames, then the inputs of p1, then the inputs of p2
+        ReplayReader reader = { data, size, header + 1 };
+        uint32_t numRounds, numFrames;
+        if ( ! reader.read( &numRounds, 4 ) || numRounds > reader.remaining() / 4 )
+            return false;
+        rounds.resize( numRounds );
+        for ( uint32_t i = 0; i < numRounds; ++i ) {
+            if ( ! reader.read( &numFrames, 4 ) || numFrames > reader.remaining() / 4 ) {
+                rounds.clear();
+                return false;
+            }
+            for ( int p = 0; p < 2; ++p ) {
+                rounds[i][p].resize( numFrames );
+                if ( numFrames )
+                    reader.read( rounds[i][p].data(), numFrames * 2 );
+            }
+        }
+        return true;
+    }
+    // Text, the number of rounds, then each round is the number of frames followed by a line of inputs per frame
+    const char *pos = data, *end = data + size;
+    uint32_t numRounds, numFrames, p1, p2;
+    // Each frame is at least 4 characters
+    if ( ! readNumber( pos, end, 10, numRounds ) || numRounds > size / 4 )
+        return false;
+    rounds.resize( numRounds );
+    for ( uint32_t i = 0; i < numRounds; ++i ) {
+        if ( ! readNumber( pos, end, 10, numFrames ) || numFrames > size_t( end - pos ) / 4 ) {
+            rounds.clear();
+            return false;
+        }
+        rounds[i][0].resize( numFrames );
+        rounds[i][1].resize( numFrames );
+        for ( uint32_t j = 0; j < numFrames; ++j ) {
+            if ( ! readNumber( pos, end, 16, p1 ) || ! readNumber( pos, end, 16, p2 ) ) {
+                rounds.clear();
+                return false;
+            }
+            rounds[i][0][j] = p1;
+            rounds[i][1][j] = p2;
+        }
+    }
+    return true;
+}
+
+bool ReplayCreator::dumpRaw( const RawReplay& rounds, const char* fname ) {
+    string data ( REPLAY_RAW_MAGIC );
+    data += char( REPLAY_RAW_VERSION );
+    const auto append = [&]( const void *bytes, size_t len ) { data.append( ( const char* ) bytes, len ); };
+    const uint32_t numRounds = rounds.size();
+    append( &numRounds, 4 );
+    for ( const auto& round : rounds ) {
+        // Both players have the frames of p1, like the text export
+        const uint32_t numFrames = round[0].size();
+        append( &numFrames, 4 );
+        append( round[0].data(), numFrames * 2 );
+        vector<uint16_t> p2 = round[1];
+        p2.resize( numFrames, p2.empty() ? 0 : p2.back() );
+        append( p2.data(), numFrames * 2 );
+    }
+    FILE *fp = fopen( fname, "wb" );
+    if ( ! fp ) {
+        LOG( "Failed to open '%s'", fname );
+        return false;
+    }
+    const bool written = ( fwrite( data.data(), 1, data.size(), fp ) == data.size() );
+    fclose( fp );
+    return written;
+}
+
+vector<ReplayCreator::RoundDiff> ReplayCreator::diffFrames( const FrameReplay& a, const FrameReplay& b ) {
+    static const FrameInputs none;
+    vector<RoundDiff> diffs( max( a.size(), b.size() ) );
+    for ( size_t r = 0; r < diffs.size(); ++r ) {
+        RoundDiff& diff = diffs[r];
+        diff.round = r;
+        for ( int p = 0; p < 2; ++p ) {
+            const FrameInputs& x = ( r < a.size() ? a[r][p] : none );
+            const FrameInputs& y = ( r < b.size() ? b[r][p] : none );
+            const size_t n = min( x.size(), y.size() );
+            diff.frames[0][p] = x.size();
+            diff.frames[1][p] = y.size();
+            diff.firstDiff[p] = UINT_MAX;
+            diff.numDiffs[p] = 0;
+            // Jump from mismatch to mismatch, so matching frames are only compared 16 at a time
+            for ( size_t i = firstMismatch( x.data(), y.data(), n ); i < n;
+                  i += 1 + firstMismatch( x.data() + i + 1, y.data() + i + 1, n - i - 1 ) ) {
+                if ( diff.firstDiff[p] == UINT_MAX )
+                    diff.firstDiff[p] = i;
+                ++diff.numDiffs[p];
+            }
+            if ( x.size() != y.size() ) {
+                if ( diff.firstDiff[p] == UINT_MAX )
+                    diff.firstDiff[p] = n;
+                diff.numDiffs[p] += max( x.size(), y.size() ) - n;
+            }
+        }
+    }
+    return diffs;
+}
+
+bool ReplayCreator::findRngStateDiff( const ReplayFile* rf1, const ReplayFile* rf2, int round, uint32_t& index ) {
+    // numRounds comes from the file, so it can claim more rounds than were read
+    if ( round < 0 || size_t( round ) >= rf1->rounds.size() || size_t( round ) >= rf2->rounds.size() )
+        return false;
+    const vector<uint32_t>& a = rf1->rounds[round].rngstates;
+    const vector<uint32_t>& b = rf2->rounds[round].rngstates;
+    const size_t n = min( a.size(), b.size() );
+    const size_t i = firstMismatch( a.data(), b.data(), n );
+    index = ( i == n && a.size() == b.size() ? UINT_MAX : uint32_t( i ) );
+    return true;
+}
+
+string ReplayCreator::formatDiff( const FrameReplay& a, const FrameReplay& b, const RoundDiff& diff, int context ) {
+    static const FrameInputs none;
+    const auto frameStr = [&]( const FrameInputs& frames, size_t i ) -> string {
+        if ( i >= frames.size() )
+            return "-";
+        return getDirIcon( frames[i] & 0xFF ) + " " + getButtonIcon( frames[i] >> 8 );
+    };
+    string str;
+    char buf[64];
+    for ( int p = 0; p < 2; ++p ) {
+        if ( diff.firstDiff[p] == UINT_MAX )
+            continue;
+        const FrameInputs& x = ( size_t( diff.round ) < a.size() ? a[diff.round][p] : none );
+        const FrameInputs& y = ( size_t( diff.round ) < b.size() ? b[diff.round][p] : none );
+        sprintf( buf, "round %d p%d: %u frames differ\n", diff.round, p + 1, diff.numDiffs[p] );
+        str += buf;
+        const size_t first = diff.firstDiff[p];
+        const size_t last = min( first + context, max( x.size(), y.size() ) - 1 );
+        for ( size_t i = ( first > size_t( context ) ? first - context : 0 ); i <= last; ++i ) {
+            sprintf( buf, "%8u%s ", uint32_t( i ), ( i == first ? " <---" : "     " ) );
+            str += buf + frameStr( x, i ) + "\t| " + frameStr( y, i ) + "\n";
+        }
+    }
+    return str;
+}
@@ -5,8 +5,13 @@
 #define FILE_HEADER "MBAAReplayFile\0\0"
 #define UNK1 0x040000c0
 
+// Magic bytes at the start of a binary .repraw export, followed by a single version byte
+#define REPLAY_RAW_MAGIC "CCREPRAW"
+#define REPLAY_RAW_VERSION ( 1 )
+
 #include <iostream>
 #include <vector>
+#include <array>
 #include <string>
 #include "Logger.hpp"
 
@@ -57,22 +62,17 @@ public:
       }
     };
 
-    struct Round
+    // Fixed size parts of a round, these are stored as is in the file
+    struct RoundStart
     {
       //seems to affect CPU AI
       char unkrng1[44];
       char z2[88];
       char fdataStart[8];
-      int lenp1Inputs;
-      std::vector<Input> p1Inputs;
-      int lenp2Inputs;
-      std::vector<Input> p2Inputs;
-      int lenp3Inputs;
-      std::vector<Input> p3Inputs;
-      int lenp4Inputs;
-      std::vector<Input> p4Inputs;
-      int lenRng;
-      std::vector<uint32_t> rngstates;
+    };
+
+    struct RoundEnd
+    {
       char nine[4];
       //maybe draw state?Only on draw final round, blackscreens if FF->0
       char zeroOrFF[4];
@@ -91,7 +91,21 @@ public:
       char p4StartingMeter[4];
     };
 
-    struct ReplayFile
+    struct Round : RoundStart, RoundEnd
+    {
+      int lenp1Inputs;
+      std::vector<Input> p1Inputs;
+      int lenp2Inputs;
+      std::vector<Input> p2Inputs;
+      int lenp3Inputs;
+      std::vector<Input> p3Inputs;
+      int lenp4Inputs;
+      std::vector<Input> p4Inputs;
+      int lenRng;
+      std::vector<uint32_t> rngstates;
+    };
+
+    struct ReplayHeader
     {
       char headername[16];
       char unk1[4];
@@ -111,9 +125,37 @@ public:
       CharData p1;
       CharData p2;
       int numRounds;
+    };
+
+    // In the file each round is the RoundStart, then each inputs array and the RNG states prefixed by their
+    // lengths, then the RoundEnd
+    struct ReplayFile : ReplayHeader
+    {
       std::vector<Round> rounds;
     };
 
+    // Per frame inputs of one player, the direction in the low byte and the held buttons in the high byte
+    typedef std::vector<uint16_t> FrameInputs;
+
+    // Per frame inputs of both players in each round
+    typedef std::vector<std::array<FrameInputs, 2>> FrameReplay;
+
+    // Raw game inputs of both players in each round, as exported to .repraw
+    typedef std::vector<std::array<std::vector<uint16_t>, 2>> RawReplay;
+
+    struct RoundDiff
+    {
+      int round;
+      // Number of frames of each player, in each replay
+      uint32_t frames[2][2];
+      // First frame that differs for each player, or UINT_MAX if there isn't one
+      uint32_t firstDiff[2];
+      // Number of frames that differ for each player, including the frames only one replay has
+      uint32_t numDiffs[2];
+
+      bool differs() const { return numDiffs[0] || numDiffs[1]; }
+    };
+
     struct MoveData
     {
       int duration = 0;
@@ -130,8 +172,13 @@ public:
     };
 
     void dump( ReplayFile rf, char* fname );
-    void load( ReplayFile* rf, char* fname );
+    // Read the whole file and parse it, returns false if it can't be read or is truncated
+    bool load( ReplayFile* rf, const char* fname );
+    // Parse a replay in memory, every length is checked against the remaining data
+    bool parse( ReplayFile* rf, const char* data, size_t size );
     void fixReplay( ReplayFile* rf, char* fname, MoveData* prior );
+    // Replace the inputs of each round with the raw inputs
+    void fixReplay( ReplayFile* rf, const RawReplay& rounds );
     uint8_t getButton( unsigned int x );
     uint8_t getDirection( unsigned int x );
     std::string getDirIcon( uint8_t x );
@@ -144,13 +191,31 @@ public:
     void printInput2( Input input );
     void printInput3( Input input );
     void printReplay( ReplayFile* rf, int start, int end, int round);
-    void readFrameInput( MoveData* m, std::string frameinput );
+    void readFrameInput( MoveData* m, unsigned int rawinput );
     void copyToInput( MoveData* m, Input &input );
     void writeInputs( std::vector<Input> &inputs,
-                      std::vector<std::string> &rawinputs,
+                      const std::vector<uint16_t> &rawinputs,
                       MoveData* prior );
     void fixRng( ReplayFile* rf, char* fname );
 
+    // Expand the run length inputs to one entry per frame
+    void expandInputs( const std::vector<Input>& inputs, FrameInputs& frames );
+    void expandReplay( ReplayFile* rf, FrameReplay& frames );
+    // Read the per frame inputs of a .repraw export
+    bool loadRaw( FrameReplay& frames, const char* fname );
+    // Read the raw inputs of a .repraw export, either text or binary
+    bool loadRawInputs( RawReplay& rounds, const char* fname );
+    bool parseRawInputs( RawReplay& rounds, const char* data, size_t size );
+    // Write the raw inputs as a binary .repraw
+    bool dumpRaw( const RawReplay& rounds, const char* fname );
+    // Diff the per frame inputs of every round with SIMD compares, a round only one replay has differs on every frame
+    std::vector<RoundDiff> diffFrames( const FrameReplay& a, const FrameReplay& b );
+    // Index of the first RNG state that differs in the round, or UINT_MAX if there isn't one.
+    // Returns false if either replay doesn't have the round.
+    bool findRngStateDiff( const ReplayFile* rf1, const ReplayFile* rf2, int round, uint32_t& index );
+    // The frames around the first difference of each player, side by side
+    std::string formatDiff( const FrameReplay& a, const FrameReplay& b, const RoundDiff& diff, int context );
+
 private:
     int test;
 };
@@ -0,0 +1,140 @@
+#include "ReplayExporter.hpp"
+#include "Logger.hpp"
+
+#include <cstdio>
+
+using namespace std;
+
+
+ReplayExporter::~ReplayExporter()
+{
+    if ( ! _thread )
+        return;
+
+    // At process exit the export thread may have already been terminated, so it can't be joined.
+    // The queued exports are only written if it wasn't terminated in the middle of an export.
+    _thread->release();
+    _thread.release();
+
+    TryLock exportLock ( _exportMutex );
+    TryLock lock ( _mutex );
+
+    if ( ! exportLock.isLocked() || ! lock.isLocked() )
+        return;
+
+    for ( Export& e : _queue )
+        write ( e );
+}
+
+void ReplayExporter::exportInputs ( const string& rawFile, ReplayCreator::RawReplay&& rounds,
+                                    const string& repFile, const string& fixedRepFile )
+{
+    Export e;
+    e.file = rawFile;
+    e.rounds = move ( rounds );
+    e.repFile = repFile;
+    e.fixedRepFile = fixedRepFile;
+
+    queue ( move ( e ) );
+}
+
+void ReplayExporter::appendLine ( const string& file, const string& line )
+{
+    Export e;
+    e.kind = Export::Line;
+    e.file = file;
+    e.line = line;
+
+    queue ( move ( e ) );
+}
+
+void ReplayExporter::close()
+{
+    if ( ! _thread )
+        return;
+
+    {
+        LOCK ( _mutex );
+        _running = false;
+        _cond.signal();
+    }
+
+    // The export thread writes the rest before stopping
+    _thread->join();
+    _thread.reset();
+}
+
+void ReplayExporter::queue ( Export&& e )
+{
+    LOCK ( _mutex );
+
+    _queue.push_back ( move ( e ) );
+
+    if ( ! _thread )
+    {
+        _running = true;
+        _thread.reset ( new ExportThread ( *this ) );
+        _thread->start();
+    }
+
+    _cond.signal();
+}
+
+void ReplayExporter::write ( Export& e )
+{
+    ReplayCreator creator;
+
+    if ( e.kind == Export::Line )
+    {
+        FILE *fp = fopen ( e.file.c_str(), "a" );
+
+        if ( ! fp )
+        {
+            LOG ( "Failed to open '%s'", e.file );
+            return;
+        }
+
+        fprintf ( fp, "%s\n", e.line.c_str() );
+        fclose ( fp );
+        return;
+    }
+
+    if ( ! creator.dumpRaw ( e.rounds, e.file.c_str() ) || e.repFile.empty() )
+        return;
+
+    ReplayCreator::ReplayFile rf;
+
+    if ( ! creator.load ( &rf, e.repFile.c_str() ) )
+        return;
+
+    creator.fixReplay ( &rf, e.rounds );
+    creator.dump ( rf, &e.fixedRepFile[0] );
+}
+
+void ReplayExporter::ExportThread::run()
+{
+    for ( ;; )
+    {
+        Export e;
+
+        {
+            Lock lock ( context._mutex );
+
+            while ( context._running && context._queue.empty() )
+                context._cond.wait ( context._mutex );
+
+            if ( context._queue.empty() )
+                return;
+
+            e = move ( context._queue.front() );
+            context._queue.pop_front();
+
+            // Taken before releasing _mutex, so the destructor can't see the export as neither queued nor started
+            context._exportMutex.lock();
+        }
+
+        write ( e );
+
+        context._exportMutex.unlock();
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "ReplayCreator.hpp"
+#include "Thread.hpp"
+
+#include <string>
+#include <deque>
+#include <memory>
+
+
+// Writes replay and result exports from a background thread, so the game thread only takes a snapshot.
+// The thread is started by the first export, and exports are written in the order they were queued.
+class ReplayExporter
+{
+public:
+
+    ~ReplayExporter();
+
+    // Write the raw inputs as a binary .repraw. Then if repFile is set, load that replay, replace its inputs with the
+    // raw inputs, and dump it to fixedRepFile.
+    void exportInputs ( const std::string& rawFile, ReplayCreator::RawReplay&& rounds,
+                        const std::string& repFile = "", const std::string& fixedRepFile = "" );
+
+    // Append a line to a text file
+    void appendLine ( const std::string& file, const std::string& line );
+
+    // Write everything queued and stop the thread
+    void close();
+
+private:
+
+    struct Export
+    {
+        enum Kind { Inputs, Line } kind = Inputs;
+
+        std::string file;
+
+        // Line to append, for Line exports
+        std::string line;
+
+        ReplayCreator::RawReplay rounds;
+
+        std::string repFile, fixedRepFile;
+    };
+
+    THREAD ( ExportThread, ReplayExporter );
+
+    std::unique_ptr<ExportThread> _thread;
+
+    bool _running = false;
+
+    // Exports not yet started, guarded by _mutex
+    std::deque<Export> _queue;
+
+    // Held while writing an export, and to queue exports or wake the thread
+    Mutex _exportMutex, _mutex;
+    CondVar _cond;
+
+    void queue ( Export&& e );
+
+    static void write ( Export& e );
+};
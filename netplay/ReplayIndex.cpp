@@ -0,0 +1,427 @@
+#include "ReplayIndex.hpp"
+#include "ReplayCreator.hpp"
+#include "CharacterSelect.hpp"
+#include "MappedFile.hpp"
+#include "Logger.hpp"
+
+#include <unordered_map>
+#include <algorithm>
+#include <memory>
+#include <cstring>
+#include <cctype>
+
+using namespace std;
+
+
+static_assert ( sizeof ( ReplayIndexEntry ) == 48, "Replay index entry size" );
+
+struct ReplayIndexHeader
+{
+    char magic[8];
+
+    uint32_t version, numEntries, pathsSize, reserved;
+};
+
+
+static bool equalsIgnoreCase ( const string& a, const string& b )
+{
+    if ( a.size() != b.size() )
+        return false;
+
+    for ( size_t i = 0; i < a.size(); ++i )
+        if ( tolower ( ( unsigned char ) a[i] ) != tolower ( ( unsigned char ) b[i] ) )
+            return false;
+
+    return true;
+}
+
+// Character with the short name, or REPLAY_INDEX_ANY if there isn't one
+static uint8_t findChara ( const string& name )
+{
+    static const vector<pair<string, uint8_t>> charas = []
+    {
+        vector<pair<string, uint8_t>> charas;
+
+        for ( uint32_t i = 0; i < REPLAY_INDEX_ANY; ++i )
+            if ( strcmp ( getShortCharaName ( i ), "Unknown!" ) != 0 )
+                charas.push_back ( { getShortCharaName ( i ), i } );
+
+        return charas;
+    } ();
+
+    for ( const auto& chara : charas )
+        if ( equalsIgnoreCase ( chara.first, name ) )
+            return chara.second;
+
+    return REPLAY_INDEX_ANY;
+}
+
+static bool endsWith ( const string& str, const string& suffix )
+{
+    return ( str.size() >= suffix.size() && str.compare ( str.size() - suffix.size(), suffix.size(), suffix ) == 0 );
+}
+
+static bool scanRep ( const char *data, size_t size, ReplayIndexEntry& entry )
+{
+    ReplayCreator::ReplayFile rf;
+
+    if ( ! ReplayCreator().parse ( &rf, data, size ) )
+        return false;
+
+    entry.year = rf.year;
+    entry.month = rf.month;
+    entry.day = rf.day;
+    entry.hour = rf.hour;
+    entry.minute = rf.minute;
+    entry.second = rf.second;
+
+    const ReplayCreator::CharData *players[2] = { &rf.p1, &rf.p2 };
+
+    for ( size_t i = 0; i < 2; ++i )
+    {
+        entry.chara[i] = players[i]->character;
+        entry.moon[i] = players[i]->moon;
+        entry.color[i] = players[i]->color;
+        entry.cpu[i] = ( players[i]->isCpu != 0 );
+    }
+
+    entry.stage = rf.stage;
+    entry.numRounds = min ( rf.numRounds, 0xFF );
+    entry.numWins = rf.numWins;
+
+    // Each input lasts for its duration in frames
+    for ( const ReplayCreator::Round& round : rf.rounds )
+        for ( const ReplayCreator::Input& input : round.p1Inputs )
+            entry.frames += input.duration;
+
+    return true;
+}
+
+// Raw inputs exported by NetplayManager::exportInputs, named "<P1>x<P2>_<yymmdd-HHMMSS>.repraw"
+static bool scanRepRaw ( const string& path, const char *data, size_t size, ReplayIndexEntry& entry )
+{
+    ReplayCreator::RawReplay rounds;
+
+    if ( ! ReplayCreator().parseRawInputs ( rounds, data, size ) || rounds.size() > 0xFF )
+        return false;
+
+    entry.numRounds = rounds.size();
+
+    for ( const auto& round : rounds )
+        entry.frames += round[0].size();
+
+    // The rest comes from the file name, which may have been renamed
+    string name = path.substr ( path.find_last_of ( "/\\" ) + 1 );
+    name = name.substr ( 0, name.rfind ( '.' ) );
+
+    const size_t split = name.rfind ( '_' );
+
+    if ( split == string::npos )
+        return true;
+
+    uint32_t year, month, day, hour, minute, second;
+
+    if ( sscanf ( name.c_str() + split + 1, "%2u%2u%2u-%2u%2u%2u",
+                  &year, &month, &day, &hour, &minute, &second ) == 6 )
+    {
+        entry.year = 2000 + year;
+        entry.month = month;
+        entry.day = day;
+        entry.hour = hour;
+        entry.minute = minute;
+        entry.second = second;
+    }
+
+    // Short names don't have an 'x', except for the separator
+    for ( size_t x = name.find ( 'x' ); x < split; x = name.find ( 'x', x + 1 ) )
+    {
+        const uint8_t p1 = findChara ( name.substr ( 0, x ) );
+        const uint8_t p2 = findChara ( name.substr ( x + 1, split - x - 1 ) );
+
+        if ( p1 != REPLAY_INDEX_ANY && p2 != REPLAY_INDEX_ANY )
+        {
+            entry.chara[0] = p1;
+            entry.chara[1] = p2;
+            break;
+        }
+    }
+
+    return true;
+}
+
+
+bool ReplayQuery::parseCharacter ( const string& str, uint8_t& chara, uint8_t& moon )
+{
+    moon = REPLAY_INDEX_ANY;
+
+    string name = str;
+
+    if ( name.size() > 2 && name[1] == '-' )
+    {
+        switch ( toupper ( ( unsigned char ) name[0] ) )
+        {
+            case 'C': moon = ReplayCreator::C; break;
+            case 'F': moon = ReplayCreator::F; break;
+            case 'H': moon = ReplayCreator::H; break;
+            default: return false;
+        }
+
+        name = name.substr ( 2 );
+    }
+
+    chara = findChara ( name );
+    return ( chara != REPLAY_INDEX_ANY );
+}
+
+bool ReplayQuery::matches ( const ReplayIndexEntry& entry ) const
+{
+    if ( entry.format == ReplayIndexEntry::Invalid )
+        return false;
+
+    if ( entry.getDate() < since || entry.getDate() > until )
+        return false;
+
+    if ( stage != REPLAY_INDEX_ANY && entry.stage != stage )
+        return false;
+
+    // If the query side q matches the replay player p
+    const auto matchesPlayer = [&] ( size_t p, size_t q )
+    {
+        return ( ( chara[q] == REPLAY_INDEX_ANY || entry.chara[p] == chara[q] )
+                 && ( moon[q] == REPLAY_INDEX_ANY || entry.moon[p] == moon[q] ) );
+    };
+
+    return ( ( matchesPlayer ( 0, 0 ) && matchesPlayer ( 1, 1 ) ) || ( matchesPlayer ( 1, 0 ) && matchesPlayer ( 0, 1 ) ) );
+}
+
+
+bool ReplayIndex::scan ( const string& path, const char *data, size_t size, ReplayIndexEntry& entry )
+{
+    const uint64_t fileSize = entry.fileSize;
+    const int64_t fileTime = entry.fileTime;
+
+    entry = ReplayIndexEntry();
+    entry.fileSize = fileSize;
+    entry.fileTime = fileTime;
+
+    memset ( entry.chara, REPLAY_INDEX_ANY, sizeof ( entry.chara ) );
+    memset ( entry.moon, REPLAY_INDEX_ANY, sizeof ( entry.moon ) );
+    memset ( entry.color, REPLAY_INDEX_ANY, sizeof ( entry.color ) );
+    memset ( entry.cpu, REPLAY_INDEX_ANY, sizeof ( entry.cpu ) );
+    entry.stage = REPLAY_INDEX_ANY;
+    entry.numWins = REPLAY_INDEX_ANY;
+
+    bool parsed = false;
+    ReplayIndexEntry::Format format = ReplayIndexEntry::Invalid;
+
+    if ( endsWith ( path, ".rep" ) )
+    {
+        parsed = scanRep ( data, size, entry );
+        format = ReplayIndexEntry::Rep;
+    }
+    else if ( endsWith ( path, ".repraw" ) )
+    {
+        parsed = scanRepRaw ( path, data, size, entry );
+        format = ReplayIndexEntry::RepRaw;
+    }
+
+    entry.format = ( parsed ? format : ReplayIndexEntry::Invalid );
+    return parsed;
+}
+
+bool ReplayIndex::scanFile ( const FileStat& file, ReplayIndexEntry& entry )
+{
+    entry.fileSize = file.size;
+    entry.fileTime = file.time;
+
+    MappedFile mapped;
+
+    if ( ! mapped.open ( file.path ) )
+    {
+        LOG ( "Failed to read '%s'", file.path );
+        return scan ( file.path, 0, 0, entry );
+    }
+
+    return scan ( file.path, mapped.data(), mapped.size(), entry );
+}
+
+bool ReplayIndex::load ( const string& file )
+{
+    _entries.clear();
+    _paths.clear();
+
+    MappedFile mapped;
+
+    if ( ! mapped.open ( file ) )
+        return false;
+
+    ReplayIndexHeader header;
+
+    if ( mapped.size() < sizeof ( header ) )
+        return false;
+
+    memcpy ( &header, mapped.data(), sizeof ( header ) );
+
+    if ( memcmp ( header.magic, REPLAY_INDEX_MAGIC, sizeof ( header.magic ) ) != 0
+            || header.version != REPLAY_INDEX_VERSION )
+    {
+        LOG ( "'%s' is not a replay index", file );
+        return false;
+    }
+
+    const size_t entriesSize = size_t ( header.numEntries ) * sizeof ( ReplayIndexEntry );
+
+    if ( mapped.size() - sizeof ( header ) != entriesSize + header.pathsSize )
+    {
+        LOG ( "Replay index '%s' is truncated", file );
+        return false;
+    }
+
+    const char *data = mapped.data() + sizeof ( header );
+
+    _entries.resize ( header.numEntries );
+    memcpy ( _entries.data(), data, entriesSize );
+    _paths.assign ( data + entriesSize, header.pathsSize );
+
+    for ( const ReplayIndexEntry& entry : _entries )
+    {
+        if ( entry.pathOffset > _paths.size() || entry.pathLength > _paths.size() - entry.pathOffset )
+        {
+            LOG ( "Replay index '%s' has an invalid path", file );
+            _entries.clear();
+            _paths.clear();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ReplayIndex::save ( const string& file ) const
+{
+    FILE *fp = fopen ( file.c_str(), "wb" );
+
+    if ( ! fp )
+    {
+        LOG ( "Failed to open '%s'", file );
+        return false;
+    }
+
+    ReplayIndexHeader header = ReplayIndexHeader();
+    memcpy ( header.magic, REPLAY_INDEX_MAGIC, sizeof ( header.magic ) );
+    header.version = REPLAY_INDEX_VERSION;
+    header.numEntries = _entries.size();
+    header.pathsSize = _paths.size();
+
+    bool written = ( fwrite ( &header, sizeof ( header ), 1, fp ) == 1 );
+    written = written && ( fwrite ( _entries.data(), sizeof ( ReplayIndexEntry ), _entries.size(), fp ) == _entries.size() );
+    written = written && ( fwrite ( _paths.data(), 1, _paths.size(), fp ) == _paths.size() );
+
+    fclose ( fp );
+    return written;
+}
+
+size_t ReplayIndex::refresh ( const vector<FileStat>& files, size_t numThreads )
+{
+    unordered_map<string, size_t> existing;
+
+    for ( size_t i = 0; i < _entries.size(); ++i )
+        existing[getPath ( i )] = i;
+
+    vector<ReplayIndexEntry> entries ( files.size() );
+
+    _scanQueue.clear();
+
+    for ( size_t i = 0; i < files.size(); ++i )
+    {
+        const auto it = existing.find ( files[i].path );
+
+        if ( it != existing.end()
+                && _entries[it->second].fileSize == files[i].size
+                && _entries[it->second].fileTime == files[i].time )
+        {
+            entries[i] = _entries[it->second];
+        }
+        else
+        {
+            _scanQueue.push_back ( i );
+        }
+    }
+
+    _scanFiles = &files;
+    _scanEntries = &entries;
+    _scanNext = 0;
+
+    // This thread scans too
+    vector<unique_ptr<ScanThread>> threads;
+
+    for ( size_t i = 1; i < min ( numThreads, _scanQueue.size() ); ++i )
+    {
+        threads.emplace_back ( new ScanThread ( *this ) );
+        threads.back()->start();
+    }
+
+    scanQueued();
+
+    for ( const auto& thread : threads )
+        thread->join();
+
+    _scanFiles = 0;
+    _scanEntries = 0;
+
+    // Rebuild the string table in path order
+    vector<size_t> order ( files.size() );
+
+    for ( size_t i = 0; i < order.size(); ++i )
+        order[i] = i;
+
+    sort ( order.begin(), order.end(), [&] ( size_t a, size_t b ) { return files[a].path < files[b].path; } );
+
+    _entries.clear();
+    _paths.clear();
+    _entries.reserve ( files.size() );
+
+    for ( size_t i : order )
+    {
+        ReplayIndexEntry entry = entries[i];
+        entry.pathOffset = _paths.size();
+        entry.pathLength = files[i].path.size();
+
+        _paths += files[i].path;
+        _entries.push_back ( entry );
+    }
+
+    return _scanQueue.size();
+}
+
+void ReplayIndex::scanQueued()
+{
+    for ( size_t i = _scanNext++; i < _scanQueue.size(); i = _scanNext++ )
+    {
+        const size_t file = _scanQueue[i];
+        scanFile ( ( *_scanFiles ) [file], ( *_scanEntries ) [file] );
+    }
+}
+
+void ReplayIndex::ScanThread::run()
+{
+    context.scanQueued();
+}
+
+vector<size_t> ReplayIndex::query ( const ReplayQuery& query ) const
+{
+    vector<size_t> results;
+
+    for ( size_t i = 0; i < _entries.size(); ++i )
+        if ( query.matches ( _entries[i] ) )
+            results.push_back ( i );
+
+    const auto time = [&] ( size_t i )
+    {
+        const ReplayIndexEntry& entry = _entries[i];
+        return ( uint64_t ( entry.getDate() ) * 1000000 + entry.hour * 10000u + entry.minute * 100u + entry.second );
+    };
+
+    stable_sort ( results.begin(), results.end(), [&] ( size_t a, size_t b ) { return time ( a ) > time ( b ); } );
+    return results;
+}
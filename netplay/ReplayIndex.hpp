@@ -0,0 +1,122 @@
+#pragma once
+
+#include "Thread.hpp"
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+
+// Magic bytes at the start of a replay index
+#define REPLAY_INDEX_MAGIC          "CCREPIDX"
+
+#define REPLAY_INDEX_VERSION        ( 1 )
+
+// Query value that matches anything, and metadata that isn't known for a replay
+#define REPLAY_INDEX_ANY            ( 0xFF )
+
+
+// Metadata of one replay file, these are stored as is in the index
+struct ReplayIndexEntry
+{
+    enum Format : uint8_t { Invalid, Rep, RepRaw };
+
+    // Size and modification time of the replay, to check if the entry is up to date
+    uint64_t fileSize;
+    int64_t fileTime;
+
+    // Path in the string table of the index
+    uint32_t pathOffset, pathLength;
+
+    uint16_t year;
+    uint8_t month, day, hour, minute, second;
+
+    Format format;
+
+    // Per player metadata, REPLAY_INDEX_ANY if the format doesn't have it
+    uint8_t chara[2], moon[2], color[2], cpu[2];
+
+    uint8_t stage, numRounds, numWins, reserved;
+
+    // Total number of frames over all the rounds
+    uint32_t frames;
+
+    // Date as yyyymmdd
+    uint32_t getDate() const { return year * 10000u + month * 100u + day; }
+};
+
+
+struct ReplayQuery
+{
+    // Either player may match either side
+    uint8_t chara[2] = { REPLAY_INDEX_ANY, REPLAY_INDEX_ANY }, moon[2] = { REPLAY_INDEX_ANY, REPLAY_INDEX_ANY };
+
+    // Inclusive dates as yyyymmdd
+    uint32_t since = 0, until = UINT32_MAX;
+
+    uint8_t stage = REPLAY_INDEX_ANY;
+
+    // Parse a short character name with an optional moon prefix, eg "H-Ryougi" or "ryougi"
+    static bool parseCharacter ( const std::string& str, uint8_t& chara, uint8_t& moon );
+
+    bool matches ( const ReplayIndexEntry& entry ) const;
+};
+
+
+// Persistent index of the metadata of replay files.
+//
+// Refreshing only scans the files that are new or changed since the last refresh, over multiple threads. The index
+// file is the entries table followed by a string table of the paths, so it loads with two copies.
+class ReplayIndex
+{
+public:
+
+    struct FileStat
+    {
+        std::string path;
+
+        uint64_t size;
+        int64_t time;
+    };
+
+    // Extract the metadata of a replay, the format is picked from the extension of the path.
+    // Returns false if it can't be parsed, in which case the format is Invalid.
+    static bool scan ( const std::string& path, const char *data, size_t size, ReplayIndexEntry& entry );
+
+    // Read the file and scan it
+    static bool scanFile ( const FileStat& file, ReplayIndexEntry& entry );
+
+    bool load ( const std::string& file );
+
+    bool save ( const std::string& file ) const;
+
+    // Update the index to exactly the given files, keeping the entries of unchanged files and scanning the rest.
+    // Returns the number of files scanned.
+    size_t refresh ( const std::vector<FileStat>& files, size_t numThreads );
+
+    // Indexes of the matching entries, newest first
+    std::vector<size_t> query ( const ReplayQuery& query ) const;
+
+    size_t size() const { return _entries.size(); }
+
+    const ReplayIndexEntry& getEntry ( size_t i ) const { return _entries[i]; }
+
+    std::string getPath ( size_t i ) const { return _paths.substr ( _entries[i].pathOffset, _entries[i].pathLength ); }
+
+private:
+
+    THREAD ( ScanThread, ReplayIndex );
+
+    std::vector<ReplayIndexEntry> _entries;
+
+    std::string _paths;
+
+    // Files being scanned by refresh, the next one to scan, and the results
+    const std::vector<FileStat> *_scanFiles = 0;
+    std::vector<size_t> _scanQueue;
+    std::atomic<size_t> _scanNext;
+    std::vector<ReplayIndexEntry> *_scanEntries = 0;
+
+    void scanQueued();
+};
@@ -0,0 +1,130 @@
+#include "ReplayKeyframes.hpp"
+#include "Compression.hpp"
+#include "Logger.hpp"
+
+using namespace std;
+
+
+bool ReplayKeyframes::isDue ( IndexedFrame indexedFrame ) const
+{
+    if ( interval == 0 || indexedFrame.parts.frame % getSpacing() != 0 )
+        return false;
+
+    return ( _keyframes.find ( indexedFrame.value ) == _keyframes.end() );
+}
+
+void ReplayKeyframes::save ( NetplayState netplayState, uint32_t startWorldTime, IndexedFrame indexedFrame,
+                             const char *state, size_t size )
+{
+    _buffer.resize ( compressBound ( size ) );
+
+    const size_t compressedSize = compress ( state, size, &_buffer[0], _buffer.size(), level );
+
+    if ( compressedSize == 0 )
+    {
+        LOG ( "Failed to compress keyframe [%s]", indexedFrame );
+        return;
+    }
+
+    Keyframe& keyframe = _keyframes[indexedFrame.value];
+
+    _compressedSize -= keyframe.compressed.size();
+    _compressedSize += compressedSize;
+
+    keyframe.netplayState = netplayState;
+    keyframe.startWorldTime = startWorldTime;
+    keyframe.indexedFrame = indexedFrame;
+    keyframe.size = size;
+    keyframe.compressed.assign ( _buffer, 0, compressedSize );
+
+    LOG ( "Saved keyframe [%s]; size=%u; compressed=%u", indexedFrame, size, compressedSize );
+
+    while ( maxCompressedSize && _compressedSize > maxCompressedSize )
+    {
+        // Seeking only restores keyframes with the same index, so first drop the oldest index if it isn't this one
+        const uint32_t oldestIndex = _keyframes.begin()->second.indexedFrame.parts.index;
+
+        if ( oldestIndex != indexedFrame.parts.index )
+        {
+            for ( auto it = _keyframes.begin(); it != _keyframes.end()
+                    && it->second.indexedFrame.parts.index == oldestIndex; )
+            {
+                _compressedSize -= it->second.compressed.size();
+                it = _keyframes.erase ( it );
+            }
+
+            LOG ( "Dropped keyframes of index %u; count=%u; compressed=%u",
+                  oldestIndex, _keyframes.size(), _compressedSize );
+            continue;
+        }
+
+        if ( ! thin() )
+            break;
+
+        LOG ( "Thinned keyframes; spacing=%llu; count=%u; compressed=%u",
+              getSpacing(), _keyframes.size(), _compressedSize );
+    }
+}
+
+bool ReplayKeyframes::thin()
+{
+    // The spacing can't grow past the largest frame number
+    if ( getSpacing() * 2 > UINT32_MAX )
+        return false;
+
+    _stride *= 2;
+
+    const uint64_t spacing = getSpacing();
+    const size_t count = _keyframes.size();
+
+    for ( auto it = _keyframes.begin(); it != _keyframes.end(); )
+    {
+        if ( it->second.indexedFrame.parts.frame % spacing == 0 )
+        {
+            ++it;
+            continue;
+        }
+
+        _compressedSize -= it->second.compressed.size();
+        it = _keyframes.erase ( it );
+    }
+
+    return ( _keyframes.size() < count );
+}
+
+const ReplayKeyframes::Keyframe *ReplayKeyframes::find ( IndexedFrame indexedFrame ) const
+{
+    auto it = _keyframes.upper_bound ( indexedFrame.value );
+
+    if ( it == _keyframes.begin() )
+        return 0;
+
+    --it;
+
+    if ( it->second.indexedFrame.parts.index != indexedFrame.parts.index )
+        return 0;
+
+    return &it->second;
+}
+
+bool ReplayKeyframes::load ( const Keyframe& keyframe, char *dst )
+{
+    return ( uncompress ( keyframe.compressed.data(), keyframe.compressed.size(), dst, keyframe.size )
+             == keyframe.size );
+}
+
+void ReplayKeyframes::eraseAfter ( IndexedFrame indexedFrame )
+{
+    for ( auto it = _keyframes.upper_bound ( indexedFrame.value ); it != _keyframes.end(); )
+    {
+        _compressedSize -= it->second.compressed.size();
+        it = _keyframes.erase ( it );
+    }
+}
+
+void ReplayKeyframes::clear()
+{
+    _keyframes.clear();
+    _compressedSize = 0;
+    _stride = 1;
+}
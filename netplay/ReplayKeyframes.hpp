@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Constants.hpp"
+#include "NetplayStates.hpp"
+
+#include <string>
+#include <map>
+
+
+// Compressed game states saved periodically during replay playback. Seeking restores the nearest keyframe at or
+// before the target, so at most one interval of frames has to be fast-forwarded instead of the whole replay.
+class ReplayKeyframes
+{
+public:
+
+    struct Keyframe
+    {
+        // Netplay state at the keyframe, same as DllRollbackManager::GameState
+        NetplayState netplayState;
+        uint32_t startWorldTime;
+        IndexedFrame indexedFrame;
+
+        // Size of the uncompressed state
+        uint32_t size;
+
+        std::string compressed;
+    };
+
+    // Frames between keyframes
+    uint32_t interval = 120;
+
+    // Limit on the total size of the compressed states, since they are kept in the 32-bit game process. Past this,
+    // the keyframes of older indexes are dropped first. Then every other keyframe is dropped and the spacing is
+    // doubled, so seeking still works across the whole index. 0 is unlimited.
+    size_t maxCompressedSize = 64 * 1024 * 1024;
+
+    // zlib compression level, the default is fast enough to save keyframes on the game thread
+    int level = 1;
+
+    // Indicates if a keyframe should be saved at this frame
+    bool isDue ( IndexedFrame indexedFrame ) const;
+
+    // Compress and save a keyframe, replacing any keyframe at the same frame
+    void save ( NetplayState netplayState, uint32_t startWorldTime, IndexedFrame indexedFrame,
+                const char *state, size_t size );
+
+    // Nearest keyframe at or before the given frame with the same index, null if there is none
+    const Keyframe *find ( IndexedFrame indexedFrame ) const;
+
+    // Uncompress a keyframe, dst must have room for keyframe.size bytes
+    static bool load ( const Keyframe& keyframe, char *dst );
+
+    // Remove keyframes after the given frame. They were saved before a rollback to that frame, so they no longer
+    // match the game state after re-running.
+    void eraseAfter ( IndexedFrame indexedFrame );
+
+    void clear();
+
+    size_t size() const { return _keyframes.size(); }
+
+    // Frames between keyframes after thinning, a multiple of interval
+    uint64_t getSpacing() const { return uint64_t ( interval ) * _stride; }
+
+    // Total size of the compressed states
+    size_t getCompressedSize() const { return _compressedSize; }
+
+private:
+
+    // Keyframes ordered by IndexedFrame value
+    std::map<uint64_t, Keyframe> _keyframes;
+
+    size_t _compressedSize = 0;
+
+    // Number of intervals between keyframes, doubled each time they are thinned
+    uint32_t _stride = 1;
+
+    // Reused compression buffer
+    std::string _buffer;
+
+    // Drop every other keyframe, returns false if there were none to drop
+    bool thin();
+};
@@ -5,11 +5,136 @@
 
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include <sys/stat.h>
 
 using namespace std;
 
 
+// Sizes are computed in 64 bits, since size_t is only 32 bits in the DLL and the counts come from the file.
+// Returns false if the table would end past SIZE_MAX.
+template<typename T>
+static bool layoutTable ( const char *base, size_t& offset, const T *& table, uint64_t count )
+{
+    // Keep every table 8 byte aligned
+    const uint64_t begin = ( uint64_t ( offset ) + 7 ) & ~uint64_t ( 7 );
+    const uint64_t end = begin + count * sizeof ( T );
+
+    if ( count > UINT64_MAX / sizeof ( T ) || end < begin || end > SIZE_MAX )
+        return false;
+
+    table = ( base ? reinterpret_cast<const T *> ( base + begin ) : 0 );
+
+    offset = size_t ( end );
+    return true;
+}
+
+template<typename T>
+static T *mutableTable ( const T *table )
+{
+    return const_cast<T *> ( table );
+}
+
+
+bool ReplayManager::isStore ( const string& file )
+{
+    FILE *fp = fopen ( file.c_str(), "rb" );
+
+    if ( ! fp )
+        return false;
+
+    char magic[sizeof ( REPLAY_STORE_MAGIC ) - 1];
+
+    const bool store = ( fread ( magic, 1, sizeof ( magic ), fp ) == sizeof ( magic )
+                         && memcmp ( magic, REPLAY_STORE_MAGIC, sizeof ( magic ) ) == 0 );
+
+    fclose ( fp );
+    return store;
+}
+
 bool ReplayManager::load ( const string& replayFile, bool real )
+{
+    _store = Store();
+    _mapped.close();
+    _built.clear();
+
+    if ( isStore ( replayFile ) )
+    {
+        if ( ! _mapped.open ( replayFile ) || ! mapStore ( _mapped.data(), _mapped.size() ) )
+        {
+            LOG ( "Invalid replay store '%s'", replayFile );
+            return false;
+        }
+
+        if ( bool ( _store.header.real ) != real )
+            LOG ( "Replay store was built with real=%u", _store.header.real );
+
+        return true;
+    }
+
+    struct stat st;
+
+    if ( stat ( replayFile.c_str(), &st ) != 0 )
+        return false;
+
+    const string storeFile = replayFile + REPLAY_STORE_EXT;
+
+    if ( _mapped.open ( storeFile ) && mapStore ( _mapped.data(), _mapped.size() )
+            && bool ( _store.header.real ) == real
+            && _store.header.sourceSize == uint64_t ( st.st_size )
+            && _store.header.sourceTime == int64_t ( st.st_mtime ) )
+    {
+        LOG ( "Using replay store '%s'", storeFile );
+        return true;
+    }
+
+    _store = Store();
+    _mapped.close();
+
+    const bool good = ( SyncLogReader::isBinary ( replayFile )
+                        ? loadBinary ( replayFile, real )
+                        : loadText ( replayFile, real ) );
+
+    if ( ! good )
+        return false;
+
+    _built = buildStore ( real, st.st_size, st.st_mtime );
+
+    if ( _built.empty() )
+        return false;
+
+    // Cache the store, then map it back so the built copy can be freed
+    bool cached = false;
+
+    if ( FILE *fp = fopen ( storeFile.c_str(), "wb" ) )
+    {
+        cached = ( fwrite ( _built.data(), 1, _built.size(), fp ) == _built.size() );
+        cached &= ( fclose ( fp ) == 0 );
+    }
+
+    if ( cached && _mapped.open ( storeFile ) && mapStore ( _mapped.data(), _mapped.size() ) )
+    {
+        _built.clear();
+        _built.shrink_to_fit();
+    }
+    else
+    {
+        LOG ( "Failed to cache replay store '%s'", storeFile );
+
+        _mapped.close();
+
+        const bool mapped = mapStore ( _built.data(), _built.size() );
+        ASSERT ( mapped == true );
+    }
+
+    LOG ( "Processed up to [%u:%u]", getLastIndex(), getLastFrame() );
+    return true;
+}
+
+bool ReplayManager::loadText ( const string& replayFile, bool real )
 {
     ifstream fin ( replayFile.c_str() );
     bool good = fin.good();
@@ -29,217 +154,488 @@ bool ReplayManager::load ( const string& replayFile, bool real )
             getline ( fin, str );
             ss << trimmed ( str );
 
-            if ( index >= _modes.size() )
+            SyncLogRecord record ( SyncLogRecord::Text, gameMode, NetplayState(), {{ frame, index }} );
+
+            if ( ! SyncLogRecord::parseNetplayState ( netplayState, record.netplayState ) )
+                THROW_EXCEPTION ( "Unknown netplay state: '%s'", "Invalid replay file!", netplayState );
+
+            if ( tag == "Inputs" || tag == "Reinputs" )
             {
-                _modes.resize ( index + 1 );
-                _modes[index] = 0;
+                record.type = ( tag == "Inputs" ? SyncLogRecord::Inputs : SyncLogRecord::Reinputs );
+                ss >> hex >> record.inputs[0] >> record.inputs[1];
             }
+            else if ( tag == "RngState" )
+            {
+                record.type = SyncLogRecord::RngState;
 
-            if ( ! _modes[index] )
-                _modes[index] = gameMode;
+                const bool padded = ( ss.str().size() == 707 ); // Old RngState hex dump size
 
-            ASSERT ( _modes[index] == gameMode );
+                if ( ! padded && ss.str().size() != 695 ) // New RngState hex dump size
+                    THROW_EXCEPTION ( "Unknown RngState size: %u", "Invalid replay file!", ss.str().size() );
 
-            if ( index >= _states.size() )
-                _states.resize ( index + 1 );
+                uint32_t v;
 
-            if ( _states[index].empty() )
-                _states[index] = "NetplayState::" + netplayState;
+                for ( size_t i = 0; i < record.rngState.size(); ++i )
+                {
+                    // The old dump had 4 bytes of padding before rngState3
+                    if ( padded && i == 12 )
+                    {
+                        for ( int j = 0; j < 4; ++j )
+                            ss >> hex >> v;
+                    }
 
-            if ( gameMode == CC_GAME_MODE_LOADING )
+                    ss >> hex >> v;
+                    record.rngState[i] = v;
+                }
+            }
+            else if ( tag == "Rollback" )
             {
-                if ( _initialStates.empty() )
-                    _initialStates.push_back ( MsgPtr ( new InitialGameState ( { 0, index } ) ) );
-
-                ASSERT ( _initialStates.back().get() != 0 );
+                record.type = SyncLogRecord::Rollback;
+                ss >> record.target.parts.index >> record.target.parts.frame;
+            }
+            else if ( tag == "P1" || tag == "P2" )
+            {
+                uint32_t chara, moon, color;
+                ss >> chara >> moon >> color;
 
-                if ( _initialStates.back()->getAs<InitialGameState>().indexedFrame.parts.index != index )
-                    _initialStates.push_back ( MsgPtr ( new InitialGameState ( { 0, index } ) ) );
+                record.text = format ( "%s: C=%u; M=%u; c=%u", tag, chara, moon, color );
+            }
+            else
+            {
+                THROW_EXCEPTION ( "Unhandled tag: '%s'", "Invalid replay file!", tag );
             }
 
-            ASSERT ( _states[index] == "NetplayState::" + netplayState );
+            addRecord ( record, real );
+        }
+    }
 
-            if ( tag == "Inputs" || ( real && tag == "Reinputs" ) )
-            {
-                if ( index >= _inputs.size() )
-                    _inputs.resize ( index + 1 );
+    fin.close();
+    return good;
+}
 
-                ASSERT ( index + 1 == _inputs.size() );
+bool ReplayManager::loadBinary ( const string& replayFile, bool real )
+{
+    SyncLogReader reader;
 
-                if ( frame >= _inputs[index].size() )
-                    _inputs[index].resize ( frame + 1 );
+    if ( ! reader.open ( replayFile ) )
+        return false;
 
-                Inputs i;
-                i.indexedFrame.parts.index = index;
-                i.indexedFrame.parts.frame = frame;
-                ss >> hex >> i.p1 >> i.p2;
+    SyncLogRecord record;
+    bool started = false;
 
-                _inputs[index][frame] = i;
-            }
-            else if ( tag == "RngState" )
+    // Only use the same records that scripts/sync2replay keeps from a text sync log
+    while ( reader.next ( record ) )
+    {
+        if ( record.type == SyncLogRecord::Raw )
+            continue;
+
+        if ( ! started )
+        {
+            started = ( record.netplayState == NetplayState::CharaSelect
+                        || record.netplayState == NetplayState::Loading );
+
+            if ( ! started )
+                continue;
+        }
+
+        if ( record.type == SyncLogRecord::RngState || record.type == SyncLogRecord::Text )
+        {
+            if ( record.indexedFrame.parts.frame != 0 )
+                continue;
+
+            if ( record.type == SyncLogRecord::Text
+                    && record.text.compare ( 0, 4, "P1: " ) != 0 && record.text.compare ( 0, 4, "P2: " ) != 0 )
             {
-                if ( index >= _rngStates.size() )
-                    _rngStates.resize ( index + 1 );
+                continue;
+            }
+        }
 
-                ASSERT ( _rngStates[index].get() == 0 );
+        addRecord ( record, real );
+    }
 
-                RngState *rngState = 0;
+    return true;
+}
 
-                if ( ss.str().size() == 707 ) // Old RngState hex dump size
-                {
-                    rngState = new RngState ( 0 );
+void ReplayManager::addRecord ( const SyncLogRecord& record, bool real )
+{
+    const uint32_t gameMode = record.gameMode;
+    const uint32_t index = record.indexedFrame.parts.index;
+    const uint32_t frame = record.indexedFrame.parts.frame;
 
-                    char data [ sizeof ( uint32_t ) * 3 + 4 + CC_RNG_STATE3_SIZE ];
+    if ( index >= _modes.size() )
+    {
+        _modes.resize ( index + 1 );
+        _modes[index] = 0;
+    }
 
-                    for ( char& c : data )
-                    {
-                        uint32_t v;
-                        ss >> hex >> v;
-                        c = v;
-                    }
+    if ( ! _modes[index] )
+        _modes[index] = gameMode;
 
-                    memcpy ( &rngState->rngState0, &data[0], sizeof ( uint32_t ) );
-                    memcpy ( &rngState->rngState1, &data[4], sizeof ( uint32_t ) );
-                    memcpy ( &rngState->rngState2, &data[8], sizeof ( uint32_t ) );
-                    copy ( &data[16], &data[16 + CC_RNG_STATE3_SIZE], rngState->rngState3.begin() );
-                }
-                else if ( ss.str().size() == 695 ) // New RngState hex dump size
-                {
-                    rngState = new RngState ( 0 );
+    ASSERT ( _modes[index] == gameMode );
 
-                    char data [ sizeof ( uint32_t ) * 3 + CC_RNG_STATE3_SIZE ];
+    if ( index >= _states.size() )
+        _states.resize ( index + 1 );
 
-                    for ( char& c : data )
-                    {
-                        uint32_t v;
-                        ss >> hex >> v;
-                        c = v;
-                    }
+    if ( _states[index] == NetplayState::Unknown )
+        _states[index] = record.netplayState;
 
-                    memcpy ( &rngState->rngState0, &data[0], sizeof ( uint32_t ) );
-                    memcpy ( &rngState->rngState1, &data[4], sizeof ( uint32_t ) );
-                    memcpy ( &rngState->rngState2, &data[8], sizeof ( uint32_t ) );
-                    copy ( &data[12], &data[12 + CC_RNG_STATE3_SIZE], rngState->rngState3.begin() );
-                }
-                else
-                {
-                    THROW_EXCEPTION ( "Unknown RngState size: %u", "Invalid replay file!", ss.str().size() );
-                }
+    if ( gameMode == CC_GAME_MODE_LOADING )
+    {
+        if ( _initialStates.empty() )
+            _initialStates.push_back ( MsgPtr ( new InitialGameState ( { 0, index } ) ) );
 
-                _rngStates[index].reset ( rngState );
-            }
-            else if ( tag == "Rollback" )
-            {
-                if ( real )
-                    continue;
+        ASSERT ( _initialStates.back().get() != 0 );
 
-                if ( index >= _rollbacks.size() )
-                    _rollbacks.resize ( index + 1 );
+        if ( _initialStates.back()->getAs<InitialGameState>().indexedFrame.parts.index != index )
+            _initialStates.push_back ( MsgPtr ( new InitialGameState ( { 0, index } ) ) );
+    }
 
-                ASSERT ( index + 1 == _rollbacks.size() );
+    ASSERT ( _states[index] == record.netplayState );
 
-                if ( frame >= _rollbacks[index].size() )
-                    _rollbacks[index].resize ( frame + 1, MaxIndexedFrame );
+    if ( record.type == SyncLogRecord::Inputs || ( real && record.type == SyncLogRecord::Reinputs ) )
+    {
+        if ( index >= _inputs.size() )
+            _inputs.resize ( index + 1 );
 
-                IndexedFrame i;
-                ss >> i.parts.index >> i.parts.frame;
+        ASSERT ( index + 1 == _inputs.size() );
 
-                _rollbacks[index][frame] = i;
-            }
-            else if ( tag == "Reinputs" )
-            {
-                if ( real )
-                    continue;
+        if ( frame >= _inputs[index].size() )
+            _inputs[index].resize ( frame + 1 );
 
-                if ( _rollbacks.size() > _reinputs.size() )
-                    _reinputs.resize ( _rollbacks.size() );
+        Inputs i;
+        i.indexedFrame = record.indexedFrame;
+        i.p1 = record.inputs[0];
+        i.p2 = record.inputs[1];
 
-                ASSERT ( _rollbacks.size() == _reinputs.size() );
+        _inputs[index][frame] = i;
+    }
+    else if ( record.type == SyncLogRecord::RngState )
+    {
+        if ( index >= _rngStates.size() )
+            _rngStates.resize ( index + 1 );
 
-                if ( _rollbacks.back().size() > _reinputs.back().size() )
-                    _reinputs.back().resize ( _rollbacks.back().size() );
+        ASSERT ( _rngStates[index].get() == 0 );
 
-                ASSERT ( _rollbacks.back().size() == _reinputs.back().size() );
+        RngState *rngState = new RngState ( 0 );
 
-                Inputs i;
-                i.indexedFrame.parts.index = index;
-                i.indexedFrame.parts.frame = frame;
-                ss >> hex >> i.p1 >> i.p2;
+        memcpy ( &rngState->rngState0, &record.rngState[0], sizeof ( uint32_t ) );
+        memcpy ( &rngState->rngState1, &record.rngState[4], sizeof ( uint32_t ) );
+        memcpy ( &rngState->rngState2, &record.rngState[8], sizeof ( uint32_t ) );
+        copy ( &record.rngState[12], &record.rngState[12 + CC_RNG_STATE3_SIZE], rngState->rngState3.begin() );
 
-                _reinputs.back().back().push_back ( i );
-            }
-            else if ( tag == "P1" )
-            {
-                if ( gameMode != CC_GAME_MODE_IN_GAME )
-                    continue;
+        _rngStates[index].reset ( rngState );
+    }
+    else if ( record.type == SyncLogRecord::Rollback )
+    {
+        if ( real )
+            return;
 
-                ASSERT ( _initialStates.back().get() != 0 );
+        if ( index >= _rollbacks.size() )
+            _rollbacks.resize ( index + 1 );
 
-                uint32_t chara, moon, color;
-                ss >> chara >> moon >> color;
+        ASSERT ( index + 1 == _rollbacks.size() );
 
-                _initialStates.back()->getAs<InitialGameState>().chara[0] = chara;
-                _initialStates.back()->getAs<InitialGameState>().moon[0] = moon;
-                _initialStates.back()->getAs<InitialGameState>().color[0] = color;
-            }
-            else if ( tag == "P2" )
-            {
-                if ( gameMode != CC_GAME_MODE_IN_GAME )
-                    continue;
+        if ( frame >= _rollbacks[index].size() )
+            _rollbacks[index].resize ( frame + 1, MaxIndexedFrame );
 
-                ASSERT ( _initialStates.back().get() != 0 );
+        _rollbacks[index][frame] = record.target;
+    }
+    else if ( record.type == SyncLogRecord::Reinputs )
+    {
+        if ( real )
+            return;
 
-                uint32_t chara, moon, color;
-                ss >> chara >> moon >> color;
+        if ( _rollbacks.size() > _reinputs.size() )
+            _reinputs.resize ( _rollbacks.size() );
 
-                _initialStates.back()->getAs<InitialGameState>().chara[1] = chara;
-                _initialStates.back()->getAs<InitialGameState>().moon[1] = moon;
-                _initialStates.back()->getAs<InitialGameState>().color[1] = color;
-            }
-            else
+        ASSERT ( _rollbacks.size() == _reinputs.size() );
+
+        if ( _rollbacks.back().size() > _reinputs.back().size() )
+            _reinputs.back().resize ( _rollbacks.back().size() );
+
+        ASSERT ( _rollbacks.back().size() == _reinputs.back().size() );
+
+        Inputs i;
+        i.indexedFrame = record.indexedFrame;
+        i.p1 = record.inputs[0];
+        i.p2 = record.inputs[1];
+
+        _reinputs.back().back().push_back ( i );
+    }
+    else if ( record.type == SyncLogRecord::Text )
+    {
+        if ( gameMode != CC_GAME_MODE_IN_GAME )
+            return;
+
+        uint32_t player, chara, moon, color;
+
+        if ( sscanf ( record.text.c_str(), "P%u: C=%u; M=%u; c=%u", &player, &chara, &moon, &color ) != 4
+                || player < 1 || player > 2 )
+        {
+            return;
+        }
+
+        ASSERT ( _initialStates.back().get() != 0 );
+
+        _initialStates.back()->getAs<InitialGameState>().chara[player - 1] = chara;
+        _initialStates.back()->getAs<InitialGameState>().moon[player - 1] = moon;
+        _initialStates.back()->getAs<InitialGameState>().color[player - 1] = color;
+    }
+}
+
+string ReplayManager::buildStore ( bool real, uint64_t sourceSize, int64_t sourceTime )
+{
+    Store store = Store();
+    StoreHeader& header = store.header;
+
+    memcpy ( header.magic, REPLAY_STORE_MAGIC, sizeof ( header.magic ) );
+    header.version = REPLAY_STORE_VERSION;
+    header.real = real;
+    header.sourceSize = sourceSize;
+    header.sourceTime = sourceTime;
+
+    header.numIndexes = max ( { _modes.size(), _states.size(), _inputs.size(), _rngStates.size(), _rollbacks.size() } );
+    header.lastIndex = ( _inputs.empty() ? 0 : _inputs.size() - 1 );
+    header.lastFrame = ( _inputs.empty() || _inputs.back().empty() ? 0 : _inputs.back().size() - 1 );
+
+    _modes.resize ( header.numIndexes, 0 );
+    _states.resize ( header.numIndexes );
+    _inputs.resize ( header.numIndexes );
+    _rngStates.resize ( header.numIndexes );
+    _rollbacks.resize ( header.numIndexes );
+    _reinputs.resize ( header.numIndexes );
+
+    for ( uint32_t i = 0; i < header.numIndexes; ++i )
+    {
+        _rollbacks[i].resize ( max ( _rollbacks[i].size(), _reinputs[i].size() ), MaxIndexedFrame );
+        _reinputs[i].resize ( _rollbacks[i].size() );
+
+        header.numFrames += max ( _inputs[i].size(), _rollbacks[i].size() );
+
+        for ( uint32_t j = 0; j < _rollbacks[i].size(); ++j )
+        {
+            if ( _rollbacks[i][j].value != MaxIndexedFrame.value || ! _reinputs[i][j].empty() )
             {
-                THROW_EXCEPTION ( "Unhandled tag: '%s'", "Invalid replay file!", tag );
+                ++header.numRollbacks;
+                header.numReinputs += _reinputs[i][j].size();
             }
         }
 
-        LOG ( "Processed up to [%u:%u]", _inputs.size() - 1, _inputs.back().size() - 1 );
+        header.numRngStates += ( _rngStates[i] ? 1 : 0 );
     }
 
-    fin.close();
-    return good;
+    header.numInitialStates = _initialStates.size();
+
+    const size_t size = layoutStore ( store, 0 );
+
+    if ( size == 0 )
+    {
+        LOG ( "Replay store is too large" );
+        return "";
+    }
+
+    string data ( size, '\0' );
+    layoutStore ( store, &data[0] );
+    memcpy ( &data[0], &header, sizeof ( header ) );
+
+    uint32_t frameOffset = 0, rollback = 0, reinput = 0, rngState = 0;
+
+    for ( uint32_t i = 0; i < header.numIndexes; ++i )
+    {
+        mutableTable ( store.modes ) [i] = _modes[i];
+        mutableTable ( store.states ) [i] = _states[i].value;
+        mutableTable ( store.frameOffsets ) [i] = frameOffset;
+
+        for ( uint32_t j = 0; j < _inputs[i].size(); ++j )
+        {
+            mutableTable ( store.p1 ) [frameOffset + j] = _inputs[i][j].p1;
+            mutableTable ( store.p2 ) [frameOffset + j] = _inputs[i][j].p2;
+        }
+
+        for ( uint32_t j = 0; j < _rollbacks[i].size(); ++j )
+        {
+            if ( _rollbacks[i][j].value == MaxIndexedFrame.value && _reinputs[i][j].empty() )
+                continue;
+
+            StoreRollback& entry = mutableTable ( store.rollbacks ) [rollback];
+            entry.target = _rollbacks[i][j];
+            entry.reinputsBegin = reinput;
+
+            for ( const Inputs& inputs : _reinputs[i][j] )
+                mutableTable ( store.reinputs ) [reinput++] = inputs;
+
+            entry.reinputsEnd = reinput;
+
+            mutableTable ( store.rollbackSlots ) [frameOffset + j] = ++rollback;
+        }
+
+        if ( _rngStates[i] )
+        {
+            const RngState& msg = _rngStates[i]->getAs<RngState>();
+            char *bytes = mutableTable ( store.rngStates ) + rngState * SYNC_LOG_RNG_STATE_SIZE;
+
+            memcpy ( &bytes[0], &msg.rngState0, sizeof ( uint32_t ) );
+            memcpy ( &bytes[4], &msg.rngState1, sizeof ( uint32_t ) );
+            memcpy ( &bytes[8], &msg.rngState2, sizeof ( uint32_t ) );
+            copy ( msg.rngState3.begin(), msg.rngState3.end(), &bytes[12] );
+
+            mutableTable ( store.rngStateSlots ) [i] = ++rngState;
+        }
+
+        frameOffset += max ( _inputs[i].size(), _rollbacks[i].size() );
+    }
+
+    mutableTable ( store.frameOffsets ) [header.numIndexes] = frameOffset;
+
+    for ( uint32_t i = 0; i < header.numInitialStates; ++i )
+    {
+        const InitialGameState& msg = _initialStates[i]->getAs<InitialGameState>();
+        StoreInitialState& entry = mutableTable ( store.initialStates ) [i];
+
+        entry.index = msg.indexedFrame.parts.index;
+
+        for ( uint8_t j = 0; j < 2; ++j )
+        {
+            entry.chara[j] = msg.chara[j];
+            entry.moon[j] = msg.moon[j];
+            entry.color[j] = msg.color[j];
+        }
+    }
+
+    _modes.clear();
+    _states.clear();
+    _inputs.clear();
+    _rngStates.clear();
+    _rollbacks.clear();
+    _reinputs.clear();
+    _initialStates.clear();
+
+    return data;
 }
 
-uint32_t ReplayManager::getGameMode ( IndexedFrame indexedFrame )
+size_t ReplayManager::layoutStore ( Store& store, const char *base )
 {
-    if ( indexedFrame.parts.index >= _modes.size() )
-        return 0;
-
-    return _modes[indexedFrame.parts.index];
+    const StoreHeader& header = store.header;
+
+    size_t offset = sizeof ( StoreHeader );
+
+    const bool good = layoutTable ( base, offset, store.modes, header.numIndexes )
+                      && layoutTable ( base, offset, store.states, header.numIndexes )
+                      && layoutTable ( base, offset, store.frameOffsets, uint64_t ( header.numIndexes ) + 1 )
+                      && layoutTable ( base, offset, store.p1, header.numFrames )
+                      && layoutTable ( base, offset, store.p2, header.numFrames )
+                      && layoutTable ( base, offset, store.rollbackSlots, header.numFrames )
+                      && layoutTable ( base, offset, store.rollbacks, header.numRollbacks )
+                      && layoutTable ( base, offset, store.reinputs, header.numReinputs )
+                      && layoutTable ( base, offset, store.rngStateSlots, header.numIndexes )
+                      && layoutTable ( base, offset, store.rngStates,
+                                       uint64_t ( header.numRngStates ) * SYNC_LOG_RNG_STATE_SIZE )
+                      && layoutTable ( base, offset, store.initialStates, header.numInitialStates );
+
+    return ( good ? offset : 0 );
 }
 
-const string& ReplayManager::getStateStr ( IndexedFrame indexedFrame )
+bool ReplayManager::mapStore ( const char *data, size_t size )
 {
-    if ( indexedFrame.parts.index >= _states.size() )
+    Store store = Store();
+
+    if ( size < sizeof ( store.header ) )
+        return false;
+
+    memcpy ( &store.header, data, sizeof ( store.header ) );
+
+    const StoreHeader& header = store.header;
+
+    if ( memcmp ( header.magic, REPLAY_STORE_MAGIC, sizeof ( header.magic ) ) != 0
+            || header.version != REPLAY_STORE_VERSION )
     {
-        static const string empty;
-        return empty;
+        return false;
+    }
+
+    const size_t storeSize = layoutStore ( store, 0 );
+
+    if ( storeSize == 0 || storeSize > size )
+        return false;
+
+    layoutStore ( store, data );
+
+    // Check every slot and offset used for indexing, so a corrupt store can't index out of bounds later
+    if ( store.frameOffsets[0] != 0 || store.frameOffsets[header.numIndexes] != header.numFrames )
+        return false;
+
+    for ( uint32_t i = 0; i < header.numIndexes; ++i )
+    {
+        if ( store.frameOffsets[i] > store.frameOffsets[i + 1]
+                || store.rngStateSlots[i] > header.numRngStates )
+        {
+            return false;
+        }
+    }
+
+    for ( uint32_t i = 0; i < header.numFrames; ++i )
+    {
+        if ( store.rollbackSlots[i] > header.numRollbacks )
+            return false;
     }
 
-    return _states[indexedFrame.parts.index];
+    for ( uint32_t i = 0; i < header.numRollbacks; ++i )
+    {
+        if ( store.rollbacks[i].reinputsBegin > store.rollbacks[i].reinputsEnd
+                || store.rollbacks[i].reinputsEnd > header.numReinputs )
+        {
+            return false;
+        }
+    }
+
+    _store = store;
+    return true;
+}
+
+uint32_t ReplayManager::getFrameOffset ( IndexedFrame indexedFrame ) const
+{
+    const uint32_t index = indexedFrame.parts.index;
+
+    if ( index >= _store.header.numIndexes )
+        return UINT_MAX;
+
+    const uint32_t begin = _store.frameOffsets[index], end = _store.frameOffsets[index + 1];
+
+    if ( indexedFrame.parts.frame >= end - begin )
+        return UINT_MAX;
+
+    return begin + indexedFrame.parts.frame;
 }
 
-const ReplayManager::Inputs& ReplayManager::getInputs ( IndexedFrame indexedFrame )
+uint32_t ReplayManager::getGameMode ( IndexedFrame indexedFrame ) const
+{
+    if ( indexedFrame.parts.index >= _store.header.numIndexes )
+        return 0;
+
+    return _store.modes[indexedFrame.parts.index];
+}
+
+NetplayState ReplayManager::getState ( IndexedFrame indexedFrame ) const
+{
+    if ( indexedFrame.parts.index >= _store.header.numIndexes )
+        return NetplayState::Unknown;
+
+    return NetplayState::Enum ( _store.states[indexedFrame.parts.index] );
+}
+
+ReplayManager::Inputs ReplayManager::getInputs ( IndexedFrame indexedFrame ) const
 {
     static const Inputs confirm = { MaxIndexedFrame, CC_BUTTON_CONFIRM << 4, CC_BUTTON_CONFIRM << 4 };
     static const Inputs down = { MaxIndexedFrame, 2, 2 };
     static const Inputs empty = { MaxIndexedFrame, 0, 0 };
 
-    if ( _modes[indexedFrame.parts.index] == CC_GAME_MODE_LOADING )
+    const uint32_t gameMode = getGameMode ( indexedFrame );
+
+    if ( gameMode == CC_GAME_MODE_LOADING )
         return ( ( indexedFrame.parts.frame % 2 ) ? empty : confirm );
 
-    if ( _modes[indexedFrame.parts.index] == CC_GAME_MODE_RETRY )
+    if ( gameMode == CC_GAME_MODE_RETRY )
     {
-        if ( _modes[indexedFrame.parts.index + 1] == CC_GAME_MODE_LOADING )
+        if ( getGameMode ( {{ 0, indexedFrame.parts.index + 1 }} ) == CC_GAME_MODE_LOADING )
             return ( ( indexedFrame.parts.frame % 2 ) ? empty : confirm );
 
         if ( indexedFrame.parts.frame == 30 )
@@ -254,73 +650,83 @@ const ReplayManager::Inputs& ReplayManager::getInputs ( IndexedFrame indexedFram
         return empty;
     }
 
-    if ( indexedFrame.parts.index >= _inputs.size()
-            || indexedFrame.parts.frame >= _inputs[indexedFrame.parts.index].size() )
-    {
+    const uint32_t offset = getFrameOffset ( indexedFrame );
+
+    if ( offset == UINT_MAX )
         return empty;
-    }
 
-    return _inputs[indexedFrame.parts.index][indexedFrame.parts.frame];
+    return { indexedFrame, _store.p1[offset], _store.p2[offset] };
 }
 
-IndexedFrame ReplayManager::getRollbackTarget ( IndexedFrame indexedFrame )
+IndexedFrame ReplayManager::getRollbackTarget ( IndexedFrame indexedFrame ) const
 {
-    if ( indexedFrame.parts.index >= _rollbacks.size()
-            || indexedFrame.parts.frame >= _rollbacks[indexedFrame.parts.index].size() )
-    {
+    const uint32_t offset = getFrameOffset ( indexedFrame );
+
+    if ( offset == UINT_MAX || ! _store.rollbackSlots[offset] )
         return MaxIndexedFrame;
-    }
 
-    return _rollbacks[indexedFrame.parts.index][indexedFrame.parts.frame];
+    return _store.rollbacks[_store.rollbackSlots[offset] - 1].target;
 }
 
-const vector<ReplayManager::Inputs>& ReplayManager::getReinputs ( IndexedFrame indexedFrame )
+ReplayManager::InputsRange ReplayManager::getReinputs ( IndexedFrame indexedFrame ) const
 {
-    if ( indexedFrame.parts.index >= _reinputs.size()
-            || indexedFrame.parts.frame >= _reinputs[indexedFrame.parts.index].size() )
-    {
-        static const vector<ReplayManager::Inputs> empty;
-        return empty;
-    }
+    const uint32_t offset = getFrameOffset ( indexedFrame );
+
+    if ( offset == UINT_MAX || ! _store.rollbackSlots[offset] )
+        return { 0, 0 };
 
-    return _reinputs[indexedFrame.parts.index][indexedFrame.parts.frame];
+    const StoreRollback& rollback = _store.rollbacks[_store.rollbackSlots[offset] - 1];
+
+    return { &_store.reinputs[rollback.reinputsBegin], &_store.reinputs[rollback.reinputsEnd] };
 }
 
-MsgPtr ReplayManager::getRngState ( IndexedFrame indexedFrame )
+MsgPtr ReplayManager::getRngState ( IndexedFrame indexedFrame ) const
 {
-    if ( indexedFrame.parts.index >= _rngStates.size() )
+    if ( indexedFrame.parts.index >= _store.header.numIndexes || ! _store.rngStateSlots[indexedFrame.parts.index] )
         return 0;
 
-    return _rngStates[indexedFrame.parts.index];
+    const char *bytes = &_store.rngStates[( _store.rngStateSlots[indexedFrame.parts.index] - 1 )
+                                          * SYNC_LOG_RNG_STATE_SIZE];
+
+    RngState *rngState = new RngState ( 0 );
+
+    memcpy ( &rngState->rngState0, &bytes[0], sizeof ( uint32_t ) );
+    memcpy ( &rngState->rngState1, &bytes[4], sizeof ( uint32_t ) );
+    memcpy ( &rngState->rngState2, &bytes[8], sizeof ( uint32_t ) );
+    copy ( &bytes[12], &bytes[12 + CC_RNG_STATE3_SIZE], rngState->rngState3.begin() );
+
+    return MsgPtr ( rngState );
 }
 
 uint32_t ReplayManager::getLastIndex() const
 {
-    if ( _inputs.empty() )
-        return 0;
-
-    return _inputs.size() - 1;
+    return _store.header.lastIndex;
 }
 
 uint32_t ReplayManager::getLastFrame() const
 {
-    if ( _inputs.empty() )
-        return 0;
-
-    if ( _inputs.back().empty() )
-        return 0;
-
-    return _inputs.back().size() - 1;
+    return _store.header.lastFrame;
 }
 
 MsgPtr ReplayManager::getInitialStateBefore ( uint32_t index ) const
 {
-    for ( int i = _initialStates.size() - 1; i >= 0; --i )
+    for ( int i = int ( _store.header.numInitialStates ) - 1; i >= 0; --i )
     {
-        ASSERT ( _initialStates[i].get() != 0 );
+        const StoreInitialState& entry = _store.initialStates[i];
+
+        if ( entry.index >= index )
+            continue;
+
+        InitialGameState *initialState = new InitialGameState ( { 0, entry.index } );
+
+        for ( uint8_t j = 0; j < 2; ++j )
+        {
+            initialState->chara[j] = entry.chara[j];
+            initialState->moon[j] = entry.moon[j];
+            initialState->color[j] = entry.color[j];
+        }
 
-        if ( _initialStates[i]->getAs<InitialGameState>().indexedFrame.parts.index < index )
-            return _initialStates[i];
+        return MsgPtr ( initialState );
     }
 
     return 0;
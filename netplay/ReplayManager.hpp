@@ -2,11 +2,27 @@
 
 #include "Constants.hpp"
 #include "Protocol.hpp"
+#include "SyncLog.hpp"
+#include "MappedFile.hpp"
 
 #include <string>
 #include <vector>
 
 
+// Magic bytes at the start of a replay store
+#define REPLAY_STORE_MAGIC          "CCREPSTR"
+
+#define REPLAY_STORE_VERSION        ( 1 )
+
+// Extension of the replay store cached next to a sync log
+#define REPLAY_STORE_EXT            ".store"
+
+
+// Replays the inputs, rollbacks, and RngStates from a sync log.
+//
+// A sync log is parsed once into a replay store, a columnar file that is cached next to it. The store has the inputs
+// of each frame as contiguous arrays, with the rollbacks, reinputs, and RngStates in tables indexed from those, so
+// loading a cached store is just a memory mapping and one pass to validate it, and every query is an array lookup.
 class ReplayManager
 {
 public:
@@ -17,19 +33,37 @@ public:
         uint16_t p1, p2;
     };
 
+    // Contiguous inputs in the store
+    struct InputsRange
+    {
+        const Inputs *first, *last;
+
+        const Inputs *begin() const { return first; }
+        const Inputs *end() const { return last; }
+
+        size_t size() const { return ( last - first ); }
+        bool empty() const { return ( first == last ); }
+    };
+
+    // Indicates if the file starts with the replay store magic
+    static bool isStore ( const std::string& file );
+
+    // Load a replay from a replay store, or from a sync log, either a binary sync log or text preprocessed by
+    // scripts/sync2replay. The store of a sync log is reused if it is up to date, otherwise it is rebuilt.
     bool load ( const std::string& replayFile, bool real );
 
-    uint32_t getGameMode ( IndexedFrame indexedFrame );
+    uint32_t getGameMode ( IndexedFrame indexedFrame ) const;
 
-    const std::string& getStateStr ( IndexedFrame indexedFrame );
+    // Unknown if there is no state for the index
+    NetplayState getState ( IndexedFrame indexedFrame ) const;
 
-    const Inputs& getInputs ( IndexedFrame indexedFrame );
+    Inputs getInputs ( IndexedFrame indexedFrame ) const;
 
-    IndexedFrame getRollbackTarget ( IndexedFrame indexedFrame );
+    IndexedFrame getRollbackTarget ( IndexedFrame indexedFrame ) const;
 
-    const std::vector<Inputs>& getReinputs ( IndexedFrame indexedFrame );
+    InputsRange getReinputs ( IndexedFrame indexedFrame ) const;
 
-    MsgPtr getRngState ( IndexedFrame indexedFrame );
+    MsgPtr getRngState ( IndexedFrame indexedFrame ) const;
 
     uint32_t getLastIndex() const;
 
@@ -39,9 +73,79 @@ public:
 
 private:
 
+    struct StoreHeader
+    {
+        char magic[8];
+
+        uint32_t version;
+
+        // If the store was built with the real flag, see load
+        uint32_t real;
+
+        uint32_t numIndexes, numFrames, numRollbacks, numReinputs, numRngStates, numInitialStates;
+
+        uint32_t lastIndex, lastFrame;
+
+        // Size and modification time of the sync log, to check if a cached store is up to date
+        uint64_t sourceSize;
+        int64_t sourceTime;
+    };
+
+    struct StoreRollback
+    {
+        IndexedFrame target;
+
+        // Range in the reinputs table
+        uint32_t reinputsBegin, reinputsEnd;
+    };
+
+    struct StoreInitialState
+    {
+        uint32_t index;
+
+        uint8_t chara[2], moon[2], color[2];
+    };
+
+    // Store tables, in file order. Per index tables have numIndexes entries, and per frame tables have numFrames.
+    struct Store
+    {
+        StoreHeader header;
+
+        // Per index game mode, and NetplayState
+        const uint32_t *modes;
+        const uint8_t *states;
+
+        // Offset of the first frame of each index in the per frame tables, with a final entry of numFrames
+        const uint32_t *frameOffsets;
+
+        // Per frame inputs
+        const uint16_t *p1, *p2;
+
+        // Per frame entry in the rollbacks table plus 1, or 0 if there was no rollback on that frame
+        const uint32_t *rollbackSlots;
+
+        const StoreRollback *rollbacks;
+
+        const Inputs *reinputs;
+
+        // Per index entry in the RngStates table plus 1, or 0 if there is no RngState
+        const uint32_t *rngStateSlots;
+
+        const char *rngStates;
+
+        const StoreInitialState *initialStates;
+    };
+
+    Store _store = Store();
+
+    // The store file, or the store built in memory if it couldn't be cached
+    MappedFile _mapped;
+    std::string _built;
+
+    // Tables built while parsing a sync log, these are converted to the store after loading
     std::vector<uint32_t> _modes;
 
-    std::vector<std::string> _states;
+    std::vector<NetplayState> _states;
 
     std::vector<std::vector<Inputs>> _inputs;
 
@@ -52,4 +156,23 @@ private:
     std::vector<std::vector<std::vector<Inputs>>> _reinputs;
 
     std::vector<MsgPtr> _initialStates;
+
+    bool loadText ( const std::string& replayFile, bool real );
+
+    bool loadBinary ( const std::string& replayFile, bool real );
+
+    void addRecord ( const SyncLogRecord& record, bool real );
+
+    // Convert the parsed tables into a store, and clear them
+    std::string buildStore ( bool real, uint64_t sourceSize, int64_t sourceTime );
+
+    // Point the tables of the store at their offsets from base, or null if base is null, returns the store size,
+    // or 0 if the counts in the header don't fit in memory
+    static size_t layoutStore ( Store& store, const char *base );
+
+    // Point the store tables into the data, returns false if it isn't a complete and consistent store
+    bool mapStore ( const char *data, size_t size );
+
+    // Offset of the frame in the per frame tables, or UINT_MAX if it isn't in the store
+    uint32_t getFrameOffset ( IndexedFrame indexedFrame ) const;
 };
@@ -0,0 +1,484 @@
+#include "SyncLog.hpp"
+#include "Logger.hpp"
+
+#include <vector>
+#include <cstring>
+
+using namespace std;
+
+
+static void putVarint ( string& buffer, uint32_t value )
+{
+    while ( value >= 0x80 )
+    {
+        buffer += char ( value | 0x80 );
+        value >>= 7;
+    }
+
+    buffer += char ( value );
+}
+
+static bool getVarint ( const char *data, size_t end, size_t& pos, uint32_t& value )
+{
+    value = 0;
+
+    for ( uint32_t shift = 0; pos < end && shift < 35; shift += 7 )
+    {
+        const uint8_t byte = data[pos++];
+
+        value |= uint32_t ( byte & 0x7F ) << shift;
+
+        if ( ! ( byte & 0x80 ) )
+            return true;
+    }
+
+    return false;
+}
+
+static int hexDigit ( char c )
+{
+    if ( c >= '0' && c <= '9' )
+        return c - '0';
+
+    if ( c >= 'a' && c <= 'f' )
+        return c - 'a' + 10;
+
+    return -1;
+}
+
+static string indexedFrameStr ( IndexedFrame indexedFrame )
+{
+    return to_string ( indexedFrame.parts.index ) + ':' + to_string ( indexedFrame.parts.frame );
+}
+
+
+string SyncLogRecord::toText() const
+{
+    if ( type == Raw )
+        return text;
+
+    string str = gameModeStr ( gameMode );
+
+    str += " [" + to_string ( gameMode ) + "] " + netplayState.str() + " [" + indexedFrameStr ( indexedFrame ) + "] ";
+
+    char buffer[64];
+
+    switch ( type )
+    {
+        case Inputs:
+        case Reinputs:
+            snprintf ( buffer, sizeof ( buffer ), "%s: 0x%04x 0x%04x",
+                       ( type == Inputs ? "Inputs" : "Reinputs" ), inputs[0], inputs[1] );
+            str += buffer;
+            break;
+
+        case RngState:
+            str += "RngState: " + formatAsHex ( &rngState[0], rngState.size() );
+            break;
+
+        case Rollback:
+            str += "Rollback: target=[" + indexedFrameStr ( target ) + "]; actual=[" + indexedFrameStr ( actual ) + ']';
+            break;
+
+        default:
+            str += text;
+            break;
+    }
+
+    return str;
+}
+
+SyncLogRecord SyncLogRecord::fromText ( const string& line )
+{
+    SyncLogRecord raw;
+    raw.text = line;
+
+    char mode[32], state[64];
+    uint32_t gameMode, index, frame;
+    int length = 0;
+
+    if ( sscanf ( line.c_str(), "%31s [%u] %63s [%u:%u] %n", mode, &gameMode, state, &index, &frame, &length ) != 5
+            || length == 0 )
+    {
+        return raw;
+    }
+
+    NetplayState netplayState;
+
+    if ( ! parseNetplayState ( state, netplayState ) )
+        return raw;
+
+    SyncLogRecord record ( Text, gameMode, netplayState, {{ frame, index }} );
+
+    const char *rest = line.c_str() + length;
+
+    if ( sscanf ( rest, "Inputs: 0x%hx 0x%hx", &record.inputs[0], &record.inputs[1] ) == 2 )
+    {
+        record.type = Inputs;
+    }
+    else if ( sscanf ( rest, "Reinputs: 0x%hx 0x%hx", &record.inputs[0], &record.inputs[1] ) == 2 )
+    {
+        record.type = Reinputs;
+    }
+    else if ( sscanf ( rest, "Rollback: target=[%u:%u]; actual=[%u:%u]",
+                       &record.target.parts.index, &record.target.parts.frame,
+                       &record.actual.parts.index, &record.actual.parts.frame ) == 4 )
+    {
+        record.type = Rollback;
+    }
+    else if ( strncmp ( rest, "RngState: ", 10 ) == 0
+              && strlen ( rest ) == 10 + 3 * SYNC_LOG_RNG_STATE_SIZE - 1 )
+    {
+        record.type = RngState;
+
+        for ( size_t i = 0; i < SYNC_LOG_RNG_STATE_SIZE; ++i )
+        {
+            const int hi = hexDigit ( rest[10 + 3 * i] ), lo = hexDigit ( rest[11 + 3 * i] );
+
+            if ( hi < 0 || lo < 0 )
+                return raw;
+
+            record.rngState[i] = char ( ( hi << 4 ) | lo );
+        }
+    }
+    else
+    {
+        record.text = rest;
+    }
+
+    // Only keep the parsed record if nothing was lost, eg extra spaces or upper case hex
+    if ( record.toText() != line )
+        return raw;
+
+    return record;
+}
+
+void SyncLogRecord::encode ( string& buffer ) const
+{
+    const size_t start = buffer.size();
+
+    buffer += char ( type );
+
+    if ( type != Raw )
+    {
+        putVarint ( buffer, gameMode );
+        buffer += char ( netplayState.value );
+        putVarint ( buffer, indexedFrame.parts.index );
+        putVarint ( buffer, indexedFrame.parts.frame );
+    }
+
+    switch ( type )
+    {
+        case Inputs:
+        case Reinputs:
+            for ( uint16_t input : inputs )
+            {
+                buffer += char ( input & 0xFF );
+                buffer += char ( input >> 8 );
+            }
+            break;
+
+        case RngState:
+            buffer.append ( &rngState[0], rngState.size() );
+            break;
+
+        case Rollback:
+            putVarint ( buffer, target.parts.index );
+            putVarint ( buffer, target.parts.frame );
+            putVarint ( buffer, actual.parts.index );
+            putVarint ( buffer, actual.parts.frame );
+            break;
+
+        default:
+            buffer += text;
+            break;
+    }
+
+    // Prefix the record with its size, so readers can skip types they don't know
+    string size;
+    putVarint ( size, buffer.size() - start );
+    buffer.insert ( start, size );
+}
+
+bool SyncLogRecord::decode ( const char *data, size_t size, size_t& pos )
+{
+    for ( ;; )
+    {
+        uint32_t length;
+
+        if ( ! getVarint ( data, size, pos, length ) || length == 0 || size - pos < length )
+            return false;
+
+        const size_t end = pos + length;
+        const uint8_t recordType = data[pos++];
+
+        if ( recordType >= NumTypes )
+        {
+            pos = end;
+            continue;
+        }
+
+        type = Type ( recordType );
+        text.clear();
+
+        if ( type != Raw )
+        {
+            if ( ! getVarint ( data, end, pos, gameMode ) || pos == end )
+                return false;
+
+            netplayState = NetplayState::Enum ( data[pos++] );
+
+            if ( ! getVarint ( data, end, pos, indexedFrame.parts.index )
+                    || ! getVarint ( data, end, pos, indexedFrame.parts.frame ) )
+            {
+                return false;
+            }
+        }
+
+        switch ( type )
+        {
+            case Inputs:
+            case Reinputs:
+                if ( end - pos < 4 )
+                    return false;
+
+                for ( uint16_t& input : inputs )
+                {
+                    input = uint8_t ( data[pos] ) | ( uint16_t ( uint8_t ( data[pos + 1] ) ) << 8 );
+                    pos += 2;
+                }
+                break;
+
+            case RngState:
+                if ( end - pos < rngState.size() )
+                    return false;
+
+                memcpy ( &rngState[0], &data[pos], rngState.size() );
+                break;
+
+            case Rollback:
+                if ( ! getVarint ( data, end, pos, target.parts.index )
+                        || ! getVarint ( data, end, pos, target.parts.frame )
+                        || ! getVarint ( data, end, pos, actual.parts.index )
+                        || ! getVarint ( data, end, pos, actual.parts.frame ) )
+                {
+                    return false;
+                }
+                break;
+
+            default:
+                text.assign ( &data[pos], end - pos );
+                break;
+        }
+
+        pos = end;
+        return true;
+    }
+}
+
+bool SyncLogRecord::parseNetplayState ( const string& name, NetplayState& netplayState )
+{
+    static const vector<string> names = []
+    {
+        vector<string> names;
+
+        for ( uint8_t i = 0;; ++i )
+        {
+            const string str = NetplayState ( NetplayState::Enum ( i ) ).str();
+
+            if ( str.compare ( 0, 9, "Unknown (" ) == 0 )
+                return names;
+
+            names.push_back ( str );
+        }
+    } ();
+
+    for ( size_t i = 0; i < names.size(); ++i )
+    {
+        if ( names[i] == name || names[i].compare ( 14, string::npos, name ) == 0 )
+        {
+            netplayState = NetplayState::Enum ( i );
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+SyncLogWriter::~SyncLogWriter()
+{
+    if ( ! _fd )
+        return;
+
+    // At process exit the writer thread may have already been terminated, so it can't be joined.
+    // The pending records are only written if it wasn't terminated in the middle of a write.
+    _writer->release();
+    _writer.release();
+
+    TryLock fileLock ( _fileMutex );
+    TryLock lock ( _mutex );
+
+    if ( ! fileLock.isLocked() || ! lock.isLocked() )
+        return;
+
+    fwrite ( _pending.data(), 1, _pending.size(), _fd );
+    fclose ( _fd );
+}
+
+bool SyncLogWriter::open ( const string& file )
+{
+    close();
+
+    _fd = fopen ( file.c_str(), "wb" );
+
+    if ( ! _fd )
+    {
+        LOG ( "Failed to open '%s'", file );
+        return false;
+    }
+
+    const char version = SYNC_LOG_VERSION;
+
+    fwrite ( SYNC_LOG_MAGIC, 1, strlen ( SYNC_LOG_MAGIC ), _fd );
+    fwrite ( &version, 1, 1, _fd );
+
+    _writerRunning = true;
+
+    _writer.reset ( new WriterThread ( *this ) );
+    _writer->start();
+    return true;
+}
+
+void SyncLogWriter::close()
+{
+    if ( ! _fd )
+        return;
+
+    {
+        LOCK ( _mutex );
+        _writerRunning = false;
+        _cond.signal();
+    }
+
+    // The writer thread writes the rest before stopping
+    _writer->join();
+    _writer.reset();
+
+    fclose ( _fd );
+    _fd = 0;
+}
+
+void SyncLogWriter::write ( const SyncLogRecord& record )
+{
+    if ( ! _fd )
+        return;
+
+    LOCK ( _mutex );
+    record.encode ( _pending );
+}
+
+void SyncLogWriter::writePending ( string& buffer )
+{
+    {
+        LOCK ( _mutex );
+        buffer.swap ( _pending );
+    }
+
+    if ( buffer.empty() )
+        return;
+
+    LOCK ( _fileMutex );
+
+    fwrite ( buffer.data(), 1, buffer.size(), _fd );
+    fflush ( _fd );
+
+    // Keep the capacity, the buffers are swapped back and forth
+    buffer.clear();
+}
+
+void SyncLogWriter::WriterThread::run()
+{
+    string buffer;
+
+    for ( ;; )
+    {
+        bool running;
+
+        {
+            Lock lock ( context._mutex );
+
+            if ( context._writerRunning )
+                context._cond.wait ( context._mutex, SYNC_LOG_WRITE_INTERVAL );
+
+            running = context._writerRunning;
+        }
+
+        context.writePending ( buffer );
+
+        if ( ! running )
+            return;
+    }
+}
+
+
+bool SyncLogReader::isBinary ( const string& file )
+{
+    FILE *fp = fopen ( file.c_str(), "rb" );
+
+    if ( ! fp )
+        return false;
+
+    char magic[sizeof ( SYNC_LOG_MAGIC ) - 1];
+
+    const bool binary = ( fread ( magic, 1, sizeof ( magic ), fp ) == sizeof ( magic )
+                          && memcmp ( magic, SYNC_LOG_MAGIC, sizeof ( magic ) ) == 0 );
+
+    fclose ( fp );
+    return binary;
+}
+
+bool SyncLogReader::open ( const string& file )
+{
+    _data.clear();
+    _pos = 0;
+
+    FILE *fp = fopen ( file.c_str(), "rb" );
+
+    if ( ! fp )
+        return false;
+
+    fseek ( fp, 0, SEEK_END );
+    const long size = ftell ( fp );
+    fseek ( fp, 0, SEEK_SET );
+
+    if ( size > 0 )
+    {
+        _data.resize ( size );
+        _data.resize ( fread ( &_data[0], 1, size, fp ) );
+    }
+
+    fclose ( fp );
+
+    const size_t header = sizeof ( SYNC_LOG_MAGIC ) - 1;
+
+    if ( _data.size() <= header || _data.compare ( 0, header, SYNC_LOG_MAGIC ) != 0 )
+    {
+        LOG ( "'%s' is not a binary sync log", file );
+        return false;
+    }
+
+    if ( _data[header] != SYNC_LOG_VERSION )
+    {
+        LOG ( "Unsupported sync log version %u", uint8_t ( _data[header] ) );
+        return false;
+    }
+
+    _pos = header + 1;
+    return true;
+}
+
+bool SyncLogReader::next ( SyncLogRecord& record )
+{
+    return record.decode ( _data.data(), _data.size(), _pos );
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "Constants.hpp"
+#include "NetplayStates.hpp"
+#include "Thread.hpp"
+
+#include <string>
+#include <array>
+#include <memory>
+#include <cstdio>
+#include <cstdint>
+
+
+// Magic bytes at the start of a binary sync log, followed by a single version byte
+#define SYNC_LOG_MAGIC              "CCSYNCLG"
+
+#define SYNC_LOG_VERSION            ( 1 )
+
+// Size of the raw RngState bytes, ie rngState0, rngState1, rngState2, then rngState3
+#define SYNC_LOG_RNG_STATE_SIZE     ( 3 * sizeof ( uint32_t ) + CC_RNG_STATE3_SIZE )
+
+// Milliseconds between writes of the pending records to the file
+#define SYNC_LOG_WRITE_INTERVAL     ( 100 )
+
+
+// One line of the sync log.
+//
+// Every record except Raw has the usual prefix of game mode, netplay state, and indexed frame. The lines that are
+// logged every frame have their own types with fixed size payloads, everything else is kept as text.
+struct SyncLogRecord
+{
+    enum Type : uint8_t
+    {
+        // Text without the prefix, eg desync dumps
+        Raw,
+
+        // Prefixed text
+        Text,
+
+        // "Inputs: 0x%04x 0x%04x"
+        Inputs,
+
+        // "Reinputs: 0x%04x 0x%04x"
+        Reinputs,
+
+        // "RngState: " followed by the hex dump
+        RngState,
+
+        // "Rollback: target=[%s]; actual=[%s]"
+        Rollback,
+
+        NumTypes
+    };
+
+    Type type = Raw;
+
+    uint32_t gameMode = 0;
+
+    NetplayState netplayState;
+
+    IndexedFrame indexedFrame = {{ 0, 0 }};
+
+    uint16_t inputs[2] = { 0, 0 };
+
+    IndexedFrame target = {{ 0, 0 }}, actual = {{ 0, 0 }};
+
+    std::array<char, SYNC_LOG_RNG_STATE_SIZE> rngState = {{ 0 }};
+
+    std::string text;
+
+    SyncLogRecord() {}
+
+    SyncLogRecord ( Type type, uint32_t gameMode, NetplayState netplayState, IndexedFrame indexedFrame )
+        : type ( type ), gameMode ( gameMode ), netplayState ( netplayState ), indexedFrame ( indexedFrame ) {}
+
+    // Format the record exactly as the text sync log line
+    std::string toText() const;
+
+    // Parse a text sync log line, lines that don't parse back to exactly the same text are kept as Raw
+    static SyncLogRecord fromText ( const std::string& line );
+
+    // Append the binary encoding of the record
+    void encode ( std::string& buffer ) const;
+
+    // Decode the record at pos and advance past it, returns false at the end of the data or if it is truncated.
+    // Records of unknown types are skipped.
+    bool decode ( const char *data, size_t size, size_t& pos );
+
+    // Parse a netplay state name with or without the "NetplayState::" prefix
+    static bool parseNetplayState ( const std::string& name, NetplayState& netplayState );
+};
+
+
+// Writes binary sync log records from a background thread, so logging a record only encodes it into memory
+class SyncLogWriter
+{
+public:
+
+    ~SyncLogWriter();
+
+    // Create the file and start the writer thread
+    bool open ( const std::string& file );
+
+    // Write any pending records and close the file
+    void close();
+
+    bool isOpen() const { return ( _fd != 0 ); }
+
+    void write ( const SyncLogRecord& record );
+
+private:
+
+    THREAD ( WriterThread, SyncLogWriter );
+
+    FILE *_fd = 0;
+
+    std::unique_ptr<WriterThread> _writer;
+
+    bool _writerRunning = false;
+
+    // Records encoded since the last write, guarded by _mutex
+    std::string _pending;
+
+    // Held while writing to the file, and to queue records or wake the writer thread
+    Mutex _fileMutex, _mutex;
+    CondVar _cond;
+
+    // Swap out the pending records and write them, only one thread may call this at a time
+    void writePending ( std::string& buffer );
+};
+
+
+// Reads a whole binary sync log into memory
+class SyncLogReader
+{
+public:
+
+    // Indicates if the file starts with the binary sync log magic
+    static bool isBinary ( const std::string& file );
+
+    // Read the file, returns false if it can't be read or isn't a binary sync log
+    bool open ( const std::string& file );
+
+    // Decode the next record, returns false at the end
+    bool next ( SyncLogRecord& record );
+
+private:
+
+    std::string _data;
+
+    size_t _pos = 0;
+};
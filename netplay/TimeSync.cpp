@@ -0,0 +1,75 @@
+#include "TimeSync.hpp"
+#include "Messages.hpp"
+#include "Algorithms.hpp"
+
+#include <cmath>
+
+using namespace std;
+
+
+void TimeSync::stamp ( PlayerInputs& playerInputs, uint8_t inputDelay ) const
+{
+    playerInputs.inputDelay = inputDelay;
+    playerInputs.frameAdvantage = int8_t ( clamped<double> ( round ( getLocalAdvantage() * 8 ), INT8_MIN, INT8_MAX ) );
+}
+
+void TimeSync::received ( const PlayerInputs& playerInputs, IndexedFrame indexedFrame )
+{
+    // Only compare frames in the same transition index
+    if ( playerInputs.getIndex() != indexedFrame.parts.index )
+        return;
+
+    if ( indexedFrame.parts.index != _index )
+    {
+        reset();
+        _index = indexedFrame.parts.index;
+    }
+
+    // The newest remote input is the sender's frame plus its input delay
+    const int32_t remoteFrame = int32_t ( playerInputs.getFrame() ) - playerInputs.inputDelay;
+    const int32_t advantage = int32_t ( indexedFrame.parts.frame ) - remoteFrame;
+
+    if ( _count < TIME_SYNC_WINDOW )
+        ++_count;
+    else
+        _sum -= _samples[_next];
+
+    _samples[_next] = advantage;
+    _sum += advantage;
+    _next = ( _next + 1 ) % TIME_SYNC_WINDOW;
+
+    _remoteAdvantage = playerInputs.frameAdvantage;
+}
+
+double TimeSync::getLocalAdvantage() const
+{
+    if ( _count == 0 )
+        return 0;
+
+    return double ( _sum ) / _count;
+}
+
+double TimeSync::getAdvantage() const
+{
+    if ( _count == 0 )
+        return 0;
+
+    return ( getLocalAdvantage() - _remoteAdvantage / 8.0 ) / 2;
+}
+
+double TimeSync::getFrameStretch() const
+{
+    const double advantage = getAdvantage();
+
+    if ( advantage < TIME_SYNC_MIN_ADVANTAGE )
+        return 0;
+
+    return min ( advantage / TIME_SYNC_RECOVERY_FRAMES, TIME_SYNC_MAX_STRETCH );
+}
+
+void TimeSync::reset()
+{
+    _count = _next = 0;
+    _sum = 0;
+    _remoteAdvantage = 0;
+}
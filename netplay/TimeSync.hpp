@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Constants.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+
+// Number of frame advantage samples averaged, ie input messages
+#define TIME_SYNC_WINDOW            ( 40 )
+
+// Minimum frame advantage before slowing down, so the sides don't keep correcting each other
+#define TIME_SYNC_MIN_ADVANTAGE     ( 0.5 )
+
+// Number of frames over which the frame advantage is recovered
+#define TIME_SYNC_RECOVERY_FRAMES   ( 60 )
+
+// Maximum fraction of a frame each frame is stretched by, 2% is about 0.33 ms per frame
+#define TIME_SYNC_MAX_STRETCH       ( 0.02 )
+
+
+struct PlayerInputs;
+
+
+// Keeps the frames of both sides aligned, in the style of GGPO's time sync.
+//
+// Each side measures its frame advantage as its current frame minus the remote frame when the last input message
+// was sent, and sends its average advantage with its inputs. Half the difference between the local and remote
+// advantages is how far ahead this side is, where the network latency cancels out. The side that is ahead stretches
+// its frames slightly, so it drifts back without a visible stall, instead of waiting for inputs or rolling back deeper.
+class TimeSync
+{
+public:
+
+    // Stamp outgoing inputs with the local input delay and frame advantage
+    void stamp ( PlayerInputs& playerInputs, uint8_t inputDelay ) const;
+
+    // Sample the frame advantage from incoming inputs, given the current local frame
+    void received ( const PlayerInputs& playerInputs, IndexedFrame indexedFrame );
+
+    // Get the average local frame advantage
+    double getLocalAdvantage() const;
+
+    // Get how many frames this side is ahead of the remote side, negative if behind
+    double getAdvantage() const;
+
+    // Get the fraction of a frame to stretch each frame by, 0 if this side is not ahead
+    double getFrameStretch() const;
+
+    void reset();
+
+private:
+
+    // Circular buffer of the last local frame advantage samples
+    std::array<int32_t, TIME_SYNC_WINDOW> _samples;
+
+    size_t _count = 0, _next = 0;
+
+    int32_t _sum = 0;
+
+    // Last remote frame advantage in eighths of a frame
+    int8_t _remoteAdvantage = 0;
+
+    // Transition index of the samples
+    uint32_t _index = 0;
+};
@@ -50,8 +50,6 @@ void DllControllerManager::updateControls ( uint16_t *localInputs )
     if ( stopping )
         return;
 
-    Lock lock ( ControllerManager::get().mutex );
-
     bool toggleTrialMenu = false;
     bool toggleOverlay = false;
     bool toggleHostBrowser = false;
@@ -84,6 +82,22 @@ void DllControllerManager::updateControls ( uint16_t *localInputs )
         toggleHostBrowser = true;
     }
 
+    // Don't wait on the polling thread while it holds the mutex, use the player inputs it last published instead.
+    // The overlay, hotkeys, and any controller that could be stickied still need the mutex, so they wait as before.
+    TryLock tryLock ( ControllerManager::get().mutex );
+
+    if ( ! tryLock.isLocked() && ! DllOverlayUi::isEnabled() && ! _controllersActive
+            && ! toggleTrialMenu && ! toggleOverlay && ! toggleHostBrowser )
+    {
+        if ( DllOverlayUi::isShowingMessage() )
+            DllOverlayUi::updateMessage();
+
+        readPlayerSnapshots ( localInputs );
+        return;
+    }
+
+    Lock lock ( ControllerManager::get().mutex );
+
     for ( Controller *controller : _allControllers )
     {
         // Don't sticky controllers if the overlay is enabled
@@ -243,29 +257,12 @@ void DllControllerManager::updateControls ( uint16_t *localInputs )
     if ( !DllOverlayUi::isEnabled() )
     {
         if ( _playerControllers[localPlayer - 1] ) {
-            uint16_t input = getInput ( _playerControllers[localPlayer - 1] );
-            if ( localPlayer == 1 ) {
-                if ( *CC_P1_FACING_FLAG_ADDR )
-                    input |= COMBINE_INPUT ( 0, CC_PLAYER_FACING );
-            }
-            if ( localPlayer == 2) {
-                if ( *CC_P2_FACING_FLAG_ADDR )
-                    input |= COMBINE_INPUT ( 0, CC_PLAYER_FACING );
-            }
-            localInputs[0] = input;
+            localInputs[0] = addFacing ( localPlayer, getInput ( _playerControllers[localPlayer - 1] ) );
+            localInputEventTime = _playerControllers[localPlayer - 1]->getStateTime();
         }
 
         if ( _playerControllers[remotePlayer - 1] ) {
-            uint16_t input = getInput ( _playerControllers[remotePlayer - 1] );
-            if ( remotePlayer == 1 ) {
-                if ( *CC_P1_FACING_FLAG_ADDR )
-                    input |= COMBINE_INPUT ( 0, CC_PLAYER_FACING );
-            }
-            if ( remotePlayer == 2) {
-                if ( *CC_P2_FACING_FLAG_ADDR )
-                    input |= COMBINE_INPUT ( 0, CC_PLAYER_FACING );
-            }
-            localInputs[1] = input;
+            localInputs[1] = addFacing ( remotePlayer, getInput ( _playerControllers[remotePlayer - 1] ) );
         }
         return;
     }
@@ -593,19 +590,19 @@ void DllControllerManager::handleTrialMenuOverlay()
         } else if ( ( controller->isJoystick() && isDirectionPressed ( controller, 4 ) )
                   || ( controller->isKeyboard() && KeyboardState::isPressed ( VK_LEFT ) ) ) {
             // Left input
-            LOG("Left");
+            LOG_AT ( Ui, DEBUG, "Left" );
             input = 4;
             break;
         } else if ( ( controller->isJoystick() && isDirectionPressed ( controller, 6 ) )
                 || ( controller->isKeyboard() && KeyboardState::isPressed ( VK_RIGHT ) ) ) {
             // Right input
-            LOG("Right");
+            LOG_AT ( Ui, DEBUG, "Right" );
             input = 6;
             break;
         } else if ( ( controller->isJoystick() && isDirectionPressed ( controller, 2 ) )
                   || ( controller->isKeyboard() && KeyboardState::isPressed ( VK_DOWN ) ) ) {
             // Down input
-            LOG("Down");
+            LOG_AT ( Ui, DEBUG, "Down" );
             input = 2;
             break;
         }
@@ -638,7 +635,7 @@ void DllControllerManager::handleTrialMenuOverlay()
     }
 
     if ( input == 4 ) {
-        LOG("four");
+        LOG_AT ( Ui, DEBUG, "four" );
         if ( _trialMenuIndex != 0 ) {
             _trialMenuSelection = 0;
             _trialMenuIndex = 0;
@@ -646,7 +643,7 @@ void DllControllerManager::handleTrialMenuOverlay()
             _trialOverlayPositions[1] = 0;
         }
     } else if ( input == 6 ) {
-        LOG("six");
+        LOG_AT ( Ui, DEBUG, "six" );
         if ( _trialMenuIndex == 0 ) {
             _trialMenuSelection = _trialOverlayPositions[0] + 1;
             _trialMenuIndex = 1;
@@ -1170,6 +1167,64 @@ void DllControllerManager::keyboardEvent ( uint32_t vkCode, uint32_t scanCode, b
     }
 }
 
+void DllControllerManager::readPlayerSnapshots ( uint16_t *localInputs )
+{
+    const PlayerSnapshot local = _playerSnapshots[localPlayer - 1].load();
+    const PlayerSnapshot remote = _playerSnapshots[remotePlayer - 1].load();
+
+    if ( local.attached )
+    {
+        localInputs[0] = addFacing ( localPlayer, local.input );
+        localInputEventTime = local.changeTime;
+    }
+
+    if ( remote.attached )
+        localInputs[1] = addFacing ( remotePlayer, remote.input );
+}
+
+uint16_t DllControllerManager::addFacing ( uint8_t player, uint16_t input )
+{
+    if ( ( player == 1 && *CC_P1_FACING_FLAG_ADDR ) || ( player == 2 && *CC_P2_FACING_FLAG_ADDR ) )
+        input |= COMBINE_INPUT ( 0, CC_PLAYER_FACING );
+
+    return input;
+}
+
+void DllControllerManager::controllersPolled()
+{
+    // This is a callback from within ControllerManager, so we don't need to lock the main mutex
+
+    for ( uint8_t i = 0; i < 2; ++i )
+    {
+        const Controller *controller = _playerControllers[i];
+
+        PlayerSnapshot snapshot = { 0, false, 0 };
+
+        if ( controller )
+        {
+            snapshot.input = getInput ( controller );
+            snapshot.attached = true;
+            snapshot.changeTime = controller->getStateTime();
+        }
+
+        _playerSnapshots[i].store ( snapshot );
+    }
+
+    // Same conditions as the sticky controllers and the 3 button toggles in updateControls
+    bool active = false;
+
+    for ( const Controller *controller : _allControllers )
+    {
+        if ( getInput ( controller ) && ( ! _playerControllers[0] || ! _playerControllers[1] ) )
+            active = true;
+
+        if ( numJoystickButtonsDown ( controller ) >= 3 && ! controller->getJoystickState().isNeutral() )
+            active = true;
+    }
+
+    _controllersActive = active;
+}
+
 void DllControllerManager::joystickAttached ( Controller *controller )
 {
     // This is a callback from within ControllerManager, so we don't need to lock the main mutex
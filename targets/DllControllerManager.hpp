@@ -5,11 +5,13 @@
 #include "ControllerManager.hpp"
 #include "Controller.hpp"
 #include "DllControllerUtils.hpp"
+#include "SeqLock.hpp"
 //#include "Enum.hpp"
 
 #include <vector>
 #include <array>
 #include <string>
+#include <atomic>
 
 /*
 TODO: Delete?
@@ -49,12 +51,16 @@ public:
     // Update local controls and overlay UI inputs
     void updateControls ( uint16_t *localInputs );
 
+    // Time the local player's joystick state last changed in microseconds, updated with the local controls
+    uint64_t localInputEventTime = 0;
+
     // KeyboardManager callback
     void keyboardEvent ( uint32_t vkCode, uint32_t scanCode, bool isExtended, bool isDown ) override;
 
     // ControllerManager callbacks
     void joystickAttached ( Controller *controller ) override;
     void joystickToBeDetached ( Controller *controller ) override;
+    void controllersPolled() override;
 
     // Controller callback
     void controllerKeyMapped ( Controller *controller, uint32_t key ) override;
@@ -75,6 +81,24 @@ private:
 
     std::array<Controller *, 2> _playerControllers = {{ 0, 0 }};
 
+    // Player inputs as of the last poll, published so the frame thread can read them without waiting for the mutex
+    struct PlayerSnapshot
+    {
+        uint16_t input;
+
+        // Indicates if a controller is assigned to the player
+        bool attached;
+
+        // Time the controller state last changed in microseconds
+        uint64_t changeTime;
+    };
+
+    std::array<SeqLock<PlayerSnapshot>, 2> _playerSnapshots;
+
+    // Set by the last poll if a controller could be stickied, or is holding the overlay toggle.
+    // Then the frame thread waits for the mutex, since it has to check the controllers.
+    std::atomic<bool> _controllersActive { false };
+
     std::array<size_t, 2> _overlayPositions = {{ 0, 0 }};
     std::array<size_t, 3> _trialOverlayPositions = {{ 0, 0, 0 }};
     uint8_t _trialMenuIndex = 0;
@@ -86,6 +110,12 @@ private:
 
     bool _controllerAttached = false;
 
+    // Update the player inputs from the last published snapshots
+    void readPlayerSnapshots ( uint16_t *localInputs );
+
+    // Add the player's facing flag to an input
+    static uint16_t addFacing ( uint8_t player, uint16_t input );
+
     void handleInputEditor();
     void handleTrialMenuOverlay();
     void deleteTrialRow( int row );
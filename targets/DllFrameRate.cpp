@@ -3,8 +3,12 @@
 #include "Constants.hpp"
 #include "ProcessManager.hpp"
 #include "DllAsmHacks.hpp"
+#include "DllInputLatency.hpp"
+#include "FramePacer.hpp"
+#include "Statistics.hpp"
 
 #include <d3dx9.h>
+#include <mmsystem.h>
 
 using namespace std;
 using namespace DllFrameRate;
@@ -17,9 +21,38 @@ double desiredFps = 60.0;
 
 double actualFps = 60.0;
 
+double frameStretch = 0.0;
+
 bool isEnabled = false;
 
 
+// Microsecond clock from the timer manager, sleeping with a 1 ms timer resolution
+struct WinClock : public FramePacer::Clock
+{
+    WinClock()
+    {
+        timeBeginPeriod ( 1 );
+    }
+
+    ~WinClock()
+    {
+        timeEndPeriod ( 1 );
+    }
+
+    uint64_t getNow() override
+    {
+        return TimerManager::get().getNowUs ( true );
+    }
+
+    void sleep ( uint64_t microseconds ) override
+    {
+        // Sleep only has millisecond resolution, the pacer spins the remainder
+        if ( microseconds >= 1000 )
+            Sleep ( DWORD ( microseconds / 1000 ) );
+    }
+};
+
+
 void enable()
 {
     if ( isEnabled )
@@ -37,56 +70,54 @@ void enable()
 }
 
 
-void PresentFrameEnd ( IDirect3DDevice9 *device )
+static void paceFrame()
 {
-    if ( !isEnabled || *CC_SKIP_FRAMES_ADDR )
-        return;
-
-    static uint64_t last1f = 0, last5f = 0, last30f = 0, last60f = 0;
+    static WinClock clock;
+    static FramePacer pacer ( clock );
+    static Statistics intervals, jitter;
+    static uint64_t last60f = 0;
     static uint8_t counter = 0;
 
-    ++counter;
+    // Stretching each frame is the same as a slightly lower FPS, the absolute schedule keeps this accurate on average
+    pacer.setFps ( desiredFps / ( 1.0 + frameStretch ) );
+    pacer.wait();
 
-    uint64_t now = TimerManager::get().getNow ( true );
-
-    /**
-     * The best timer resolution is only in milliseconds, and we need to make
-     * sure the spacing between frames is as close to even as possible.
-     *
-     * What this code does is check every 30f, 5f, and 1f how many milliseconds have
-     * passed since the last check and make sure we are close to or under the desired FPS.
-     */
-    if ( counter % 30 == 0 )
+    if ( pacer.getLastInterval() )
     {
-        while ( now - last30f < ( 30 * 1000 ) / desiredFps )
-            now = TimerManager::get().getNow ( true );
-
-        last30f = now;
+        intervals.addSample ( double ( pacer.getLastInterval() ) );
+        jitter.addSample ( double ( pacer.getLastJitter() ) );
     }
-    else if ( counter % 5 == 0 )
-    {
-        while ( now - last5f < ( 5 * 1000 ) / desiredFps )
-            now = TimerManager::get().getNow ( true );
 
-        last5f = now;
-    }
-    else
+    if ( ++counter >= 60 )
     {
-        while ( now - last1f < 1000 / desiredFps )
-            now = TimerManager::get().getNow ( true );
-    }
+        const uint64_t now = clock.getNow();
 
-    last1f = now;
+        actualFps = 1e6 / ( ( now - last60f ) / 60.0 );
 
-    if ( counter >= 60 )
-    {
-        now = TimerManager::get().getNow ( true );
+        *CC_FPS_COUNTER_ADDR = uint32_t ( actualFps + 0.5 );
 
-        actualFps = 1000.0 / ( ( now - last60f ) / 60.0 );
+        LOG_AT ( Frame, DEBUG, "interval: mean=%.0f us; stddev=%.0f us; jitter: p50=%.0f us; p99=%.0f us; "
+                 "worst=%.0f us; spin=%llu us", intervals.getMean(), intervals.getStdDev(), jitter.getQuantile ( 0.5 ),
+                 jitter.getQuantile ( 0.99 ), jitter.getWorst(), pacer.getSpinMargin() );
 
-        *CC_FPS_COUNTER_ADDR = uint32_t ( actualFps + 0.5 );
+        intervals.reset();
+        jitter.reset();
 
         counter = 0;
         last60f = now;
     }
 }
+
+
+void PresentFrameEnd ( IDirect3DDevice9 *device )
+{
+    // Skipped frames are not presented
+    if ( *CC_SKIP_FRAMES_ADDR )
+        return;
+
+    // The frame was just presented, the pacing wait is before the next frame
+    DllInputLatency::framePresented();
+
+    if ( isEnabled )
+        paceFrame();
+}
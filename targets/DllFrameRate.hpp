@@ -10,6 +10,9 @@ extern double desiredFps;
 
 extern double actualFps;
 
+// Fraction of a frame to stretch each frame by, to slow down slightly without skipping frames, see TimeSync
+extern double frameStretch;
+
 void enable();
 
 }
@@ -0,0 +1,240 @@
+#include "DllInputLatency.hpp"
+#include "TimerManager.hpp"
+#include "Statistics.hpp"
+#include "StringUtils.hpp"
+#include "Logger.hpp"
+
+#include <array>
+#include <algorithm>
+#include <cstdio>
+
+using namespace std;
+
+
+// Width of each histogram bucket in microseconds
+#define BUCKET_WIDTH                ( 500 )
+
+// Number of histogram buckets, latencies past the last bucket are clamped into it
+#define NUM_BUCKETS                 ( 400 )
+
+
+static const char *stageNames[DllInputLatency::NumStages] = { "poll", "buffer", "present", "total" };
+
+
+namespace DllInputLatency
+{
+
+struct Trace
+{
+    uint16_t input;
+
+    // Frame the input was buffered for
+    IndexedFrame indexedFrame;
+
+    // Times of each stage, eventTime is 0 if unknown, writtenTime is 0 until written
+    uint64_t eventTime, sampleTime, writtenTime;
+};
+
+// Pending traces in order of frame
+static array<Trace, INPUT_LATENCY_MAX_TRACES> traces;
+static size_t numTraces = 0;
+
+// Last buffered input, only changes are traced
+static uint16_t lastInput = 0;
+static uint64_t lastSampleTime = 0;
+
+// Session histograms and statistics, and statistics of the inputs since the last overlay update
+static array<array<uint32_t, NUM_BUCKETS>, NumStages> histograms;
+static array<Statistics, NumStages> sessionStats, windowStats;
+
+static size_t numSamples = 0;
+
+static bool overlayEnabled = false;
+
+static string overlayText;
+
+
+static void updateOverlayText()
+{
+    overlayText = format ( "Input latency (last %u inputs)", windowStats[Total].getNumSamples() );
+
+    for ( uint8_t stage = 0; stage < NumStages; ++stage )
+    {
+        const Statistics& stats = windowStats[stage];
+
+        if ( ! stats.getNumSamples() )
+        {
+            overlayText += format ( "\n%s: -", stageNames[stage] );
+            continue;
+        }
+
+        overlayText += format ( "\n%s: p50 %.2f p90 %.2f p99 %.2f max %.2f ms", stageNames[stage],
+                                stats.getQuantile ( 0.5 ) / 1000, stats.getQuantile ( 0.9 ) / 1000,
+                                stats.getQuantile ( 0.99 ) / 1000, stats.getWorst() / 1000 );
+    }
+}
+
+static void addSample ( Stage stage, uint64_t latency )
+{
+    ++histograms[stage][min<uint64_t> ( latency / BUCKET_WIDTH, NUM_BUCKETS - 1 )];
+    sessionStats[stage].addSample ( latency );
+    windowStats[stage].addSample ( latency );
+}
+
+template<typename F>
+static void removeTraces ( const F& predicate )
+{
+    numTraces = remove_if ( traces.begin(), traces.begin() + numTraces, predicate ) - traces.begin();
+}
+
+
+void inputBuffered ( uint16_t input, uint64_t eventTime, uint64_t sampleTime, IndexedFrame indexedFrame )
+{
+    if ( input == lastInput )
+        return;
+
+    // The controller event must be between the last sample and this one, otherwise it wasn't for this input
+    if ( eventTime > sampleTime || eventTime < lastSampleTime )
+        eventTime = 0;
+
+    lastInput = input;
+    lastSampleTime = sampleTime;
+
+    // Drop the oldest trace if too many inputs are waiting, ie the frames aren't advancing
+    if ( numTraces == traces.size() )
+    {
+        copy ( traces.begin() + 1, traces.end(), traces.begin() );
+        --numTraces;
+    }
+
+    traces[numTraces++] = { input, indexedFrame, eventTime, sampleTime, 0 };
+}
+
+void inputWritten ( uint16_t input, IndexedFrame indexedFrame )
+{
+    const uint64_t now = TimerManager::queryNowUs();
+
+    for ( size_t i = 0; i < numTraces; ++i )
+        if ( ! traces[i].writtenTime && traces[i].indexedFrame.value == indexedFrame.value && traces[i].input == input )
+            traces[i].writtenTime = now;
+
+    // Drop any traces that were replaced before their frame, or whose frame was passed, eg on a transition
+    removeTraces ( [&] ( const Trace& trace )
+    {
+        return ! trace.writtenTime && trace.indexedFrame.value <= indexedFrame.value;
+    } );
+}
+
+void framePresented()
+{
+    if ( ! numTraces )
+        return;
+
+    const uint64_t now = TimerManager::queryNowUs();
+
+    for ( size_t i = 0; i < numTraces; ++i )
+    {
+        const Trace& trace = traces[i];
+
+        if ( ! trace.writtenTime )
+            continue;
+
+        if ( trace.eventTime )
+            addSample ( Poll, trace.sampleTime - trace.eventTime );
+
+        addSample ( Buffer, trace.writtenTime - trace.sampleTime );
+        addSample ( Present, now - trace.writtenTime );
+        addSample ( Total, now - ( trace.eventTime ? trace.eventTime : trace.sampleTime ) );
+
+        ++numSamples;
+
+        if ( numSamples % INPUT_LATENCY_WINDOW == 0 )
+        {
+            if ( overlayEnabled )
+                updateOverlayText();
+
+            for ( auto& stats : windowStats )
+                stats.reset();
+        }
+    }
+
+    removeTraces ( [] ( const Trace& trace ) { return trace.writtenTime != 0; } );
+}
+
+void toggleOverlay()
+{
+    overlayEnabled = !overlayEnabled;
+
+    if ( overlayEnabled )
+        updateOverlayText();
+    else
+        overlayText.clear();
+}
+
+bool isOverlayEnabled()
+{
+    return overlayEnabled;
+}
+
+const string& getOverlayText()
+{
+    return overlayText;
+}
+
+bool dumpHistogram ( const string& file )
+{
+    FILE *fp = fopen ( file.c_str(), "w" );
+
+    if ( ! fp )
+    {
+        LOG ( "Failed to open '%s'", file );
+        return false;
+    }
+
+    fprintf ( fp, "# Input latency: %u inputs\n", numSamples );
+
+    for ( uint8_t stage = 0; stage < NumStages; ++stage )
+    {
+        const Statistics& stats = sessionStats[stage];
+
+        fprintf ( fp, "\n[%s] count=%u; mean=%.1fus; stddev=%.1fus; p50=%.0fus; p90=%.0fus; p99=%.0fus; worst=%.0fus\n",
+                  stageNames[stage], stats.getNumSamples(), stats.getMean(), stats.getStdDev(),
+                  stats.getQuantile ( 0.5 ), stats.getQuantile ( 0.9 ), stats.getQuantile ( 0.99 ),
+                  stats.getNumSamples() ? stats.getWorst() : 0.0 );
+
+        for ( uint32_t i = 0; i < NUM_BUCKETS; ++i )
+            if ( histograms[stage][i] )
+                fprintf ( fp, "%u %u\n", i * BUCKET_WIDTH, histograms[stage][i] );
+    }
+
+    fclose ( fp );
+
+    LOG ( "Dumped input latency to '%s'", file );
+    return true;
+}
+
+size_t getNumSamples()
+{
+    return numSamples;
+}
+
+void reset()
+{
+    numTraces = 0;
+    lastInput = 0;
+    lastSampleTime = 0;
+    numSamples = 0;
+
+    for ( auto& histogram : histograms )
+        histogram.fill ( 0 );
+
+    for ( auto& stats : sessionStats )
+        stats.reset();
+
+    for ( auto& stats : windowStats )
+        stats.reset();
+
+    overlayText.clear();
+}
+
+}
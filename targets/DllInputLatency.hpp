@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Constants.hpp"
+
+#include <string>
+#include <cstdint>
+
+
+// Number of local inputs traced at the same time, ie changed inputs waiting for their delayed frame
+#define INPUT_LATENCY_MAX_TRACES    ( 32 )
+
+// Number of completed traces between overlay text updates
+#define INPUT_LATENCY_WINDOW        ( 60 )
+
+
+// Traces each change of the local input from the controller to the screen, all times are in microseconds.
+//
+// A trace starts when the controller state changes, is sampled at the start of the frame, then buffered by the
+// netplay manager until the delayed frame where it is written to the game, and ends on the next present.
+// The time between each stage is accumulated into per-stage latency histograms.
+namespace DllInputLatency
+{
+
+enum Stage : uint8_t
+{
+    // Controller event, or the poll that first saw a keyboard change, until the input is sampled for a frame
+    Poll,
+
+    // Sampled until written to the game, ie the input delay
+    Buffer,
+
+    // Written to the game until the frame is presented
+    Present,
+
+    // Controller event, or sampled if unknown, until presented
+    Total,
+
+    NumStages
+};
+
+// The local input was sampled and buffered for the given frame, eventTime is the controller state change or 0
+void inputBuffered ( uint16_t input, uint64_t eventTime, uint64_t sampleTime, IndexedFrame indexedFrame );
+
+// The local input was written to the game for the given frame, this may be called again when re-running frames
+void inputWritten ( uint16_t input, IndexedFrame indexedFrame );
+
+// A frame was presented, this completes the traces written before it
+void framePresented();
+
+// Per-stage latency percentiles of recent inputs shown in the overlay
+void toggleOverlay();
+bool isOverlayEnabled();
+const std::string& getOverlayText();
+
+// Write the session histograms to a text file
+bool dumpHistogram ( const std::string& file );
+
+// Number of traces completed this session
+size_t getNumSamples();
+
+// Clear all traces and histograms
+void reset();
+
+}
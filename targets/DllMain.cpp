@@ -15,7 +15,13 @@
 #include "DllControllerManager.hpp"
 #include "DllFrameRate.hpp"
 #include "ReplayManager.hpp"
+#include "SyncLog.hpp"
+#include "DelayTuner.hpp"
+#include "TimeSync.hpp"
 #include "DllRollbackManager.hpp"
+#include "DllRollbackProfiler.hpp"
+#include "DllInputLatency.hpp"
+#include "DllMemoryCapture.hpp"
 #include "DllTrialManager.hpp"
 #include "ExternalIpAddress.hpp"
 
@@ -57,9 +63,24 @@ void udpLogMain(const char* message) {
 // The main log file path
 #define LOG_FILE                    FOLDER "dll.log"
 
+// The rollback profiler histogram dump path
+#define ROLLBACK_PROFILE_FILE       FOLDER "rollback_profile.txt"
+
+// The input latency histogram dump path
+#define INPUT_LATENCY_FILE          FOLDER "input_latency.txt"
+
 // The number of milliseconds to poll for events each frame
 #define POLL_TIMEOUT                ( 3 )
 
+// The saved rollback states dump path on desync, formatted with "host" or "client"
+#define DESYNC_STATES_FILE          FOLDER "desync_states_%s.bin"
+
+// The raw game memory capture path
+#define MEMORY_CAPTURE_FILE         FOLDER "memory_capture.bin"
+
+// The number of frames between full rollback state hashes, the state is hashed while it is saved
+#define STATE_HASH_INTERVAL         ( 10 )
+
 // The extra number of frames to delay checking round over state during rollback
 #define ROLLBACK_ROUND_OVER_DELAY   ( 5 )
 
@@ -87,10 +108,29 @@ void udpLogMain(const char* message) {
                                       : numSpectators() >= MAX_ROOT_SPECTATORS )
 
 
+#ifdef DISABLE_LOGGING
+
+#define LOG_SYNC(FORMAT, ...)
+
+#define LOG_SYNC_RAW(FORMAT, ...)
+
+#else
+
+// Log a sync log line prefixed with the game mode, netplay state, and frame
 #define LOG_SYNC(FORMAT, ...)                                                                                       \
-    LOG_TO ( syncLog, "%s [%u] %s [%s] " FORMAT,                                                                    \
-             gameModeStr ( *CC_GAME_MODE_ADDR ), *CC_GAME_MODE_ADDR,                                                \
-             netMan.getState(), netMan.getIndexedFrame(), ## __VA_ARGS__ )
+    do {                                                                                                            \
+        if ( isSyncLogOpen() )                                                                                      \
+            logSync ( syncRecord ( SyncLogRecord::Text, format ( FORMAT, ## __VA_ARGS__ ) ) );                      \
+    } while ( 0 )
+
+// Log a sync log line without the prefix
+#define LOG_SYNC_RAW(FORMAT, ...)                                                                                   \
+    do {                                                                                                            \
+        if ( isSyncLogOpen() )                                                                                      \
+            logSync ( syncRecord ( SyncLogRecord::Raw, format ( FORMAT, ## __VA_ARGS__ ) ) );                       \
+    } while ( 0 )
+
+#endif // DISABLE_LOGGING
 
 #define LOG_SYNC_CHARACTER(N)                                                                                       \
     LOG_SYNC ( "P%u: C=%u; M=%u; c=%u; seq=%u; st=%u; hp=%u; rh=%u; gb=%.1f; gq=%.1f; mt=%u; ht=%u; x=%d; y=%d; f=%d",    \
@@ -200,6 +240,9 @@ struct DllMain
     // Local player inputs
     array<uint16_t, 2> localInputs = {{ 0, 0 }};
 
+    // Time the local inputs were sampled in microseconds, for input latency tracing
+    uint64_t localInputsSampleTime = 0;
+
     // If we have sent our local retry menu index
     bool localRetryMenuIndexSent = false;
 
@@ -220,6 +263,15 @@ struct DllMain
     // Latest ChangeConfig for changing delay/rollback
     ChangeConfig changeConfig;
 
+    // Samples the round trip time during the match, and proposes the delay for auto delay
+    DelayTuner delayTuner;
+
+    // If the rollback input delay should be adjusted automatically at the start of each round
+    bool autoDelay = false;
+
+    // Measures the frame advantage against the remote side, to stretch frames when ahead
+    TimeSync timeSync;
+
     // Client serverCtrlSocket address
     IpAddrPort clientServerAddr;
 
@@ -241,10 +293,17 @@ struct DllMain
 
     ExternalIpAddress externalIpAddress;
 
+    // Binary sync log, written instead of the text sync log if enabled
+    SyncLogWriter syncLogBinary;
+
 #ifndef RELEASE
     // Local and remote SyncHashes
     list<MsgPtr> localSync, remoteSync;
 
+    // Local and remote StateHashes, and the hashed frames waiting for remote inputs to be confirmed
+    list<MsgPtr> localStateSync, remoteStateSync;
+    list<IndexedFrame> pendingStateHashes;
+
     // Debug testing flags
     bool randomInputs = false;
     bool randomDelay = false;
@@ -258,6 +317,145 @@ struct DllMain
     IndexedFrame replayStop = MaxIndexedFrame;
     IndexedFrame replayCheck = MaxIndexedFrame;
     string replayCheckRngHexStr;
+
+    // Replay keyframes for seeking, and the frame being fast-forwarded to, MaxIndexedFrame if not seeking
+    ReplayKeyframes replayKeyframes;
+    IndexedFrame replaySeek = MaxIndexedFrame;
+#endif // NOT RELEASE
+
+    bool isSyncLogOpen() const
+    {
+        return ( syncLogBinary.isOpen() || syncLog.isInitialized() );
+    }
+
+    // Sync log record of the current game mode, netplay state, and frame
+    SyncLogRecord syncRecord ( SyncLogRecord::Type type, const string& text = "" )
+    {
+        SyncLogRecord record ( type, *CC_GAME_MODE_ADDR, netMan.getState(), netMan.getIndexedFrame() );
+        record.text = text;
+        return record;
+    }
+
+    void logSync ( const SyncLogRecord& record )
+    {
+#ifndef DISABLE_LOGGING
+        if ( syncLogBinary.isOpen() )
+            syncLogBinary.write ( record );
+        else if ( syncLog.isInitialized() )
+            syncLog.log ( __BASE_FILE__, __LINE__, __PRETTY_FUNCTION__, record.toText().c_str() );
+#endif // NOT DISABLE_LOGGING
+    }
+
+    void logSyncInputs ( SyncLogRecord::Type type )
+    {
+        if ( ! isSyncLogOpen() )
+            return;
+
+        SyncLogRecord record = syncRecord ( type );
+        record.inputs[0] = netMan.getRawInput ( 1 );
+        record.inputs[1] = netMan.getRawInput ( 2 );
+        logSync ( record );
+    }
+
+    void logSyncRngState ( const RngState& rngState )
+    {
+        if ( ! isSyncLogOpen() )
+            return;
+
+        SyncLogRecord record = syncRecord ( SyncLogRecord::RngState );
+        memcpy ( &record.rngState[0], &rngState.rngState0, sizeof ( uint32_t ) );
+        memcpy ( &record.rngState[4], &rngState.rngState1, sizeof ( uint32_t ) );
+        memcpy ( &record.rngState[8], &rngState.rngState2, sizeof ( uint32_t ) );
+        copy ( rngState.rngState3.begin(), rngState.rngState3.end(), &record.rngState[12] );
+        logSync ( record );
+    }
+
+    void closeSyncLog()
+    {
+        syncLog.deinitialize();
+        syncLogBinary.close();
+    }
+
+    // Match up the local and remote hashes by frame, dropping any the other side didn't send.
+    // Returns false after logging both hashes if they don't match.
+    template<typename T>
+    bool compareHashes ( list<MsgPtr>& local, list<MsgPtr>& remote, const char *desync )
+    {
+        while ( !local.empty() && !remote.empty() )
+        {
+
+#define L local.front()->getAs<T>()
+#define R remote.front()->getAs<T>()
+
+            while ( !remote.empty() && L.indexedFrame.value > R.indexedFrame.value )
+                remote.pop_front();
+
+            if ( remote.empty() )
+                break;
+
+            while ( !local.empty() && R.indexedFrame.value > L.indexedFrame.value )
+                local.pop_front();
+
+            if ( local.empty() )
+                break;
+
+            if ( L == R )
+            {
+                local.pop_front();
+                remote.pop_front();
+                continue;
+            }
+
+            LOG_SYNC_RAW ( "%s:", desync );
+            LOG_SYNC_RAW ( "< %s", L.dump() );
+            LOG_SYNC_RAW ( "> %s", R.dump() );
+
+#undef L
+#undef R
+
+            return false;
+        }
+
+        return true;
+    }
+
+#ifndef RELEASE
+    // Restore the nearest replay keyframe at or before the target, and skip rendering the next frame
+    bool loadReplayKeyframe ( IndexedFrame target )
+    {
+        const ReplayKeyframes::Keyframe *keyframe = replayKeyframes.find ( target );
+
+        if ( ! keyframe || ! rollMan.loadKeyframe ( *keyframe, netMan ) )
+            return false;
+
+        *CC_SKIP_FRAMES_ADDR = 1;
+        return true;
+    }
+
+    // Seek the replay to the target, returns true if a keyframe was restored
+    bool seekReplay ( IndexedFrame target )
+    {
+        const IndexedFrame current = netMan.getIndexedFrame();
+        const ReplayKeyframes::Keyframe *keyframe = replayKeyframes.find ( target );
+
+        // Seeking forward only restores a keyframe if there is one after the current frame
+        if ( keyframe && ( target.value < current.value || keyframe->indexedFrame.value > current.value ) )
+        {
+            if ( loadReplayKeyframe ( target ) )
+            {
+                replaySeek = target;
+                return true;
+            }
+        }
+        else if ( target.value > current.value )
+        {
+            replaySeek = target;
+            return false;
+        }
+
+        DllOverlayUi::showMessage ( format ( "No keyframe to seek to [%s]", target ) );
+        return false;
+    }
 #endif // NOT RELEASE
 
     void frameStepNormal()
@@ -282,7 +480,27 @@ struct DllMain
                 if ( netMan.getRollback() )
                 {
                     // Only save rollback states in-game
+                    DllRollbackProfiler::begin ( DllRollbackProfiler::Save );
+#ifdef RELEASE
                     rollMan.saveState ( netMan );
+#else
+                    if ( netMan.getFrame() % STATE_HASH_INTERVAL == 0 && dataSocket && dataSocket->isConnected() )
+                    {
+                        rollMan.saveState ( netMan, true );
+                        pendingStateHashes.push_back ( netMan.getIndexedFrame() );
+                    }
+                    else
+                    {
+                        rollMan.saveState ( netMan );
+                    }
+#endif // RELEASE
+                    DllRollbackProfiler::end ( DllRollbackProfiler::Save );
+
+#ifndef RELEASE
+                    // Save replay keyframes for seeking, outside of the profiled save
+                    if ( replayInputs && replayKeyframes.isDue ( netMan.getIndexedFrame() ) )
+                        rollMan.saveKeyframe ( netMan, replayKeyframes );
+#endif // NOT RELEASE
 
                     // Delayed round over check
                     if ( roundOverTimer > 0 )
@@ -338,6 +556,7 @@ struct DllMain
                 // Update controller state once per frame
                 KeyboardState::update();
                 updateControls ( &localInputs[0] );
+                localInputsSampleTime = TimerManager::queryNowUs();
                 while ( framestepEnabled && !netMan.config.mode.isOnline() ) {
                     if ( ( GetAsyncKeyState ( VK_F6 ) & 0x1 )  == 1 )
                         framestepEnabled = false;
@@ -402,6 +621,36 @@ struct DllMain
                         }
                     }
 
+                    // Toggle the rollback profiler overlay, Shift for the input latency overlay instead.
+                    // Ctrl dumps the session histograms instead of toggling.
+                    if ( KeyboardState::isPressed ( VK_F8 ) )
+                    {
+                        const bool inputLatency = KeyboardState::isDown ( VK_SHIFT );
+
+                        if ( KeyboardState::isDown ( VK_CONTROL ) && inputLatency )
+                        {
+                            const string file = ProcessManager::appDir + INPUT_LATENCY_FILE;
+
+                            if ( DllInputLatency::dumpHistogram ( file ) )
+                                DllOverlayUi::showMessage ( "Saved input latency to " INPUT_LATENCY_FILE );
+                        }
+                        else if ( KeyboardState::isDown ( VK_CONTROL ) )
+                        {
+                            const string file = ProcessManager::appDir + ROLLBACK_PROFILE_FILE;
+
+                            if ( DllRollbackProfiler::dumpHistogram ( file ) )
+                                DllOverlayUi::showMessage ( "Saved rollback profile to " ROLLBACK_PROFILE_FILE );
+                        }
+                        else if ( inputLatency )
+                        {
+                            DllInputLatency::toggleOverlay();
+                        }
+                        else
+                        {
+                            DllRollbackProfiler::toggleOverlay();
+                        }
+                    }
+
 #ifndef RELEASE
                     // Test random delay setting
                     if ( KeyboardState::isPressed ( VK_F11 ) )
@@ -436,7 +685,8 @@ struct DllMain
                 }
 
 #ifndef RELEASE
-                DllOverlayUi::debugText = format ( "%+d [%s]", netMan.getRemoteFrameDelta(), netMan.getIndexedFrame() );
+                DllOverlayUi::debugText = format ( "%+d %+.2f [%s]", netMan.getRemoteFrameDelta(), timeSync.getAdvantage(),
+                                                   netMan.getIndexedFrame() );
                 DllOverlayUi::debugTextAlign = 1;
 
                 // Replay inputs and rollback
@@ -445,11 +695,28 @@ struct DllMain
                     if ( repMan.getGameMode ( netMan.getIndexedFrame() ) )
                         ASSERT ( repMan.getGameMode ( netMan.getIndexedFrame() ) == *CC_GAME_MODE_ADDR );
 
-                    if ( ! repMan.getStateStr ( netMan.getIndexedFrame() ).empty() )
-                        ASSERT ( repMan.getStateStr ( netMan.getIndexedFrame() ) == netMan.getState().str() );
+                    if ( repMan.getState ( netMan.getIndexedFrame() ) != NetplayState::Unknown )
+                        ASSERT ( repMan.getState ( netMan.getIndexedFrame() ) == netMan.getState() );
+
+                    // Seek back or forward by one keyframe interval, Ctrl seeks back to the start of the game
+                    if ( replaySeek.value == MaxIndexedFrame.value && replayKeyframes.interval
+                            && ( KeyboardState::isPressed ( VK_F9 ) || KeyboardState::isPressed ( VK_F10 ) ) )
+                    {
+                        IndexedFrame target = netMan.getIndexedFrame();
+
+                        if ( KeyboardState::isPressed ( VK_F10 ) )
+                            target.parts.frame += replayKeyframes.interval;
+                        else if ( KeyboardState::isDown ( VK_CONTROL ) || target.parts.frame <= replayKeyframes.interval )
+                            target.parts.frame = 0;
+                        else
+                            target.parts.frame -= replayKeyframes.interval;
+
+                        if ( seekReplay ( target ) )
+                            return;
+                    }
 
                     // Inputs
-                    const auto& inputs = repMan.getInputs ( netMan.getIndexedFrame() );
+                    const auto inputs = repMan.getInputs ( netMan.getIndexedFrame() );
                     netMan.setInput ( 1, inputs.p1 );
                     netMan.setInput ( 2, inputs.p2 );
 
@@ -459,16 +726,14 @@ struct DllMain
                     if ( netMan.isInRollback() && target.value < netMan.getIndexedFrame().value )
                     {
                         // Reinputs
-                        const auto& reinputs = repMan.getReinputs ( netMan.getIndexedFrame() );
+                        const auto reinputs = repMan.getReinputs ( netMan.getIndexedFrame() );
                         for ( const auto& inputs : reinputs )
                         {
                             netMan.assignInput ( 1, inputs.p1, inputs.indexedFrame );
                             netMan.assignInput ( 2, inputs.p2, inputs.indexedFrame );
                         }
 
-                        const string before = format ( "%s [%u] %s [%s]",
-                                                       gameModeStr ( *CC_GAME_MODE_ADDR ), *CC_GAME_MODE_ADDR,
-                                                       netMan.getState(), netMan.getIndexedFrame() );
+                        SyncLogRecord rollback = syncRecord ( SyncLogRecord::Rollback );
 
                         // Indicate we're re-running to the current frame
                         fastFwdStopFrame = netMan.getIndexedFrame();
@@ -479,14 +744,31 @@ struct DllMain
                             // Start fast-forwarding now
                             *CC_SKIP_FRAMES_ADDR = 1;
 
-                            LOG_TO ( syncLog, "%s Rollback: target=[%s]; actual=[%s]",
-                                     before, target, netMan.getIndexedFrame() );
+                            // Keyframes after the target were saved with the inputs that were just replaced
+                            replayKeyframes.eraseAfter ( target );
+
+                            rollback.target = target;
+                            rollback.actual = netMan.getIndexedFrame();
+                            logSync ( rollback );
 
-                            LOG_SYNC ( "Reinputs: 0x%04x 0x%04x", netMan.getRawInput ( 1 ), netMan.getRawInput ( 2 ) );
+                            logSyncInputs ( SyncLogRecord::Reinputs );
                             return;
                         }
 
-                        LOG_TO ( syncLog, "%s Rollback to target=[%s] failed!", before, target );
+                        // After seeking there may be no saved state before the target. Restore the keyframe before
+                        // it instead, then the replay runs up to this frame again and repeats the rollback.
+                        const IndexedFrame current = fastFwdStopFrame;
+                        fastFwdStopFrame.value = 0;
+
+                        if ( loadReplayKeyframe ( target ) )
+                        {
+                            replaySeek = current;
+                            return;
+                        }
+
+                        rollback.type = SyncLogRecord::Text;
+                        rollback.text = format ( "Rollback to target=[%s] failed!", target );
+                        logSync ( rollback );
 
                         ASSERT_IMPOSSIBLE;
                     }
@@ -553,6 +835,12 @@ struct DllMain
                     else
 #endif // NOT RELEASE
                         netMan.setInput ( localPlayer, localInputs[0] );
+
+                    IndexedFrame delayedFrame = netMan.getIndexedFrame();
+                    delayedFrame.parts.frame += netMan.getDelay();
+
+                    DllInputLatency::inputBuffered ( localInputs[0], localInputEventTime, localInputsSampleTime,
+                                                     delayedFrame );
                 }
 
                 if ( clientMode.isNetplay() )
@@ -592,7 +880,7 @@ struct DllMain
                         break;
                     }
 
-                    dataSocket->send ( netMan.getInputs ( localPlayer ) );
+                    sendInputs();
                 }
                 else if ( clientMode.isLocal() )
                 {
@@ -625,6 +913,8 @@ struct DllMain
         if ( rollbackTimer == minRollbackSpacing )
             netMan.clearLastChangedFrame();
 
+        DllRollbackProfiler::begin ( DllRollbackProfiler::Wait );
+
         for ( ;; )
         {
             // Poll until we are ready to run
@@ -738,6 +1028,8 @@ struct DllMain
             }
         }
 
+        DllRollbackProfiler::end ( DllRollbackProfiler::Wait );
+
         // Add logging to trace execution after disconnect handling
         if (gracefulDisconnectCompleted) {
             udpLogMain("``POST-DISCONNECT: Continuing main loop execution after successful disconnect");
@@ -756,31 +1048,41 @@ struct DllMain
                 && rollbackTimer == minRollbackSpacing
                 && netMan.getLastChangedFrame().value < netMan.getIndexedFrame().value )
         {
-            const string before = format ( "%s [%u] %s [%s]",
-                                           gameModeStr ( *CC_GAME_MODE_ADDR ), *CC_GAME_MODE_ADDR,
-                                           netMan.getState(), netMan.getIndexedFrame() );
+            SyncLogRecord rollback = syncRecord ( SyncLogRecord::Rollback );
 
             // Indicate we're re-running to the current frame
             fastFwdStopFrame = netMan.getIndexedFrame();
 
             LOG_SYNC ( "rollbacking input: 0x%04x 0x%04x", netMan.getRawInput ( 1 ), netMan.getRawInput ( 2 ) );
+
+            if ( netMan.getLastChangedFrame().parts.index == netMan.getIndex() )
+                delayTuner.addRollback ( netMan.getFrame() - netMan.getLastChangedFrame().parts.frame );
+
             // Reset the game state (this resets game state AND netMan state)
-            if ( rollMan.loadState ( netMan.getLastChangedFrame(), netMan ) )
+            DllRollbackProfiler::begin ( DllRollbackProfiler::Load );
+            const bool loaded = rollMan.loadState ( netMan.getLastChangedFrame(), netMan );
+            DllRollbackProfiler::end ( DllRollbackProfiler::Load );
+
+            if ( loaded )
             {
                 // Start fast-forwarding now
                 *CC_SKIP_FRAMES_ADDR = 1;
+                DllRollbackProfiler::begin ( DllRollbackProfiler::Rerun );
 
-                LOG_TO ( syncLog, "%s Rollback: target=[%s]; actual=[%s]",
-                         before, netMan.getLastChangedFrame(), netMan.getIndexedFrame() );
+                rollback.target = netMan.getLastChangedFrame();
+                rollback.actual = netMan.getIndexedFrame();
+                logSync ( rollback );
 
-                LOG_SYNC ( "Reinputs: 0x%04x 0x%04x", netMan.getRawInput ( 1 ), netMan.getRawInput ( 2 ) );
+                logSyncInputs ( SyncLogRecord::Reinputs );
 
                 netMan.clearLastChangedFrame();
                 --rollbackTimer;
                 return;
             }
 
-            LOG_TO ( syncLog, "%s Rollback to target=[%s] failed!", before, netMan.getLastChangedFrame() );
+            rollback.type = SyncLogRecord::Text;
+            rollback.text = format ( "Rollback to target=[%s] failed!", netMan.getLastChangedFrame() );
+            logSync ( rollback );
         }
 
         // Update the RngState if necessary
@@ -839,6 +1141,9 @@ struct DllMain
             }
         }
 
+        // Slow down slightly while ahead of the remote side, so neither side has to wait or rollback deeper
+        DllFrameRate::frameStretch = ( clientMode.isNetplay() && netMan.isInGame() ? timeSync.getFrameStretch() : 0.0 );
+
         // Handle Trial changes
         if ( netMan.config.mode.isTrial() && netMan.isInGame() ) {
             //trialMan.frameStepTrial();
@@ -848,6 +1153,9 @@ struct DllMain
         //            CC_SFX_ARRAY_ADDR[SFX_NUM], AsmHacks::sfxFilterArray[SFX_NUM], AsmHacks::sfxMuteArray[SFX_NUM] );
 
 #ifndef RELEASE
+        // Capture raw game memory while enabled
+        DllMemoryCapture::frameStep ( netMan.getIndexedFrame() );
+
         if ( ! replayInputs )
         {
             // Test one time rollback
@@ -862,9 +1170,7 @@ struct DllMain
 
                 if ( KeyboardState::isDown ( VK_CONTROL ) )
                 {
-                    const string before = format ( "%s [%u] %s [%s]",
-                                                   gameModeStr ( *CC_GAME_MODE_ADDR ), *CC_GAME_MODE_ADDR,
-                                                   netMan.getState(), netMan.getIndexedFrame() );
+                    SyncLogRecord rollback = syncRecord ( SyncLogRecord::Rollback );
 
                     // Indicate we're re-running to the current frame
                     fastFwdStopFrame = netMan.getIndexedFrame();
@@ -875,10 +1181,11 @@ struct DllMain
                         // Start fast-forwarding now
                         *CC_SKIP_FRAMES_ADDR = 1;
 
-                        LOG_TO ( syncLog, "%s Rollback: target=[%s]; actual=[%s]",
-                                 before, netMan.getLastChangedFrame(), netMan.getIndexedFrame() );
+                        rollback.target = netMan.getLastChangedFrame();
+                        rollback.actual = netMan.getIndexedFrame();
+                        logSync ( rollback );
 
-                        LOG_SYNC ( "Reinputs: 0x%04x 0x%04x", netMan.getRawInput ( 1 ), netMan.getRawInput ( 2 ) );
+                        logSyncInputs ( SyncLogRecord::Reinputs );
                         return;
                     }
                 }
@@ -888,11 +1195,26 @@ struct DllMain
                 }
             }
 
-            // Test random rollback
+            // Test random rollback, Ctrl captures raw game memory instead
             if ( KeyboardState::isPressed ( VK_F10 ) )
             {
-                randomRollback = !randomRollback;
-                DllOverlayUi::showMessage ( randomRollback ? "Enabled random rollback" : "Disabled random rollback" );
+                if ( KeyboardState::isDown ( VK_CONTROL ) )
+                {
+                    if ( DllMemoryCapture::isCapturing() )
+                    {
+                        DllMemoryCapture::stop();
+                        DllOverlayUi::showMessage ( "Stopped memory capture" );
+                    }
+                    else if ( DllMemoryCapture::start ( ProcessManager::appDir + MEMORY_CAPTURE_FILE ) )
+                    {
+                        DllOverlayUi::showMessage ( "Capturing memory to " MEMORY_CAPTURE_FILE );
+                    }
+                }
+                else
+                {
+                    randomRollback = !randomRollback;
+                    DllOverlayUi::showMessage ( randomRollback ? "Enabled random rollback" : "Disabled random rollback" );
+                }
             }
 
             if ( randomRollback
@@ -909,29 +1231,35 @@ struct DllMain
                 else
                     target.parts.frame -= distance;
 
-                const string before = format ( "%s [%u] %s [%s]",
-                                               gameModeStr ( *CC_GAME_MODE_ADDR ), *CC_GAME_MODE_ADDR,
-                                               netMan.getState(), netMan.getIndexedFrame() );
+                SyncLogRecord rollback = syncRecord ( SyncLogRecord::Rollback );
 
                 // Indicate we're re-running to the current frame
                 fastFwdStopFrame = netMan.getIndexedFrame();
 
-                LOG_TO ( syncLog, "%s Rollback: target=[%s]; actual=[%s]",
-                         before, target, netMan.getIndexedFrame() );
+                rollback.target = target;
+                rollback.actual = netMan.getIndexedFrame();
+                logSync ( rollback );
 
                 // Reset the game state (this resets game state AND netMan state)
-                if ( rollMan.loadState ( target, netMan ) )
+                DllRollbackProfiler::begin ( DllRollbackProfiler::Load );
+                const bool loaded = rollMan.loadState ( target, netMan );
+                DllRollbackProfiler::end ( DllRollbackProfiler::Load );
+
+                if ( loaded )
                 {
                     // Start fast-forwarding now
                     *CC_SKIP_FRAMES_ADDR = 1;
+                    DllRollbackProfiler::begin ( DllRollbackProfiler::Rerun );
 
-                    LOG_SYNC ( "Reinputs: 0x%04x 0x%04x", netMan.getRawInput ( 1 ), netMan.getRawInput ( 2 ) );
+                    logSyncInputs ( SyncLogRecord::Reinputs );
 
                     --rollbackTimer;
                     return;
                 }
 
-                LOG_TO ( syncLog, "%s Rollback to target=[%s] failed!", before, target );
+                rollback.type = SyncLogRecord::Text;
+                rollback.text = format ( "Rollback to target=[%s] failed!", target );
+                logSync ( rollback );
             }
         }
 
@@ -952,41 +1280,35 @@ struct DllMain
             }
         }
 
-        // Compare current lists of sync hashes
-        while ( !localSync.empty() && !remoteSync.empty() )
+        // Send the full state hashes once the remote inputs up to that frame are confirmed, and no rollback to
+        // before that frame is still pending, ie postponed by the rollback spacing. States that were erased by a
+        // rollback are skipped, since they were saved from predicted inputs and are never re-saved.
+        while ( !pendingStateHashes.empty()
+                && pendingStateHashes.front().value <= netMan.getRemoteIndexedFrame().value
+                && pendingStateHashes.front().value < netMan.getLastChangedFrame().value )
         {
+            uint64_t hash;
 
-#define L localSync.front()->getAs<SyncHash>()
-#define R remoteSync.front()->getAs<SyncHash>()
-
-            while ( !remoteSync.empty() && L.indexedFrame.value > R.indexedFrame.value )
-                remoteSync.pop_front();
-
-            if ( remoteSync.empty() )
-                break;
-
-            while ( !localSync.empty() && R.indexedFrame.value > L.indexedFrame.value )
-                localSync.pop_front();
-
-            if ( localSync.empty() )
-                break;
-
-            if ( L == R )
+            if ( dataSocket && dataSocket->isConnected()
+                    && rollMan.getStateHash ( pendingStateHashes.front(), hash ) )
             {
-                localSync.pop_front();
-                remoteSync.pop_front();
-                continue;
+                MsgPtr msgStateHash ( new StateHash ( pendingStateHashes.front(), hash ) );
+                dataSocket->send ( msgStateHash );
+                localStateSync.push_back ( msgStateHash );
             }
 
-            LOG_TO ( syncLog, "Desync:" );
-            LOG_TO ( syncLog, "< %s", L.dump() );
-            LOG_TO ( syncLog, "> %s", R.dump() );
+            pendingStateHashes.pop_front();
+        }
 
-#undef L
-#undef R
+        // Compare current lists of state hashes and sync hashes
+        if ( !compareHashes<StateHash> ( localStateSync, remoteStateSync, "State desync" )
+                || !compareHashes<SyncHash> ( localSync, remoteSync, "Desync" ) )
+        {
+            closeSyncLog();
+
+            const string statesFile = format ( DESYNC_STATES_FILE, clientMode.isHost() ? "host" : "client" );
+            rollMan.dumpStates ( ProcessManager::appDir + statesFile, netMan.getRemoteIndexedFrame() );
 
-            syncLog.deinitialize();
-            
             // Skip delayedStop if we've completed a graceful disconnect
             if ( gracefulDisconnectCompleted )
             {
@@ -996,7 +1318,7 @@ struct DllMain
                 localInputs [ clientMode.isLocal() ? 1 : 0 ] = 0;
                 return;
             }
-            
+
             udpLogMain("``DESYNC: Calling delayedStop - desync detected");
             delayedStop ( "Desync!" );
 
@@ -1008,6 +1330,7 @@ struct DllMain
         if ( replayInputs && netMan.getIndex() >= repMan.getLastIndex() && netMan.getFrame() >= repMan.getLastFrame() )
         {
             replayInputs = false;
+            replaySeek = MaxIndexedFrame;
             SetForegroundWindow ( ( HWND ) DllHacks::windowHandle );
         }
 
@@ -1023,9 +1346,9 @@ struct DllMain
 
             if ( dump.find ( replayCheckRngHexStr ) != 0 )
             {
-                LOG_SYNC ( "RngState: %s", msgRngState->getAs<RngState>().dump() );
-                LOG_TO ( syncLog, "Desync!" );
-                syncLog.deinitialize();
+                logSyncRngState ( msgRngState->getAs<RngState>() );
+                LOG_SYNC_RAW ( "Desync!" );
+                closeSyncLog();
 
                 // Skip delayedStop if we've completed a graceful disconnect
                 if ( gracefulDisconnectCompleted )
@@ -1084,8 +1407,8 @@ struct DllMain
         ASSERT ( msgRngState.get() != 0 );
 
         // Log state every frame
-        LOG_SYNC ( "RngState: %s", msgRngState->getAs<RngState>().dump() );
-        LOG_SYNC ( "Inputs: 0x%04x 0x%04x", netMan.getRawInput ( 1 ), netMan.getRawInput ( 2 ) );
+        logSyncRngState ( msgRngState->getAs<RngState>() );
+        logSyncInputs ( SyncLogRecord::Inputs );
 
         // Log extra state during chara select
         if ( netMan.getState() == NetplayState::CharaSelect )
@@ -1118,11 +1441,15 @@ struct DllMain
         // Save sound state during rollback re-run
         rollMan.saveRerunSounds ( netMan.getFrame() );
 
+        DllRollbackProfiler::addRerunFrame();
+
         if ( netMan.getIndexedFrame().value >= fastFwdStopFrame.value )
         {
             // Stop fast-forwarding once we're reached the frame we want
             fastFwdStopFrame.value = 0;
 
+            DllRollbackProfiler::end ( DllRollbackProfiler::Rerun );
+
             // Re-enable regular rendering once done
             *CC_SKIP_FRAMES_ADDR = 0;
 
@@ -1135,7 +1462,7 @@ struct DllMain
             *CC_SKIP_FRAMES_ADDR = 1;
         }
 
-        LOG_SYNC ( "Reinputs: 0x%04x 0x%04x", netMan.getRawInput ( 1 ), netMan.getRawInput ( 2 ) );
+        logSyncInputs ( SyncLogRecord::Reinputs );
         LOG_SYNC ( "roundOverTimer=%d; introState=%u; roundTimer=%u; realTimer=%u; hitsparks=%u; camera={ %d, %d }",
                    roundOverTimer, *CC_INTRO_STATE_ADDR, *CC_ROUND_TIMER_ADDR, *CC_REAL_TIMER_ADDR,
                    *CC_HIT_SPARKS_ADDR, *CC_CAMERA_X_ADDR, *CC_CAMERA_Y_ADDR );
@@ -1174,14 +1501,43 @@ struct DllMain
         else
             frameStepNormal();
 
+        // Commit the profiler sample once this frame is done re-running
+        if ( ! fastFwdStopFrame.value )
+        {
+            if ( netMan.isInGame() )
+                DllRollbackProfiler::commitFrame ( netMan.getIndexedFrame() );
+            else
+                DllRollbackProfiler::discardFrame();
+        }
+
         // Update spectators
         frameStepSpectators();
 
         // Write game inputs
-        procMan.writeGameInput ( localPlayer, netMan.getInput ( localPlayer ) );
+        const uint16_t localInput = netMan.getInput ( localPlayer );
+
+        procMan.writeGameInput ( localPlayer, localInput );
         procMan.writeGameInput ( remotePlayer, netMan.getInput ( remotePlayer ) );
 
+        DllInputLatency::inputWritten ( localInput, netMan.getIndexedFrame() );
+
 #ifndef RELEASE
+        if ( replaySeek.value != MaxIndexedFrame.value )
+        {
+            if ( netMan.getIndexedFrame().value < replaySeek.value )
+            {
+                // Skip rendering until the seek target is reached
+                *CC_SKIP_FRAMES_ADDR = 1;
+            }
+            else
+            {
+                replaySeek = MaxIndexedFrame;
+                DllOverlayUi::showMessage ( format ( "Seeked to [%s]; %u keyframes, %u KB", netMan.getIndexedFrame(),
+                                                     replayKeyframes.size(),
+                                                     replayKeyframes.getCompressedSize() / 1024 ) );
+            }
+        }
+
         if ( replayInputs && ( replaySpeed == 1 || KeyboardState::isDown ( VK_SPACE ) ) )
             DllFrameRate::desiredFps = numeric_limits<double>::max();
         else if ( replayInputs && replaySpeed == 2 )
@@ -1189,14 +1545,23 @@ struct DllMain
 #endif
     }
 
+    // Send the local inputs, stamped for round trip time sampling
+    void sendInputs()
+    {
+        MsgPtr msgInputs = netMan.getInputs ( localPlayer );
+        delayTuner.stamp ( msgInputs->getAs<PlayerInputs>(), TimerManager::get().getNow ( true ) );
+        timeSync.stamp ( msgInputs->getAs<PlayerInputs>(), netMan.getDelay() );
+        dataSocket->send ( msgInputs );
+    }
+
     void netplayStateChanged ( NetplayState state )
     {
         // Catch invalid transitions
         if ( ! netMan.isValidNext ( state ) )
         {
-            LOG_TO ( syncLog, "Desync!" );
-            LOG_TO ( syncLog, "Invalid transition: %s -> %s", netMan.getState(), state );
-            syncLog.deinitialize();
+            LOG_SYNC_RAW ( "Desync!" );
+            LOG_SYNC_RAW ( "Invalid transition: %s -> %s", netMan.getState(), state );
+            closeSyncLog();
 
             // Skip delayedStop if we've completed a graceful disconnect
             if ( gracefulDisconnectCompleted )
@@ -1315,6 +1680,27 @@ struct DllMain
         // Update local state
         netMan.setState ( state );
 
+        // Each game is tuned from scratch, without the samples and rollbacks of the previous game
+        if ( state == NetplayState::CharaSelect )
+            delayTuner.clear();
+
+        // Entering InGame, propose the delay before the inputs of the new round are used
+        if ( state == NetplayState::InGame && autoDelay && netMan.isInRollback() )
+        {
+            const uint8_t delay = delayTuner.propose ( netMan.getDelay(), netMan.getRollback(), DELAY_TUNER_MAX_DELAY );
+
+            if ( delay != netMan.getDelay() )
+            {
+                shouldChangeDelayRollback = true;
+
+                changeConfig.value = ChangeConfig::Delay;
+                changeConfig.indexedFrame = netMan.getIndexedFrame();
+                changeConfig.delay = delay;
+                changeConfig.rollback = netMan.getRollback();
+                changeConfig.invalidate();
+            }
+        }
+
         // Update remote index
         if ( dataSocket && dataSocket->isConnected() )
             dataSocket->send ( new TransitionIndex ( netMan.getIndex() ) );
@@ -1725,6 +2111,10 @@ struct DllMain
             case MsgType::SyncHash:
                 remoteSync.push_back ( msg );
                 return;
+
+            case MsgType::StateHash:
+                remoteStateSync.push_back ( msg );
+                return;
 #endif // NOT RELEASE
 
             default:
@@ -1746,6 +2136,9 @@ struct DllMain
                 switch ( msg->getMsgType() )
                 {
                     case MsgType::PlayerInputs:
+                        delayTuner.received ( msg->getAs<PlayerInputs>(), TimerManager::get().getNow ( true ) );
+                        timeSync.received ( msg->getAs<PlayerInputs>(),
+                                            fastFwdStopFrame.value ? fastFwdStopFrame : netMan.getIndexedFrame() );
                         netMan.setInputs ( remotePlayer, msg->getAs<PlayerInputs>() );
                         return;
 
@@ -1928,6 +2321,8 @@ struct DllMain
                 if ( options[Options::HeldStartDuration] )
                     netMan.heldStartDuration = lexical_cast<uint32_t> ( options.arg ( Options::HeldStartDuration ) );
 
+                autoDelay = options[Options::AutoDelay];
+
                 if ( options[Options::AutoReplaySave] ) {
                     netMan.autoReplaySave = true;
                 } else {
@@ -1943,15 +2338,34 @@ struct DllMain
                 LOG ( "appDir='%s'", ProcessManager::appDir );
 
                 Logger::get().sessionId = options.arg ( Options::SessionId );
-                Logger::get().initialize ( ProcessManager::appDir + LOG_FILE );
+                Logger::get().initialize ( ProcessManager::appDir + LOG_FILE, LOG_DEFAULT_OPTIONS | LOG_ASYNC );
                 Logger::get().logVersion();
 
+                if ( options[Options::LogLevels]
+                        && ! Logger::get().setLevels ( options.arg ( Options::LogLevels ) ) )
+                {
+                    LOG ( "Invalid log levels: '%s'", options.arg ( Options::LogLevels ) );
+                }
+
+                LOG ( "Log levels: %s", Logger::get().getLevels() );
+
                 LOG ( "gameDir='%s'", ProcessManager::gameDir );
                 LOG ( "appDir='%s'", ProcessManager::appDir );
 
                 syncLog.sessionId = options.arg ( Options::SessionId );
-                syncLog.initialize ( ProcessManager::appDir + SYNC_LOG_FILE, 0 );
-                syncLog.logVersion();
+
+                if ( options[Options::BinarySyncLog] )
+                {
+                    syncLogBinary.open ( ProcessManager::appDir + SYNC_LOG_BINARY_FILE );
+
+                    LOG_SYNC_RAW ( "Version '%s'", LocalVersion.code );
+                    LOG_SYNC_RAW ( "SessionId '%s'", syncLog.sessionId );
+                }
+                else
+                {
+                    syncLog.initialize ( ProcessManager::appDir + SYNC_LOG_FILE, 0 );
+                    syncLog.logVersion();
+                }
 
                 // Manually hit Alt+Enter to enable fullscreen
                 if ( options[Options::Fullscreen] && DllHacks::windowHandle == GetForegroundWindow() )
@@ -2012,6 +2426,23 @@ struct DllMain
                         replayStop.parts.frame = lexical_cast<uint32_t> ( *it++ );
                     }
 
+                    // Parse keyframe interval, 0 disables seeking
+                    it = find ( args.begin(), args.end(), "keyframes" );
+                    if ( it != args.end() )
+                        ++it;
+                    if ( it != args.end() )
+                        replayKeyframes.interval = lexical_cast<uint32_t> ( *it );
+
+                    // Parse seek index and frame to fast-forward to
+                    it = find ( args.begin(), args.end(), "seek" );
+                    if ( it != args.end() )
+                        ++it;
+                    if ( it != args.end() && ( args.end() - it ) >= 2 )
+                    {
+                        replaySeek.parts.index = lexical_cast<uint32_t> ( *it++ );
+                        replaySeek.parts.frame = lexical_cast<uint32_t> ( *it++ );
+                    }
+
                     // Parse check RngState args
                     it = find ( args.begin(), args.end(), "check" );
                     if ( it != args.end() )
@@ -2048,6 +2479,16 @@ struct DllMain
                 {
                     randomInputs = options[Options::SyncTest];
                 }
+
+                if ( options[Options::Predictor] )
+                {
+                    const PredictorType type = InputPredictor::parseType ( options.arg ( Options::Predictor ) );
+
+                    LOG ( "Predictor: '%s' -> %s", options.arg ( Options::Predictor ), type );
+
+                    if ( type != PredictorType::Unknown )
+                        netMan.setPredictor ( type );
+                }
 #endif // NOT RELEASE
                 break;
 
@@ -2541,7 +2982,7 @@ struct DllMain
     {
         if ( timer == resendTimer.get() )
         {
-            dataSocket->send ( netMan.getInputs ( localPlayer ) );
+            sendInputs();
             resendTimer->start ( RESEND_INPUTS_INTERVAL );
 
             ++waitInputsTimer;
@@ -2724,9 +3165,17 @@ struct DllMain
     {
         rollMan.deallocateStates();
 
+        if ( DllRollbackProfiler::getNumSamples() )
+            DllRollbackProfiler::dumpHistogram ( ProcessManager::appDir + ROLLBACK_PROFILE_FILE );
+
+        if ( DllInputLatency::getNumSamples() )
+            DllInputLatency::dumpHistogram ( ProcessManager::appDir + INPUT_LATENCY_FILE );
+
         KeyboardManager::get().unhook();
 
-        syncLog.deinitialize();
+        closeSyncLog();
+
+        netMan.closeExports();
 
         procMan.disconnectPipe();
 
@@ -2801,6 +3250,7 @@ extern "C" BOOL APIENTRY DllMain ( HMODULE, DWORD reason, LPVOID )
 
             srand ( time ( 0 ) );
 
+            // Sync until the first frame, since the loader lock is held here
             Logger::get().initialize ( ProcessManager::gameDir + LOG_FILE );
             Logger::get().logVersion();
 
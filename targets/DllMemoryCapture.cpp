@@ -0,0 +1,121 @@
+#include "DllMemoryCapture.hpp"
+#include "StateSnapshots.hpp"
+#include "Logger.hpp"
+
+#include <windows.h>
+
+#include <vector>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+
+namespace DllMemoryCapture
+{
+
+static FILE *fp = 0;
+
+static vector<RawSnapshotsRange> ranges;
+
+static uint32_t remainingFrames = 0;
+
+
+// Get the writable sections of the game executable
+static vector<RawSnapshotsRange> getWritableSections()
+{
+    vector<RawSnapshotsRange> sections;
+
+    const char *base = ( const char * ) GetModuleHandle ( 0 );
+    const IMAGE_DOS_HEADER *dosHeader = ( const IMAGE_DOS_HEADER * ) base;
+    const IMAGE_NT_HEADERS *ntHeaders = ( const IMAGE_NT_HEADERS * ) ( base + dosHeader->e_lfanew );
+    const IMAGE_SECTION_HEADER *section = IMAGE_FIRST_SECTION ( ntHeaders );
+
+    for ( WORD i = 0; i < ntHeaders->FileHeader.NumberOfSections; ++i, ++section )
+    {
+        if ( ! ( section->Characteristics & IMAGE_SCN_MEM_WRITE ) || ! section->Misc.VirtualSize )
+            continue;
+
+        RawSnapshotsRange range;
+        range.addr = ( uint32_t ) ( base + section->VirtualAddress );
+        range.size = section->Misc.VirtualSize;
+        sections.push_back ( range );
+
+        LOG ( "Writable section '%.8s' { 0x%08x, %u bytes }", section->Name, range.addr, range.size );
+    }
+
+    return sections;
+}
+
+
+bool start ( const string& file, uint32_t numFrames )
+{
+    stop();
+
+    ranges = getWritableSections();
+
+    RawSnapshotsHeader header;
+    memcpy ( header.magic, RAW_SNAPSHOTS_MAGIC, sizeof ( header.magic ) );
+    header.numRanges = ranges.size();
+    header.frameSize = 0;
+
+    for ( const RawSnapshotsRange& range : ranges )
+        header.frameSize += range.size;
+
+    fp = fopen ( file.c_str(), "wb" );
+
+    if ( ! fp )
+    {
+        LOG ( "Failed to open '%s'", file );
+        return false;
+    }
+
+    if ( fwrite ( &header, sizeof ( header ), 1, fp ) != 1
+            || fwrite ( &ranges[0], sizeof ( RawSnapshotsRange ), ranges.size(), fp ) != ranges.size() )
+    {
+        LOG ( "Failed to write '%s'", file );
+        stop();
+        return false;
+    }
+
+    remainingFrames = numFrames;
+
+    LOG ( "Capturing %u frames of %u bytes to '%s'", numFrames, header.frameSize, file );
+    return true;
+}
+
+void frameStep ( IndexedFrame indexedFrame )
+{
+    if ( ! fp )
+        return;
+
+    bool good = ( fwrite ( &indexedFrame.value, sizeof ( indexedFrame.value ), 1, fp ) == 1 );
+
+    for ( const RawSnapshotsRange& range : ranges )
+        good = good && ( fwrite ( ( const void * ) range.addr, range.size, 1, fp ) == 1 );
+
+    if ( ! good )
+        LOG ( "Failed to write frame [%s]", indexedFrame );
+
+    if ( ! good || --remainingFrames == 0 )
+        stop();
+}
+
+void stop()
+{
+    if ( ! fp )
+        return;
+
+    fclose ( fp );
+    fp = 0;
+    remainingFrames = 0;
+
+    LOG ( "Stopped capturing memory" );
+}
+
+bool isCapturing()
+{
+    return ( fp != 0 );
+}
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Constants.hpp"
+
+#include <string>
+#include <cstdint>
+
+
+// Number of frames captured by default
+#define MEMORY_CAPTURE_FRAMES   ( 120 )
+
+
+// Debug capture of the game's writable memory sections over consecutive frames, see RawSnapshotsHeader.
+// The captures are used by tools/MemCoverage.cpp to check the coverage of the rollback address list.
+namespace DllMemoryCapture
+{
+
+// Start capturing the next numFrames frames to a file, returns false if the file couldn't be opened
+bool start ( const std::string& file, uint32_t numFrames = MEMORY_CAPTURE_FRAMES );
+
+// Write the current frame if capturing, the file is closed after the last frame
+void frameStep ( IndexedFrame indexedFrame );
+
+// Stop capturing and close the file
+void stop();
+
+bool isCapturing();
+
+}
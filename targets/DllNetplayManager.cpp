@@ -11,7 +11,6 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <ctime>
-#include <fstream>
 
 
 #include <ws2tcpip.h>
@@ -669,6 +668,49 @@ void NetplayManager::setRemotePlayer ( uint8_t player )
     _remotePlayer = player;
 }
 
+void NetplayManager::setPredictor ( PredictorType type )
+{
+    _predictor.reset ( InputPredictor::create ( type ) );
+    _observedIndex = 0;
+    _observedEndFrame = 0;
+}
+
+void NetplayManager::predictRemoteInputs()
+{
+    RingInputsContainer<uint16_t>& inputs = _inputs[_remotePlayer - 1];
+
+    const uint32_t index = getIndex() - _startIndex;
+    const uint32_t endFrame = inputs.getEndFrame ( index );
+
+    // Every frame run after the last remote input keeps its prediction, so re-run frames use the same inputs,
+    // and rollback is only triggered if the actual input differs from what was used.
+    for ( uint32_t frame = endFrame; frame <= getFrame(); ++frame )
+    {
+        if ( ! inputs.hasPrediction ( index, frame ) )
+            inputs.setPrediction ( index, frame, _predictor->predict ( frame + 1 - endFrame ) );
+    }
+}
+
+void NetplayManager::observeRemoteInputs ( uint32_t index )
+{
+    // Ignore inputs for older transition indices
+    if ( index < _observedIndex )
+        return;
+
+    if ( index > _observedIndex )
+    {
+        _predictor->reset();
+        _observedIndex = index;
+        _observedEndFrame = 0;
+    }
+
+    const RingInputsContainer<uint16_t>& inputs = _inputs[_remotePlayer - 1];
+    const uint32_t endFrame = inputs.getEndFrame ( index - _startIndex );
+
+    for ( ; _observedEndFrame < endFrame; ++_observedEndFrame )
+        _predictor->observe ( inputs.get ( index - _startIndex, _observedEndFrame ) );
+}
+
 void NetplayManager::updateFrame()
 {
     _indexedFrame.parts.frame = ( *CC_WORLD_TIMER_ADDR ) - _startWorldTime;
@@ -854,6 +896,8 @@ uint16_t NetplayManager::getInput ( uint8_t player )
             if ( TrialManager::playDemo ) {
                 return getDemoInput ( player );
             }
+            if ( _predictor && player == _remotePlayer && isInRollback() )
+                predictRemoteInputs();
             return getInGameInput ( player );
 
         case NetplayState::RetryMenu:
@@ -937,6 +981,9 @@ void NetplayManager::setInputs ( uint8_t player, const PlayerInputs& playerInput
 
     _inputs[player - 1].set ( playerInputs.getIndex() - _startIndex, playerInputs.getStartFrame(),
                               &playerInputs.inputs[0], playerInputs.size(), checkStartingFromIndex );
+
+    if ( _predictor && player == _remotePlayer )
+        observeRemoteInputs ( playerInputs.getIndex() );
 }
 
 MsgPtr NetplayManager::getBothInputs ( IndexedFrame& pos ) const
@@ -1240,75 +1287,46 @@ bool NetplayManager::isValidNext ( NetplayState next )
 }
 
 void NetplayManager::exportInputs() {
-    char buf[1000];
-    char namebuf[1000];
-    char namebuf2[1000];
-    char timebuf[200];
+    char timebuf[20];
 
     std::time_t now = time( NULL );
-    strftime( timebuf, 20, "%y%m%d-%H%M%S", localtime( &now ) );
-
-    sprintf( namebuf, "ReplayVS/%sx%s_%s.repraw",
-             getShortCharaName( *CC_P1_CHARACTER_ADDR ),
-             getShortCharaName( *CC_P2_CHARACTER_ADDR) ,
-             timebuf );
-    ofstream repFile2 ( namebuf, ios::out );
-    vector<int> c = getInGameIndexes();
-    repFile2 << c.size() << endl;
-    for ( int q : c ) {
-        sprintf( buf, "%d\n", _inputs[0].getEndFrame( q ) );
-        repFile2 << buf;
+    strftime( timebuf, sizeof( timebuf ), "%y%m%d-%H%M%S", localtime( &now ) );
+
+    const string rawFile = format( "ReplayVS/%sx%s_%s.repraw",
+                                   getShortCharaName( *CC_P1_CHARACTER_ADDR ),
+                                   getShortCharaName( *CC_P2_CHARACTER_ADDR ),
+                                   timebuf );
+
+    // Only snapshot the inputs here, the files are written by the export thread
+    ReplayCreator::RawReplay rounds;
+    for ( int q : getInGameIndexes() ) {
+        rounds.emplace_back();
         for ( uint32_t i = 0; i < _inputs[0].getEndFrame( q ); ++i ) {
-            sprintf( buf, "%04x %04x\n",
-                     _inputs[0].get ( q, i ),
-                     _inputs[1].get ( q, i ) );
-            repFile2 << buf;
+            rounds.back()[0].push_back( _inputs[0].get ( q, i ) );
+            rounds.back()[1].push_back( _inputs[1].get ( q, i ) );
         }
     }
-    repFile2.close();
 
-    sprintf( namebuf2, "%s2.rep", ( char* ) AsmHacks::replayName );
-    ReplayCreator::ReplayFile f;
-    ReplayCreator r;
-    r.load( &f, ( char* )AsmHacks::replayName );
-    r.fixReplay( &f, namebuf, NULL );
-    r.dump( f, namebuf2 );
+    const string repFile = ( AsmHacks::replayName ? AsmHacks::replayName : "" );
+    _exporter.exportInputs( rawFile, move( rounds ), repFile, repFile + "2.rep" );
 
     exported = true;
 }
 
 void NetplayManager::exportResults()
 {
-    ofstream resFile;
-    resFile.open( "results.csv", ios::out | ios::app );
-    char buf[ 1000 + config.names[0].length() + config.names[1].length() ];
-    string moon[3] = { "C", "F", "H" };
-    std::time_t now = time( NULL );
-    string n1 = sanitizePlayerName( config.names[0] );
-    string n2 = sanitizePlayerName( config.names[1] );
-    if ( _localPlayer == 1 ) {
-        sprintf( buf, "%s,%s-%s,%d,%s,%s-%s,%d,%d",
-                 n1.c_str(), moon[*CC_P1_MOON_SELECTOR_ADDR].c_str(),
-                 getShortCharaName(*CC_P1_CHARACTER_ADDR),
-                 *CC_P1_WINS_ADDR,
-                 n2.c_str(), moon[*CC_P2_MOON_SELECTOR_ADDR].c_str(),
-                 getShortCharaName(*CC_P2_CHARACTER_ADDR),
-                 *CC_P2_WINS_ADDR,
-                 (int)now
-               );
-    } else {
-        sprintf( buf, "%s,%s-%s,%d,%s,%s-%s,%d,%d",
-                 n2.c_str(), moon[*CC_P2_MOON_SELECTOR_ADDR].c_str(),
-                 getShortCharaName(*CC_P2_CHARACTER_ADDR),
-                 *CC_P2_WINS_ADDR,
-                 n1.c_str(), moon[*CC_P1_MOON_SELECTOR_ADDR].c_str(),
-                 getShortCharaName(*CC_P1_CHARACTER_ADDR),
-                 *CC_P1_WINS_ADDR,
-                 (int)now
-               );
-    }
-    resFile << buf << endl;
-    resFile.close();
+    static const string moon[3] = { "C", "F", "H" };
+    const string names[2] = { sanitizePlayerName( config.names[0] ), sanitizePlayerName( config.names[1] ) };
+    const string results[2] = {
+        format( "%s-%s,%d", moon[*CC_P1_MOON_SELECTOR_ADDR], getShortCharaName( *CC_P1_CHARACTER_ADDR ),
+                *CC_P1_WINS_ADDR ),
+        format( "%s-%s,%d", moon[*CC_P2_MOON_SELECTOR_ADDR], getShortCharaName( *CC_P2_CHARACTER_ADDR ),
+                *CC_P2_WINS_ADDR ),
+    };
+    // The local player is listed first
+    const int first = ( _localPlayer == 1 ? 0 : 1 );
+    _exporter.appendLine( "results.csv", format( "%s,%s,%s,%s,%d", names[first], results[first],
+                                                 names[1 - first], results[1 - first], ( int ) time( NULL ) ) );
 }
 
 void NetplayManager::resetInGameIndexes() {
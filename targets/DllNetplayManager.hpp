@@ -3,8 +3,11 @@
 #include "Messages.hpp"
 #include "InputsContainer.hpp"
 #include "NetplayStates.hpp"
+#include "InputPredictor.hpp"
+#include "ReplayExporter.hpp"
 
 #include <vector>
+#include <memory>
 #include <climits>
 
 void __stdcall ___log(const char* msg);
@@ -33,6 +36,9 @@ public:
 
     // Indicate which player is the remote player
     void setRemotePlayer ( uint8_t player );
+
+    // Set the predictor for remote inputs during rollback, the default is to hold the last remote input
+    void setPredictor ( PredictorType type );
     
     // Initiate connection to host from already-running game
     void initiateOnlineConnection ( const std::string& hostIp, uint16_t port );
@@ -75,6 +81,9 @@ public:
     // Log Results
     void exportResults();
 
+    // Write any queued exports and stop the export thread
+    void closeExports() { _exporter.close(); }
+
     // Get / set the current NetplayState
     NetplayState getState() const { return _state; }
     void setState ( NetplayState state );
@@ -199,7 +208,7 @@ private:
     uint32_t _spectateStartIndex = 0;
 
     // Mapping: player -> index offset -> frame -> input
-    std::array<InputsContainer<uint16_t>, 2> _inputs;
+    std::array<RingInputsContainer<uint16_t>, 2> _inputs;
 
     // Mapping: index offset -> RngState (can be null)
     std::vector<MsgPtr> _rngStates;
@@ -214,9 +223,19 @@ private:
     // The remote player, ie the one where setInputs gets called for each input message
     uint8_t _remotePlayer = 2;
 
+    // Predictor for remote inputs during rollback, null to hold the last remote input without storing predictions
+    std::shared_ptr<InputPredictor> _predictor;
+
+    // The transition index and end frame of the remote inputs observed by the predictor
+    uint32_t _observedIndex = 0;
+    uint32_t _observedEndFrame = 0;
+
     // Exported
     bool exported = false;
 
+    // Writes the exports in the background
+    ReplayExporter _exporter;
+
     // Separate delays for p1/p2
     bool splitDelay = true;
 
@@ -235,6 +254,12 @@ private:
     uint16_t getRetryMenuInput ( uint8_t player );
     uint16_t getReplayMenuInput ( uint8_t player );
 
+    // Predict the remote inputs for the frames after the last remote input, up to the current frame
+    void predictRemoteInputs();
+
+    // Observe the new remote inputs for the given transition index
+    void observeRemoteInputs ( uint32_t index );
+
     // Get the input needed to navigate the menu
     uint16_t getMenuNavInput();
 
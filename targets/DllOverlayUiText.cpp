@@ -2,6 +2,8 @@
 #include "DllOverlayPrimitives.hpp"
 #include "DllHacks.hpp"
 #include "DllTrialManager.hpp"
+#include "DllRollbackProfiler.hpp"
+#include "DllInputLatency.hpp"
 #include "ProcessManager.hpp"
 #include "Enum.hpp"
 
@@ -413,6 +415,26 @@ void renderOverlayText ( IDirect3DDevice9 *device, const D3DVIEWPORT9& viewport
 
 #endif // RELEASE
 
+    if ( DllRollbackProfiler::isOverlayEnabled() && ! DllRollbackProfiler::getOverlayText().empty() )
+    {
+        RECT rect;
+        rect.top = rect.left = OVERLAY_TEXT_BORDER;
+        rect.right = viewport.Width - OVERLAY_TEXT_BORDER;
+        rect.bottom = viewport.Height - OVERLAY_TEXT_BORDER;
+
+        DrawText ( font, DllRollbackProfiler::getOverlayText(), rect, DT_WORDBREAK | DT_LEFT, OVERLAY_TEXT_COLOR );
+    }
+
+    if ( DllInputLatency::isOverlayEnabled() && ! DllInputLatency::getOverlayText().empty() )
+    {
+        RECT rect;
+        rect.top = rect.left = OVERLAY_TEXT_BORDER;
+        rect.right = viewport.Width - OVERLAY_TEXT_BORDER;
+        rect.bottom = viewport.Height - OVERLAY_TEXT_BORDER;
+
+        DrawText ( font, DllInputLatency::getOverlayText(), rect, DT_WORDBREAK | DT_RIGHT, OVERLAY_TEXT_COLOR );
+    }
+
     if ( ! TrialManager::dtext.empty() && !TrialManager::hideText ) {
         int debugTextAlign = 1;
         RECT rect2;
@@ -2,9 +2,11 @@
 #include "MemDump.hpp"
 #include "DllAsmHacks.hpp"
 #include "ErrorStringsExt.hpp"
+#include "StateSnapshots.hpp"
 
 #include <utility>
 #include <algorithm>
+#include <cstdio>
 
 using namespace std;
 
@@ -32,6 +34,22 @@ void DllRollbackManager::GameState::save()
     ASSERT ( dump == rawBytes + allAddrs.totalSize );
 }
 
+void DllRollbackManager::GameState::saveAndHash()
+{
+    ASSERT ( rawBytes != 0 );
+
+    char *dump = rawBytes;
+    StateHasher stateHash;
+
+    for ( const MemDump& mem : allAddrs.addrs )
+        mem.saveDump ( dump, stateHash );
+
+    ASSERT ( dump == rawBytes + allAddrs.totalSize );
+
+    hash = stateHash.digest();
+    hasHash = true;
+}
+
 void DllRollbackManager::GameState::load()
 {
     fesetenv(&fp_env);
@@ -79,7 +97,7 @@ void DllRollbackManager::deallocateStates()
     _statesList.clear();
 }
 
-void DllRollbackManager::saveState ( const NetplayManager& netMan )
+void DllRollbackManager::saveState ( const NetplayManager& netMan, bool computeHash )
 {
     if ( _freeStack.empty() )
     {
@@ -113,13 +131,58 @@ void DllRollbackManager::saveState ( const NetplayManager& netMan )
     };
 
     _freeStack.pop();
-    state.save();
+
+    if ( computeHash )
+        state.saveAndHash();
+    else
+        state.save();
+
     _statesList.push_back ( state );
 
     uint8_t *currentSfxArray = &_sfxHistory [ netMan.getFrame() % NUM_ROLLBACK_STATES ][0];
     memcpy ( currentSfxArray, AsmHacks::sfxFilterArray, CC_SFX_ARRAY_LEN );
 }
 
+// Erase one frame of inputs from the game's replay structs for each frame rolled back.
+// These are not part of the saved game states, so they have to be trimmed after restoring an earlier state.
+static void eraseReplayInputs ( int rbFrames )
+{
+    for (; rbFrames > 0; rbFrames--) {
+        if (!*(RepRound**)CC_REPROUND_TBL_ENDPTR_ADDR) {
+            LOG( "Missing replay table" );
+            break;
+        }
+        RepRound* curRound = (*(RepRound**)CC_REPROUND_TBL_ENDPTR_ADDR - 1);
+        LOG( "%d", curRound );
+        if (!curRound->inputs) {
+            LOG( "Missing inputs" );
+            break;
+        }
+        // Assumes there are always containers for 4 players in input container table; may not be true
+        for (int i=0; i<4; i++) {
+            RepInputContainer* inputs = &(curRound->inputs[i]);
+            if (!inputs->states) {
+                LOG( "player %d no states", i );
+                continue;
+            }
+            RepInputState* state = &(inputs->states[inputs->activeIndex]);
+            if (!state->frameCount) {
+                LOG( "player %d no framecount", i+1 );
+                continue;
+            }
+            if (state->frameCount == 1) {
+                memset(state, 0, sizeof(RepInputState));
+                inputs->statesEnd -= sizeof(RepInputState);
+                LOG("Replay state %i for p%i has frame count 1; decrementing index", inputs->activeIndex, i+1);
+                inputs->activeIndex--;
+            } else {
+                LOG("Replay state %i for p%i has frame count %i; decrementing count", inputs->activeIndex, i+1, state->frameCount);
+                state->frameCount--;
+            }
+        }
+    }
+}
+
 bool DllRollbackManager::loadState ( IndexedFrame indexedFrame, NetplayManager& netMan )
 {
     if ( _statesList.empty() )
@@ -128,8 +191,8 @@ bool DllRollbackManager::loadState ( IndexedFrame indexedFrame, NetplayManager&
         return false;
     }
 
-    LOG ( "Trying to load state: indexedFrame=%s; _statesList={ %s ... %s }",
-          indexedFrame, _statesList.front().indexedFrame, _statesList.back().indexedFrame );
+    LOG_AT ( Rollback, DEBUG, "Trying to load state: indexedFrame=%s; _statesList={ %s ... %s }",
+             indexedFrame, _statesList.front().indexedFrame, _statesList.back().indexedFrame );
 
     const uint32_t origFrame = netMan.getFrame();
 
@@ -141,7 +204,7 @@ bool DllRollbackManager::loadState ( IndexedFrame indexedFrame, NetplayManager&
         if ( it->indexedFrame.value <= indexedFrame.value )
 #endif
         {
-            LOG ( "Loaded state: indexedFrame=%s", it->indexedFrame );
+            LOG_AT ( Rollback, DEBUG, "Loaded state: indexedFrame=%s", it->indexedFrame );
 
             // Overwrite the current game state
             netMan._state = it->netplayState;
@@ -153,7 +216,7 @@ bool DllRollbackManager::loadState ( IndexedFrame indexedFrame, NetplayManager&
             int rbFrames;
             if ( !netMan.config.mode.isTraining() ) {
                 rbFrames = _statesList.back().indexedFrame.value - it->indexedFrame.value;
-                LOG("Rolled back %i frames", rbFrames);
+                LOG_AT ( Rollback, DEBUG, "Rolled back %i frames", rbFrames );
             }
             // Erase all other states after the current one.
             // Note: it.base() returns 1 after the position of it, but moving forward.
@@ -165,41 +228,7 @@ bool DllRollbackManager::loadState ( IndexedFrame indexedFrame, NetplayManager&
             // Disable rollback for input history if in training mode
             if ( !netMan.config.mode.isTraining() ) {
                 LOG( "Fixing input history for rbFrames %d", rbFrames );
-                // Erase one frame of inputs from the game's replay structs for each frame rolled back.
-                for (; rbFrames > 0; rbFrames--) {
-                    if (!*(RepRound**)CC_REPROUND_TBL_ENDPTR_ADDR) {
-                        LOG( "Missing replay table" );
-                        break;
-                    }
-                    RepRound* curRound = (*(RepRound**)CC_REPROUND_TBL_ENDPTR_ADDR - 1);
-                    LOG( "%d", curRound );
-                    if (!curRound->inputs) {
-                        LOG( "Missing inputs" );
-                        break;
-                    }
-                    // Assumes there are always containers for 4 players in input container table; may not be true
-                    for (int i=0; i<4; i++) {
-                        RepInputContainer* inputs = &(curRound->inputs[i]);
-                        if (!inputs->states) {
-                            LOG( "player %d no states", i );
-                            continue;
-                        }
-                        RepInputState* state = &(inputs->states[inputs->activeIndex]);
-                        if (!state->frameCount) {
-                            LOG( "player %d no framecount", i+1 );
-                            continue;
-                        }
-                        if (state->frameCount == 1) {
-                            memset(state, 0, sizeof(RepInputState));
-                            inputs->statesEnd -= sizeof(RepInputState);
-                            LOG("Replay state %i for p%i has frame count 1; decrementing index", inputs->activeIndex, i+1);
-                            inputs->activeIndex--;
-                        } else {
-                            LOG("Replay state %i for p%i has frame count %i; decrementing count", inputs->activeIndex, i+1, state->frameCount);
-                            state->frameCount--;
-                        }
-                    }
-                }
+                eraseReplayInputs ( rbFrames );
             }
 
             _statesList.erase ( it.base(), _statesList.end() );
@@ -229,6 +258,131 @@ bool DllRollbackManager::loadState ( IndexedFrame indexedFrame, NetplayManager&
     return false;
 }
 
+bool DllRollbackManager::getStateHash ( IndexedFrame indexedFrame, uint64_t& hash ) const
+{
+    for ( auto it = _statesList.rbegin(); it != _statesList.rend(); ++it )
+    {
+        if ( it->indexedFrame.value != indexedFrame.value )
+            continue;
+
+        if ( ! it->hasHash )
+            return false;
+
+        hash = it->hash;
+        return true;
+    }
+
+    return false;
+}
+
+bool DllRollbackManager::dumpStates ( const string& file, IndexedFrame lastIndexedFrame ) const
+{
+    FILE *fp = fopen ( file.c_str(), "wb" );
+
+    if ( ! fp )
+    {
+        LOG ( "Failed to open '%s'", file );
+        return false;
+    }
+
+    StateSnapshotsHeader header;
+    memcpy ( header.magic, STATE_SNAPSHOTS_MAGIC, sizeof ( header.magic ) );
+    header.stateSize = allAddrs.totalSize;
+    header.numStates = 0;
+
+    for ( const GameState& state : _statesList )
+        if ( state.indexedFrame.value <= lastIndexedFrame.value )
+            ++header.numStates;
+
+    bool good = ( fwrite ( &header, sizeof ( header ), 1, fp ) == 1 );
+
+    for ( const GameState& state : _statesList )
+    {
+        if ( ! good || state.indexedFrame.value > lastIndexedFrame.value )
+            break;
+
+        good = ( fwrite ( &state.indexedFrame.value, sizeof ( state.indexedFrame.value ), 1, fp ) == 1
+                 && fwrite ( state.rawBytes, allAddrs.totalSize, 1, fp ) == 1 );
+    }
+
+    fclose ( fp );
+
+    LOG ( "Dumped %u states up to [%s] to '%s'; good=%u", header.numStates, lastIndexedFrame, file, good );
+    return good;
+}
+
+void DllRollbackManager::saveKeyframe ( const NetplayManager& netMan, ReplayKeyframes& keyframes )
+{
+    _keyframeBytes.resize ( sizeof ( std::fenv_t ) + allAddrs.totalSize );
+
+    char *dump = &_keyframeBytes[0];
+
+    fegetenv ( ( std::fenv_t * ) dump );
+    dump += sizeof ( std::fenv_t );
+
+    for ( const MemDump& mem : allAddrs.addrs )
+        mem.saveDump ( dump );
+
+    ASSERT ( dump == &_keyframeBytes[0] + _keyframeBytes.size() );
+
+    keyframes.save ( netMan._state, netMan._startWorldTime, netMan._indexedFrame,
+                     &_keyframeBytes[0], _keyframeBytes.size() );
+}
+
+bool DllRollbackManager::loadKeyframe ( const ReplayKeyframes::Keyframe& keyframe, NetplayManager& netMan )
+{
+    _keyframeBytes.resize ( sizeof ( std::fenv_t ) + allAddrs.totalSize );
+
+    if ( keyframe.size != _keyframeBytes.size() || ! ReplayKeyframes::load ( keyframe, &_keyframeBytes[0] ) )
+    {
+        LOG ( "Failed to load keyframe: indexedFrame=%s", keyframe.indexedFrame );
+        return false;
+    }
+
+    LOG ( "Loaded keyframe: indexedFrame=%s", keyframe.indexedFrame );
+
+    const IndexedFrame origIndexedFrame = netMan._indexedFrame;
+
+    // Overwrite the current game state
+    netMan._state = keyframe.netplayState;
+    netMan._startWorldTime = keyframe.startWorldTime;
+    netMan._indexedFrame = keyframe.indexedFrame;
+
+    const char *dump = &_keyframeBytes[0];
+
+    fesetenv ( ( const std::fenv_t * ) dump );
+    dump += sizeof ( std::fenv_t );
+
+    for ( const MemDump& mem : allAddrs.addrs )
+        mem.loadDump ( dump );
+
+    ASSERT ( dump == &_keyframeBytes[0] + _keyframeBytes.size() );
+
+    // Trim the game's replay inputs back to the keyframe, same as loadState. This only works within an index,
+    // otherwise the inputs recorded since then aren't all in the current round. Seeking forward can't fill in
+    // the skipped inputs either, so the game's own replay is only complete if the seek went backwards.
+    if ( ! netMan.config.mode.isTraining() && origIndexedFrame.value > keyframe.indexedFrame.value )
+    {
+        if ( origIndexedFrame.parts.index == keyframe.indexedFrame.parts.index )
+            eraseReplayInputs ( origIndexedFrame.parts.frame - keyframe.indexedFrame.parts.frame );
+        else
+            LOG ( "Not trimming replay inputs from [%s] to [%s]", origIndexedFrame, keyframe.indexedFrame );
+    }
+
+    // The saved game states are from another point in the replay, so none of them can be rolled back to
+    for ( const GameState& state : _statesList )
+        _freeStack.push ( state.rawBytes - _memoryPool.get() );
+
+    _statesList.clear();
+
+    // Nothing was played since the keyframe, so there are no sound effects to filter
+    for ( auto& sfxArray : _sfxHistory )
+        memset ( &sfxArray[0], 0, CC_SFX_ARRAY_LEN );
+
+    memset ( AsmHacks::sfxFilterArray, 0, CC_SFX_ARRAY_LEN );
+    return true;
+}
+
 void DllRollbackManager::saveRerunSounds ( uint32_t frame )
 {
     uint8_t *currentSfxArray = &_sfxHistory [ frame % NUM_ROLLBACK_STATES ][0];
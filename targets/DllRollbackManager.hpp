@@ -1,6 +1,7 @@
 #pragma once
 
 #include "DllNetplayManager.hpp"
+#include "ReplayKeyframes.hpp"
 #include "Constants.hpp"
 
 #include <memory>
@@ -8,6 +9,7 @@
 #include <list>
 #include <array>
 #include <cfenv>
+#include <string>
 
 struct __attribute__((packed)) RepInputState
 {
@@ -44,10 +46,22 @@ public:
     void allocateStates();
     void deallocateStates();
 
-    // Save / load current game state
-    void saveState ( const NetplayManager& netMan );
+    // Save / load current game state, optionally hashing the saved bytes in the same pass
+    void saveState ( const NetplayManager& netMan, bool computeHash = false );
     bool loadState ( IndexedFrame indexedFrame, NetplayManager& netMan );
 
+    // Get the hash of a saved game state, returns false if the state doesn't exist or wasn't hashed
+    bool getStateHash ( IndexedFrame indexedFrame, uint64_t& hash ) const;
+
+    // Write all saved game states up to and including the given frame to a snapshots file
+    bool dumpStates ( const std::string& file, IndexedFrame lastIndexedFrame ) const;
+
+    // Save the current game state as a replay keyframe
+    void saveKeyframe ( const NetplayManager& netMan, ReplayKeyframes& keyframes );
+
+    // Restore a replay keyframe (this resets game state AND netMan state), all saved game states are dropped
+    bool loadKeyframe ( const ReplayKeyframes::Keyframe& keyframe, NetplayManager& netMan );
+
     // Save sounds during rollback re-run
     void saveRerunSounds ( uint32_t frame );
 
@@ -68,8 +82,13 @@ private:
         // The pointer to the raw bytes in the state pool
         char *rawBytes;
 
+        // Hash of the raw bytes, only valid if hasHash
+        uint64_t hash = 0;
+        bool hasHash = false;
+
         // Save / load the game state
         void save();
+        void saveAndHash();
         void load();
     };
 
@@ -82,6 +101,9 @@ private:
     // List of saved game states in chronological order
     std::list<GameState> _statesList;
 
+    // Uncompressed keyframe, the floating point environment followed by the game state
+    std::string _keyframeBytes;
+
     // History of sound effect playbacks
     std::array<std::array<uint8_t, CC_SFX_ARRAY_LEN>, NUM_ROLLBACK_STATES> _sfxHistory;
 };
@@ -0,0 +1,276 @@
+#include "DllRollbackProfiler.hpp"
+#include "Statistics.hpp"
+#include "StringUtils.hpp"
+#include "Logger.hpp"
+#include "TimerManager.hpp"
+
+#include <atomic>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+
+using namespace std;
+
+
+// Number of log-linear histogram buckets, values under 16us get their own bucket,
+// then each power of 2 is split into 4 sub-buckets, which is good to about 20% resolution.
+#define NUM_BUCKETS                 ( 16 + ( 32 - 4 ) * 4 )
+
+// Re-run frame counts above this are clamped into the last bucket
+#define MAX_RERUN_BUCKET            ( 64 )
+
+// Number of committed frames between overlay text updates
+#define OVERLAY_UPDATE_INTERVAL     ( 60 )
+
+
+static const char *stageNames[DllRollbackProfiler::NumStages] = { "save", "wait", "load", "rerun" };
+
+
+namespace DllRollbackProfiler
+{
+
+// Sample being accumulated for the current frame
+static FrameSample current = {};
+
+// Start times of each stage, 0 if not running
+static array<uint64_t, NumStages> started = {{ 0 }};
+
+// Single producer ring, head is the total number of samples ever written
+static array<FrameSample, ROLLBACK_PROFILER_RING_SIZE> ring;
+static atomic<uint32_t> head ( 0 );
+
+// Session histograms and statistics, only non-zero stage times are counted
+static array<array<uint32_t, NUM_BUCKETS>, NumStages> histograms;
+static array<uint32_t, MAX_RERUN_BUCKET + 1> rerunHistogram;
+static array<Statistics, NumStages> sessionStats;
+
+static bool overlayEnabled = false;
+
+static string overlayText;
+
+
+static uint32_t bucketIndex ( uint32_t value )
+{
+    if ( value < 16 )
+        return value;
+
+    const uint32_t msb = 31 - __builtin_clz ( value );
+
+    return 16 + ( msb - 4 ) * 4 + ( ( value >> ( msb - 2 ) ) & 3 );
+}
+
+static uint32_t bucketLowerBound ( uint32_t index )
+{
+    if ( index < 16 )
+        return index;
+
+    const uint32_t msb = 4 + ( index - 16 ) / 4;
+
+    return ( 4 + ( index - 16 ) % 4 ) << ( msb - 2 );
+}
+
+static void updateOverlayText()
+{
+    static FrameSample samples[ROLLBACK_PROFILER_WINDOW];
+
+    const size_t count = getRecentSamples ( samples, ROLLBACK_PROFILER_WINDOW );
+
+    overlayText = format ( "Rollback profile (last %uf)", count );
+
+    vector<uint32_t> values;
+    values.reserve ( count );
+
+    for ( uint8_t stage = 0; stage < NumStages; ++stage )
+    {
+        values.clear();
+
+        for ( size_t i = 0; i < count; ++i )
+            if ( samples[i].times[stage] )
+                values.push_back ( samples[i].times[stage] );
+
+        if ( values.empty() )
+        {
+            overlayText += format ( "\n%s: -", stageNames[stage] );
+            continue;
+        }
+
+        sort ( values.begin(), values.end() );
+
+        const auto percentile = [&] ( size_t p ) { return values[ ( values.size() - 1 ) * p / 100 ] / 1000.0; };
+
+        overlayText += format ( "\n%s: p50 %.2f p90 %.2f p99 %.2f max %.2f ms [%u]", stageNames[stage],
+                                percentile ( 50 ), percentile ( 90 ), percentile ( 99 ), values.back() / 1000.0,
+                                values.size() );
+    }
+
+    uint32_t rollbacks = 0, rerunFrames = 0;
+
+    for ( size_t i = 0; i < count; ++i )
+    {
+        if ( samples[i].rerunFrames )
+            ++rollbacks;
+
+        rerunFrames += samples[i].rerunFrames;
+    }
+
+    if ( rollbacks )
+        overlayText += format ( "\nrollbacks: %u; avg re-run: %.1ff", rollbacks, double ( rerunFrames ) / rollbacks );
+}
+
+
+void begin ( Stage stage )
+{
+    started[stage] = TimerManager::queryNowUs();
+}
+
+void end ( Stage stage )
+{
+    if ( ! started[stage] )
+        return;
+
+    current.times[stage] += uint32_t ( TimerManager::queryNowUs() - started[stage] );
+    started[stage] = 0;
+}
+
+void addRerunFrame()
+{
+    ++current.rerunFrames;
+}
+
+void commitFrame ( IndexedFrame indexedFrame )
+{
+    current.indexedFrame = indexedFrame;
+
+    const uint32_t h = head.load ( memory_order_relaxed );
+    ring[h % ROLLBACK_PROFILER_RING_SIZE] = current;
+    head.store ( h + 1, memory_order_release );
+
+    for ( uint8_t stage = 0; stage < NumStages; ++stage )
+    {
+        if ( ! current.times[stage] )
+            continue;
+
+        ++histograms[stage][bucketIndex ( current.times[stage] )];
+        sessionStats[stage].addSample ( current.times[stage] );
+    }
+
+    if ( current.rerunFrames )
+        ++rerunHistogram[min<uint32_t> ( current.rerunFrames, MAX_RERUN_BUCKET )];
+
+    if ( overlayEnabled && ( h + 1 ) % OVERLAY_UPDATE_INTERVAL == 0 )
+        updateOverlayText();
+
+    discardFrame();
+}
+
+void discardFrame()
+{
+    // A stage that is still running, ie a re-run, carries over into the next sample
+    current = FrameSample();
+}
+
+size_t getRecentSamples ( FrameSample *samples, size_t count )
+{
+    const uint32_t h = head.load ( memory_order_acquire );
+
+    // Leave some slack so the producer is unlikely to lap us while copying
+    count = min<size_t> ( { count, h, ROLLBACK_PROFILER_RING_SIZE / 2 } );
+
+    for ( size_t i = 0; i < count; ++i )
+        samples[i] = ring[ ( h - count + i ) % ROLLBACK_PROFILER_RING_SIZE ];
+
+    // Drop any samples the producer may have overwritten while copying, including the one it is writing now
+    const uint32_t written = head.load ( memory_order_acquire ) - h + 1;
+
+    if ( written + count > ROLLBACK_PROFILER_RING_SIZE )
+    {
+        const size_t dropped = min<size_t> ( count, written + count - ROLLBACK_PROFILER_RING_SIZE );
+
+        copy ( samples + dropped, samples + count, samples );
+        count -= dropped;
+    }
+
+    return count;
+}
+
+void toggleOverlay()
+{
+    overlayEnabled = !overlayEnabled;
+
+    if ( overlayEnabled )
+        updateOverlayText();
+    else
+        overlayText.clear();
+}
+
+bool isOverlayEnabled()
+{
+    return overlayEnabled;
+}
+
+const string& getOverlayText()
+{
+    return overlayText;
+}
+
+bool dumpHistogram ( const string& file )
+{
+    FILE *fp = fopen ( file.c_str(), "w" );
+
+    if ( ! fp )
+    {
+        LOG ( "Failed to open '%s'", file );
+        return false;
+    }
+
+    fprintf ( fp, "# Rollback profile: %u frames\n", getNumSamples() );
+
+    for ( uint8_t stage = 0; stage < NumStages; ++stage )
+    {
+        const Statistics& stats = sessionStats[stage];
+
+        fprintf ( fp, "\n[%s] count=%u; mean=%.1fus; stddev=%.1fus; worst=%.0fus\n", stageNames[stage],
+                  stats.getNumSamples(), stats.getMean(), stats.getStdDev(),
+                  stats.getNumSamples() ? stats.getWorst() : 0.0 );
+
+        for ( uint32_t i = 0; i < NUM_BUCKETS; ++i )
+            if ( histograms[stage][i] )
+                fprintf ( fp, "%u %u\n", bucketLowerBound ( i ), histograms[stage][i] );
+    }
+
+    fprintf ( fp, "\n[rerunFrames]\n" );
+
+    for ( uint32_t i = 0; i <= MAX_RERUN_BUCKET; ++i )
+        if ( rerunHistogram[i] )
+            fprintf ( fp, "%u %u\n", i, rerunHistogram[i] );
+
+    fclose ( fp );
+
+    LOG ( "Dumped rollback profile to '%s'", file );
+    return true;
+}
+
+size_t getNumSamples()
+{
+    return head.load ( memory_order_acquire );
+}
+
+void reset()
+{
+    current = FrameSample();
+    started.fill ( 0 );
+    head.store ( 0, memory_order_release );
+
+    for ( auto& histogram : histograms )
+        histogram.fill ( 0 );
+
+    rerunHistogram.fill ( 0 );
+
+    for ( auto& stats : sessionStats )
+        stats.reset();
+
+    overlayText.clear();
+}
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Constants.hpp"
+
+#include <string>
+#include <cstdint>
+
+
+// Number of frames kept in the sample ring
+#define ROLLBACK_PROFILER_RING_SIZE     ( 1024 )
+
+// Number of recent frames used for the overlay percentiles
+#define ROLLBACK_PROFILER_WINDOW        ( 600 )
+
+
+// Low overhead profiler for the rollback path, samples are committed once per frame by DllMain::frameStep.
+// The timings of a rollback (save, input wait, load, and every re-run frame) are accumulated into the sample
+// of the frame where the re-run finishes, so each sample is the total cost of one displayed frame.
+namespace DllRollbackProfiler
+{
+
+enum Stage : uint8_t { Save, Wait, Load, Rerun, NumStages };
+
+struct FrameSample
+{
+    IndexedFrame indexedFrame;
+
+    // Time spent in each stage in microseconds
+    uint32_t times[NumStages];
+
+    // Number of frames re-run in this frame
+    uint32_t rerunFrames;
+};
+
+// Start / stop timing a stage, multiple begin/end pairs in the same frame are accumulated
+void begin ( Stage stage );
+void end ( Stage stage );
+
+// Count a re-run frame for the current sample
+void addRerunFrame();
+
+// Push the current sample into the ring and the session histograms, then start a new sample
+void commitFrame ( IndexedFrame indexedFrame );
+
+// Drop the current sample, ie outside of the states we want to profile
+void discardFrame();
+
+// Copy up to count of the most recent samples into the given buffer, oldest first.
+// This is lock-free and may be called from any thread, returns the number of samples copied.
+size_t getRecentSamples ( FrameSample *samples, size_t count );
+
+// Rolling percentiles shown in the overlay
+void toggleOverlay();
+bool isOverlayEnabled();
+const std::string& getOverlayText();
+
+// Write the session histograms to a text file
+bool dumpHistogram ( const std::string& file );
+
+// Number of samples committed this session
+size_t getNumSamples();
+
+// Clear all samples and histograms
+void reset();
+
+}
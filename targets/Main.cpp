@@ -256,6 +256,12 @@ int main ( int argc, char *argv[] )
             "                         D is the optional delay, defaults to 0.\n"
         },
 
+        {
+            Options::AutoDelay, 0, "", "auto-delay", Arg::None,
+            "  --auto-delay         Adjust the rollback input delay before each round,\n"
+            "                         based on the latency measured during the match.\n"
+        },
+
         {
             Options::NoUi, 0, "n", "no-ui", Arg::None,
             "  --no-ui, -n          No UI, just quits after running once.\n"
@@ -268,6 +274,19 @@ int main ( int argc, char *argv[] )
             "                         with 1.5 second held start button."
         },
 
+        {
+            Options::LogLevels, 0, "", "log-levels", Arg::Required,
+            "  --log-levels spec    Set log levels per category, eg net=warn,gbn=off.\n"
+            "                         Categories: net, gbn, rollback, input, ui, frame, or * for all.\n"
+            "                         Levels: trace, debug, info, warn, error, off.\n"
+        },
+
+        {
+            Options::BinarySyncLog, 0, "", "binary-sync-log", Arg::None,
+            "  --binary-sync-log    Write the sync log in the binary format to sync.bin.\n"
+            "                         Convert it to text with synclogconvert.\n"
+        },
+
 #ifndef RELEASE
         { Options::Unknown,   0,  "",       "", Arg::None,        "Debug options:" },
         { Options::Tests,     0,  "",  "tests", Arg::None,        "  --tests              Run unit tests and exit" },
@@ -296,6 +315,12 @@ int main ( int argc, char *argv[] )
             "  --replay, -R args    Replay the given file with options.\n"
             "                         TODO list possible arguments.\n"
         },
+
+        {
+            Options::Predictor, 0, "", "predictor", Arg::Required,
+            "  --predictor name     Remote input predictor during rollback.\n"
+            "                         One of: hold (default), release, learned.\n"
+        },
 #else
         { Options::Tunnel, 0, "", "tunnel", Arg::None, 0 },
         { Options::Dummy, 0, "", "dummy", Arg::None, 0 },
@@ -403,6 +428,11 @@ int main ( int argc, char *argv[] )
         Logger::get().initialize ( ProcessManager::appDir + LOG_FILE );
     Logger::get().logVersion();
 
+    if ( opt[Options::LogLevels] && ! Logger::get().setLevels ( opt[Options::LogLevels].arg ) )
+        LOG ( "Invalid log levels: '%s'", opt[Options::LogLevels].arg );
+
+    LOG ( "Log levels: %s", Logger::get().getLevels() );
+
     LOG ( "Running from: %s", ProcessManager::appDir );
 
     // Log parsed command line opt
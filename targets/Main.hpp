@@ -20,6 +20,9 @@ void __stdcall log(const char* format, ...);
 // Log file that contains all the data needed to keep games in sync
 #define SYNC_LOG_FILE FOLDER "sync.log"
 
+// Binary sync log file, see SyncLog.hpp
+#define SYNC_LOG_BINARY_FILE FOLDER "sync.bin"
+
 // Controller mappings file extension
 #define MAPPINGS_EXT ".mappings"
 
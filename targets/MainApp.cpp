@@ -624,6 +624,9 @@ struct MainApp
         LOG ( "PingStats (merged): latency=%.2f ms; worst=%.2f ms; stderr=%.2f ms; stddev=%.2f ms; packetLoss=%d%%",
               pingStats.latency.getMean(), pingStats.latency.getWorst(),
               pingStats.latency.getStdErr(), pingStats.latency.getStdDev(), pingStats.packetLoss );
+
+        LOG ( "PingStats (merged): p50=%.2f ms; p90=%.2f ms; p99=%.2f ms", pingStats.latency.getQuantile ( 0.5 ),
+              pingStats.latency.getQuantile ( 0.9 ), pingStats.latency.getQuantile ( 0.99 ) );
     }
 
     void gotSpectateConfig ( const SpectateConfig& spectateConfig )
@@ -769,7 +772,7 @@ struct MainApp
             
             // Calculate delay based on ping (same logic as MainUi::connected)
             const int delay = computeDelay(pingStats.latency.getMean());
-            const int worst = computeDelay(pingStats.latency.getWorst());
+            const int worst = computeDelay(pingStats.latency.getQuantile(0.99));
             const int variance = computeDelay(pingStats.latency.getVariance());
             
             // Create NetplayConfig with reasonable defaults (same as MainUi::connected does)
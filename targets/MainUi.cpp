@@ -1785,7 +1785,7 @@ bool MainUi::configure ( const PingStats& pingStats )
     ASSERT ( _ui.get() != 0 );
 
     const int delay = computeDelay ( pingStats.latency.getMean() );
-    const int worst = computeDelay ( pingStats.latency.getWorst() );
+    const int worst = computeDelay ( pingStats.latency.getQuantile ( 0.99 ) );
     const int variance = computeDelay ( pingStats.latency.getVariance() );
 
     int rollback = clamped ( delay + worst + variance, 0, _config.getInteger ( "defaultRollback" ) );
@@ -1966,6 +1966,7 @@ string MainUi::formatStats ( const PingStats& pingStats )
     return format (
                "%-" INDENT_STATS "s Ping: %.2f ms"
 #ifndef NDEBUG
+               "\n%-" INDENT_STATS "s p50 / p90 / p99: %.2f / %.2f / %.2f ms"
                "\n%-" INDENT_STATS "s Worst: %.2f ms"
                "\n%-" INDENT_STATS "s StdErr: %.2f ms"
                "\n%-" INDENT_STATS "s StdDev: %.2f ms"
@@ -1974,6 +1975,8 @@ string MainUi::formatStats ( const PingStats& pingStats )
                , format ( "Network delay: %d", computeDelay ( pingStats.latency.getMean() ) )
                , pingStats.latency.getMean()
 #ifndef NDEBUG
+               , "", pingStats.latency.getQuantile ( 0.5 ), pingStats.latency.getQuantile ( 0.9 )
+               , pingStats.latency.getQuantile ( 0.99 )
                , "", pingStats.latency.getWorst()
                , "", pingStats.latency.getStdErr()
                , "", pingStats.latency.getStdDev()
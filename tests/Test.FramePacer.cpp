@@ -0,0 +1,137 @@
+#ifndef RELEASE
+
+#include "FramePacer.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+
+// Simulated clock where each sleep oversleeps by a fixed amount, and each read of the time advances it slightly
+struct FakeClock : public FramePacer::Clock
+{
+    uint64_t now = 1000000, oversleep = 0, readCost = 1, slept = 0, reads = 0;
+
+    uint64_t getNow() override
+    {
+        ++reads;
+        return ( now += readCost );
+    }
+
+    void sleep ( uint64_t microseconds ) override
+    {
+        slept += microseconds;
+        now += microseconds + oversleep;
+    }
+};
+
+
+// The absolute schedule must not accumulate rounding errors from the fractional period
+TEST ( FramePacer, NoDrift )
+{
+    FakeClock clock;
+    FramePacer pacer ( clock );
+    pacer.setFps ( 60 );
+
+    pacer.wait();
+    const uint64_t start = clock.now;
+
+    uint64_t intervals = 0;
+    int64_t worstJitter = 0;
+
+    for ( size_t i = 0; i < 6000; ++i )
+    {
+        pacer.wait();
+        clock.now += 3000; // Simulated frame work
+
+        intervals += pacer.getLastInterval();
+        worstJitter = max ( worstJitter, pacer.getLastJitter() );
+    }
+
+    // 100 seconds of frames should end within a microsecond or two of the ideal time, plus the last frame's work
+    const double ideal = 6000 * 1e6 / 60 + 3000;
+    EXPECT_NEAR ( ideal, double ( clock.now - start ), 2.0 );
+
+    EXPECT_NEAR ( 1e6 / 60, intervals / 6000.0, 0.01 );
+    EXPECT_LE ( worstJitter, 2 );
+}
+
+// Most of each frame should be slept instead of spun, and the spin margin should cover the oversleep
+TEST ( FramePacer, SpinMargin )
+{
+    FakeClock clock;
+    FramePacer pacer ( clock );
+    pacer.setFps ( 60 );
+
+    pacer.wait();
+
+    // A sleep that wakes up very late grows the margin, up to the maximum
+    clock.oversleep = 10000;
+    pacer.wait();
+    EXPECT_EQ ( uint64_t ( FRAME_PACER_MAX_SPIN_MARGIN ), pacer.getSpinMargin() );
+
+    // An accurate sleep slowly shrinks the margin again
+    clock.oversleep = 100;
+
+    for ( size_t i = 0; i < 1000; ++i )
+        pacer.wait();
+
+    EXPECT_LT ( pacer.getSpinMargin(), uint64_t ( FRAME_PACER_SPIN_MARGIN ) );
+    EXPECT_GE ( pacer.getSpinMargin(), clock.oversleep );
+
+    // Once adapted, frames are on time and spinning is a small part of the frame
+    clock.slept = clock.reads = 0;
+
+    int64_t worstJitter = 0;
+
+    for ( size_t i = 0; i < 100; ++i )
+    {
+        pacer.wait();
+        worstJitter = max ( worstJitter, pacer.getLastJitter() );
+    }
+
+    EXPECT_LE ( worstJitter, 2 );
+    EXPECT_GT ( clock.slept, 100 * ( 1e6 / 60 - FRAME_PACER_SPIN_MARGIN ) );
+    EXPECT_LT ( clock.reads, uint64_t ( 100 * FRAME_PACER_SPIN_MARGIN ) );
+}
+
+// Falling far behind restarts the schedule, instead of running frames back to back to catch up
+TEST ( FramePacer, Restart )
+{
+    FakeClock clock;
+    FramePacer pacer ( clock );
+    pacer.setFps ( 60 );
+
+    pacer.wait();
+    pacer.wait();
+
+    // Stall for about 10 frames
+    clock.now += 10 * 1e6 / 60;
+    pacer.wait();
+
+    EXPECT_EQ ( 0u, pacer.getLastInterval() );
+
+    const uint64_t resumed = clock.now;
+    pacer.wait();
+
+    EXPECT_NEAR ( 1e6 / 60, double ( clock.now - resumed ), 2.0 );
+}
+
+// Zero FPS disables waiting entirely
+TEST ( FramePacer, Unlimited )
+{
+    FakeClock clock;
+    FramePacer pacer ( clock );
+    pacer.setFps ( 0 );
+
+    for ( size_t i = 0; i < 10; ++i )
+        pacer.wait();
+
+    EXPECT_EQ ( 0u, clock.slept );
+    EXPECT_EQ ( 10u, clock.reads );
+}
+
+#endif // NOT RELEASE
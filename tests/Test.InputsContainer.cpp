@@ -0,0 +1,219 @@
+#ifndef RELEASE
+
+#include "InputsContainer.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+
+using namespace std;
+
+
+#define NUM_ITERATIONS  ( 20000 )
+#define MAX_FRAME       ( 200 )
+
+
+// The ring storage must behave exactly like the vector storage
+TEST ( InputsContainer, RingMatchesVector )
+{
+    InputsContainer<uint16_t> expected;
+    RingInputsContainer<uint16_t> actual;
+
+    srand ( 1234 );
+
+    uint32_t index = 0;
+
+    for ( size_t i = 0; i < NUM_ITERATIONS; ++i )
+    {
+        const uint32_t frame = rand() % MAX_FRAME;
+        const uint16_t input = rand();
+
+        switch ( rand() % 8 )
+        {
+            case 0:
+                // Move to the next index, sometimes skipping one, more often than erasing so the ring has to grow
+                index += 1 + ( rand() % 4 == 0 );
+                break;
+
+            case 1:
+                if ( rand() % 32 == 0 )
+                {
+                    const size_t offset = rand() % ( expected.getEndIndex() + 1 );
+                    expected.eraseIndexOlderThan ( offset );
+                    actual.eraseIndexOlderThan ( offset );
+                    index = ( offset + 1 >= index ? 0 : index - offset );
+                }
+                break;
+
+            case 2:
+                expected.assign ( index, frame, input );
+                actual.assign ( index, frame, input );
+                break;
+
+            case 3:
+            {
+                const size_t n = 1 + rand() % 10;
+                expected.set ( index, frame, input, n );
+                actual.set ( index, frame, input, n );
+                break;
+            }
+
+            case 4:
+            {
+                uint16_t inputs[NUM_INPUTS];
+                for ( uint16_t& t : inputs )
+                    t = ( rand() % 4 ? input : rand() );
+
+                const uint32_t checkIndex = ( rand() % 2 ? 0 : UINT_MAX );
+                expected.set ( index, frame, inputs, NUM_INPUTS, checkIndex );
+                actual.set ( index, frame, inputs, NUM_INPUTS, checkIndex );
+                break;
+            }
+
+            default:
+                expected.set ( index, frame, input );
+                actual.set ( index, frame, input );
+                break;
+        }
+
+        ASSERT_EQ ( expected.getEndIndex(), actual.getEndIndex() );
+        ASSERT_EQ ( expected.getEndFrame(), actual.getEndFrame() );
+        ASSERT_EQ ( expected.getLastChangedFrame().value, actual.getLastChangedFrame().value );
+
+        if ( rand() % 4 == 0 )
+        {
+            expected.clearLastChangedFrame();
+            actual.clearLastChangedFrame();
+        }
+
+        for ( uint32_t j = 0; j <= expected.getEndIndex(); ++j )
+        {
+            ASSERT_EQ ( expected.empty ( j ), actual.empty ( j ) );
+            ASSERT_EQ ( expected.getEndFrame ( j ), actual.getEndFrame ( j ) );
+            ASSERT_EQ ( expected.get ( j, frame ), actual.get ( j, frame ) );
+        }
+    }
+}
+
+TEST ( InputsContainer, FirstMismatch )
+{
+    uint16_t a[100], b[100];
+
+    for ( size_t n = 0; n <= 64; ++n )
+    {
+        for ( size_t offset = 0; offset < 4; ++offset )
+        {
+            for ( size_t i = 0; i < 100; ++i )
+                a[i] = b[i] = 0x1234;
+
+            EXPECT_EQ ( n, firstMismatch ( a + offset, b + offset, n ) );
+            EXPECT_EQ ( n, firstNotEqual ( a + offset, uint16_t ( 0x1234 ), n ) );
+
+            for ( size_t j = 0; j < n; ++j )
+            {
+                // Only differs in the high byte, so the byte masks must be handled per element
+                b[offset + j] = 0x3434;
+
+                EXPECT_EQ ( j, firstMismatch ( a + offset, b + offset, n ) );
+                EXPECT_EQ ( j, firstNotEqual ( b + offset, uint16_t ( 0x1234 ), n ) );
+
+                b[offset + j] = 0x1234;
+            }
+        }
+    }
+}
+
+// The first changed frame must be the first input that is different from get(), like a frame by frame comparison
+TEST ( InputsContainer, LastChangedFrame )
+{
+    srand ( 5678 );
+
+    for ( size_t i = 0; i < NUM_ITERATIONS / 10; ++i )
+    {
+        RingInputsContainer<uint16_t> inputs;
+
+        const uint32_t endIndex = rand() % 3;
+
+        for ( uint32_t index = 0; index < endIndex; ++index )
+            if ( rand() % 2 )
+                inputs.set ( index, 0, rand() % 4, rand() % 50 );
+
+        const uint32_t index = rand() % 3, frame = rand() % 60;
+
+        uint16_t t[NUM_INPUTS];
+        for ( uint16_t& input : t )
+            input = rand() % 4;
+
+        uint32_t expected = UINT_MAX;
+
+        for ( uint32_t j = 0; j < NUM_INPUTS; ++j )
+        {
+            if ( inputs.get ( index, frame + j ) != t[j] )
+            {
+                expected = frame + j;
+                break;
+            }
+        }
+
+        inputs.set ( index, frame, t, NUM_INPUTS, 0 );
+
+        if ( expected == UINT_MAX )
+        {
+            EXPECT_EQ ( MaxIndexedFrame.value, inputs.getLastChangedFrame().value );
+        }
+        else
+        {
+            EXPECT_EQ ( index, inputs.getLastChangedFrame().parts.index );
+            EXPECT_EQ ( expected, inputs.getLastChangedFrame().parts.frame );
+        }
+    }
+}
+
+// Predicted inputs are returned after the end, and the first changed frame is compared against them
+TEST ( InputsContainer, Predictions )
+{
+    RingInputsContainer<uint16_t> inputs;
+
+    inputs.set ( 0, 0, 1, 10 );
+
+    for ( uint32_t frame = 10; frame < 20; ++frame )
+        inputs.setPrediction ( 0, frame, frame < 15 ? 1 : 2 );
+
+    EXPECT_EQ ( 1, inputs.get ( 0, 14 ) );
+    EXPECT_EQ ( 2, inputs.get ( 0, 15 ) );
+    EXPECT_EQ ( 1, inputs.get ( 0, 20 ) );
+
+    // Matches the predictions, so nothing changed
+    uint16_t t[10] = { 1, 1, 1, 1, 1, 2, 2, 2, 2, 2 };
+    inputs.set ( 0, 10, t, 10, 0 );
+    EXPECT_EQ ( MaxIndexedFrame.value, inputs.getLastChangedFrame().value );
+
+    for ( uint32_t frame = 20; frame < 30; ++frame )
+        inputs.setPrediction ( 0, frame, 2 );
+
+    // Differs from the prediction at frame 23, so the later predictions are dropped
+    uint16_t u[5] = { 2, 2, 2, 3, 3 };
+    inputs.set ( 0, 20, u, 5, 0 );
+    EXPECT_EQ ( 0, inputs.getLastChangedFrame().parts.index );
+    EXPECT_EQ ( 23, inputs.getLastChangedFrame().parts.frame );
+    EXPECT_TRUE ( inputs.hasPrediction ( 0, 22 ) );
+    EXPECT_FALSE ( inputs.hasPrediction ( 0, 23 ) );
+    EXPECT_EQ ( 3, inputs.get ( 0, 27 ) );
+
+    // Predictions are kept for the same index after erasing older indices
+    inputs.set ( 1, 0, 4, 5 );
+    inputs.set ( 2, 0, 4, 5 );
+    inputs.set ( 3, 0, 4, 5 );
+    inputs.setPrediction ( 2, 5, 5 );
+    inputs.eraseIndexOlderThan ( 2 );
+    EXPECT_TRUE ( inputs.hasPrediction ( 0, 5 ) );
+    EXPECT_EQ ( 5, inputs.get ( 0, 5 ) );
+
+    inputs.eraseIndexOlderThan ( 0 );
+    EXPECT_TRUE ( inputs.hasPrediction ( 0, 5 ) );
+
+    inputs.clear();
+    EXPECT_FALSE ( inputs.hasPrediction ( 0, 5 ) );
+}
+
+#endif // NOT RELEASE
@@ -0,0 +1,90 @@
+#ifndef RELEASE
+
+#include "Logger.hpp"
+
+#include <gtest/gtest.h>
+
+using namespace std;
+
+
+TEST ( Logger, Levels )
+{
+    Logger logger;
+
+    EXPECT_EQ ( "net=debug,gbn=debug,rollback=debug,input=debug,ui=debug,frame=debug", logger.getLevels() );
+    EXPECT_TRUE ( logger.isEnabled ( LogNet, LOG_LEVEL_DEBUG ) );
+    EXPECT_FALSE ( logger.isEnabled ( LogNet, LOG_LEVEL_TRACE ) );
+
+    EXPECT_TRUE ( logger.setLevels ( "net=warn, GBN=off" ) );
+    EXPECT_EQ ( "net=warn,gbn=off,rollback=debug,input=debug,ui=debug,frame=debug", logger.getLevels() );
+    EXPECT_FALSE ( logger.isEnabled ( LogNet, LOG_LEVEL_INFO ) );
+    EXPECT_TRUE ( logger.isEnabled ( LogNet, LOG_LEVEL_ERROR ) );
+    EXPECT_FALSE ( logger.isEnabled ( LogGoBackN, LOG_LEVEL_ERROR ) );
+
+    // Later parts override earlier ones
+    EXPECT_TRUE ( logger.setLevels ( "*=trace,ui=info,frame=trace" ) );
+    EXPECT_EQ ( "net=trace,gbn=trace,rollback=trace,input=trace,ui=info,frame=trace", logger.getLevels() );
+
+    // Invalid parts are skipped, the rest still applies
+    EXPECT_FALSE ( logger.setLevels ( "net=loud,bogus=off,input" ) );
+    EXPECT_FALSE ( logger.setLevels ( "rollback=error,foo" ) );
+    EXPECT_EQ ( "net=trace,gbn=trace,rollback=error,input=trace,ui=info,frame=trace", logger.getLevels() );
+}
+
+TEST ( Logger, DeferredArgs )
+{
+    EXPECT_TRUE ( IsDeferredLogArg<uint32_t>::value );
+    EXPECT_TRUE ( IsDeferredLogArg<double>::value );
+    EXPECT_TRUE ( IsDeferredLogArg<LogCategory>::value );
+    EXPECT_TRUE ( IsDeferredLogArg<const void *>::value );
+    EXPECT_TRUE ( IsDeferredLogArg<const uint32_t *>::value );
+    EXPECT_TRUE ( IsDeferredLogArg<LogHex>::value );
+
+    // Character pointers are formatted as strings, so they can't be deferred
+    EXPECT_FALSE ( IsDeferredLogArg<char *>::value );
+    EXPECT_FALSE ( IsDeferredLogArg<const char *>::value );
+    EXPECT_FALSE ( IsDeferredLogArg<const signed char *>::value );
+    EXPECT_FALSE ( IsDeferredLogArg<unsigned char *>::value );
+    EXPECT_FALSE ( IsDeferredLogArg<const uint8_t *>::value );
+    EXPECT_FALSE ( IsDeferredLogArg<const wchar_t *>::value );
+    EXPECT_FALSE ( IsDeferredLogArg<std::string>::value );
+
+    // Queued without a heap copy
+    EXPECT_LE ( sizeof ( std::tuple<LogHex> ), size_t ( LOG_RECORD_MESSAGE_SIZE ) );
+
+    const uint8_t bytes[LOG_HEX_SIZE + 16] = { 0 };
+    EXPECT_EQ ( uint32_t ( LOG_HEX_SIZE ), LogHex ( bytes, sizeof ( bytes ) ).length );
+}
+
+TEST ( Logger, AsyncDeinitialize )
+{
+    const string file = "test_logger_async.log";
+
+    {
+        Logger logger;
+        logger.initialize ( file, LOG_ASYNC );
+        logger.setFlushInterval ( 1000 );
+
+        for ( uint32_t i = 0; i < 100; ++i )
+            logger.logFormat ( __FILE__, __LINE__, __func__, "message %u", i );
+
+        // Stops the writer thread, so every queued message is written
+        logger.deinitialize();
+    }
+
+    FILE *fd = fopen ( file.c_str(), "r" );
+    ASSERT_TRUE ( fd != 0 );
+
+    char line[64];
+    uint32_t count = 0;
+
+    while ( fgets ( line, sizeof ( line ), fd ) )
+        EXPECT_EQ ( format ( "message %u\n", count++ ), line );
+
+    fclose ( fd );
+    remove ( file.c_str() );
+
+    EXPECT_EQ ( 100u, count );
+}
+
+#endif // NOT RELEASE
@@ -0,0 +1,108 @@
+#ifndef RELEASE
+
+#include "MpscRing.hpp"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <atomic>
+#include <vector>
+
+using namespace std;
+
+
+#define NUM_PRODUCERS   ( 4 )
+
+#define NUM_PUSHES      ( 100000 )
+
+
+struct TestRecord
+{
+    uint32_t producer, index;
+};
+
+
+TEST ( MpscRing, PushPop )
+{
+    MpscRing<TestRecord, 4> ring;
+
+    EXPECT_TRUE ( ring.empty() );
+
+    for ( uint32_t i = 0; i < 4; ++i )
+        EXPECT_TRUE ( ring.push ( [&] ( TestRecord& record ) { record = { 0, i }; } ) );
+
+    // Full, the callback must not be called
+    bool called = false;
+    EXPECT_FALSE ( ring.push ( [&] ( TestRecord& ) { called = true; } ) );
+    EXPECT_FALSE ( called );
+
+    for ( uint32_t i = 0; i < 4; ++i )
+    {
+        TestRecord popped = { 0, 0 };
+        EXPECT_TRUE ( ring.pop ( [&] ( TestRecord& record ) { popped = record; } ) );
+        EXPECT_EQ ( i, popped.index );
+    }
+
+    EXPECT_TRUE ( ring.empty() );
+    EXPECT_FALSE ( ring.pop ( [] ( TestRecord& ) {} ) );
+
+    // Wrap around
+    EXPECT_TRUE ( ring.push ( [] ( TestRecord& record ) { record = { 0, 10 }; } ) );
+    EXPECT_FALSE ( ring.empty() );
+    EXPECT_TRUE ( ring.pop ( [] ( TestRecord& record ) { EXPECT_EQ ( 10u, record.index ); } ) );
+}
+
+// Every value from every producer must be consumed exactly once, in order per producer
+TEST ( MpscRing, Concurrent )
+{
+    MpscRing<TestRecord, 256> ring;
+    atomic<uint32_t> done ( 0 );
+
+    vector<thread> producers;
+
+    for ( uint32_t p = 0; p < NUM_PRODUCERS; ++p )
+    {
+        producers.emplace_back ( [&, p]
+        {
+            for ( uint32_t i = 0; i < NUM_PUSHES; ++i )
+            {
+                while ( ! ring.push ( [&] ( TestRecord& record ) { record = { p, i }; } ) )
+                    this_thread::yield();
+            }
+
+            ++done;
+        } );
+    }
+
+    vector<uint32_t> next ( NUM_PRODUCERS, 0 );
+    size_t count = 0, outOfOrder = 0;
+
+    const auto consume = [&] ( TestRecord& record )
+    {
+        if ( record.index != next[record.producer] )
+            ++outOfOrder;
+
+        next[record.producer] = record.index + 1;
+        ++count;
+    };
+
+    while ( done < NUM_PRODUCERS || ! ring.empty() )
+    {
+        if ( ! ring.pop ( consume ) )
+            this_thread::yield();
+    }
+
+    for ( thread& producer : producers )
+        producer.join();
+
+    while ( ring.pop ( consume ) )
+        ;
+
+    EXPECT_EQ ( 0u, outOfOrder );
+    EXPECT_EQ ( size_t ( NUM_PRODUCERS * NUM_PUSHES ), count );
+
+    for ( uint32_t n : next )
+        EXPECT_EQ ( uint32_t ( NUM_PUSHES ), n );
+}
+
+#endif // NOT RELEASE
@@ -0,0 +1,235 @@
+#ifndef RELEASE
+
+#include "ReplayCreator.hpp"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <iterator>
+#include <cstdio>
+#include <climits>
+
+using namespace std;
+
+
+static ReplayCreator::ReplayFile makeReplay()
+{
+    ReplayCreator::ReplayFile rf = ReplayCreator::ReplayFile();
+
+    memcpy ( rf.headername, FILE_HEADER, sizeof ( rf.headername ) );
+    rf.numWins = 2;
+    rf.numRounds = 2;
+    rf.p1.character = 3;
+    rf.p2.moon = ReplayCreator::H;
+
+    for ( int j = 0; j < rf.numRounds; ++j )
+    {
+        ReplayCreator::Round round = ReplayCreator::Round();
+
+        round.unkrng1[0] = char ( j + 1 );
+        round.p4StartingMeter[3] = char ( j + 2 );
+
+        for ( int i = 0; i < 100 + j; ++i )
+        {
+            round.p1Inputs.push_back ( { uint8_t ( i ), 2, 1, 0, 0, 0 } );
+            round.p2Inputs.push_back ( { uint8_t ( i + 1 ), 6, 0, 4, 0, 0 } );
+            round.rngstates.push_back ( 0x12345678u * i );
+        }
+
+        round.lenp1Inputs = round.p1Inputs.size();
+        round.lenp2Inputs = round.p2Inputs.size();
+        round.lenp3Inputs = 0;
+        round.lenp4Inputs = 0;
+        round.lenRng = round.rngstates.size();
+
+        rf.rounds.push_back ( round );
+    }
+
+    return rf;
+}
+
+static string dumpReplay ( const ReplayCreator::ReplayFile& rf )
+{
+    char file[] = "test_replay.rep";
+
+    ReplayCreator().dump ( rf, file );
+
+    ifstream fin ( file, ios::binary );
+    const string data ( ( istreambuf_iterator<char> ( fin ) ), istreambuf_iterator<char>() );
+    fin.close();
+
+    remove ( file );
+    return data;
+}
+
+
+TEST ( ReplayCreator, ParseDump )
+{
+    const ReplayCreator::ReplayFile rf = makeReplay();
+    const string data = dumpReplay ( rf );
+
+    ReplayCreator::ReplayFile parsed;
+    ASSERT_TRUE ( ReplayCreator().parse ( &parsed, data.data(), data.size() ) );
+
+    EXPECT_EQ ( 2, parsed.numWins );
+    EXPECT_EQ ( 3, parsed.p1.character );
+    EXPECT_EQ ( int ( ReplayCreator::H ), parsed.p2.moon );
+    ASSERT_EQ ( rf.rounds.size(), parsed.rounds.size() );
+
+    for ( size_t j = 0; j < rf.rounds.size(); ++j )
+    {
+        EXPECT_EQ ( rf.rounds[j].unkrng1[0], parsed.rounds[j].unkrng1[0] );
+        EXPECT_EQ ( rf.rounds[j].p4StartingMeter[3], parsed.rounds[j].p4StartingMeter[3] );
+        EXPECT_TRUE ( rf.rounds[j].p1Inputs == parsed.rounds[j].p1Inputs );
+        EXPECT_TRUE ( rf.rounds[j].p2Inputs == parsed.rounds[j].p2Inputs );
+        EXPECT_TRUE ( parsed.rounds[j].p3Inputs.empty() );
+        EXPECT_TRUE ( rf.rounds[j].rngstates == parsed.rounds[j].rngstates );
+    }
+
+    // Dumping the parsed replay gives back the same file
+    EXPECT_EQ ( data, dumpReplay ( parsed ) );
+}
+
+TEST ( ReplayCreator, ParseTruncated )
+{
+    const string data = dumpReplay ( makeReplay() );
+
+    ReplayCreator::ReplayFile parsed;
+
+    for ( size_t size : { size_t ( 0 ), size_t ( 0x5F ), size_t ( 0x60 ), size_t ( 0x200 ), data.size() - 1 } )
+    {
+        EXPECT_FALSE ( ReplayCreator().parse ( &parsed, data.data(), size ) );
+        EXPECT_TRUE ( parsed.rounds.empty() );
+    }
+
+    // Input count larger than the rest of the file
+    string corrupt = data;
+    const int count = 0x7FFFFFFF;
+    memcpy ( &corrupt[0x60 + sizeof ( ReplayCreator::RoundStart )], &count, 4 );
+
+    EXPECT_FALSE ( ReplayCreator().parse ( &parsed, corrupt.data(), corrupt.size() ) );
+}
+
+TEST ( ReplayCreator, ExpandMatchesRaw )
+{
+    // Raw inputs with held buttons, direction changes, and a run longer than the 248 frame limit of one input
+    string raw = "2\n";
+
+    for ( int j = 0; j < 2; ++j )
+    {
+        raw += "600\n";
+
+        for ( int i = 0; i < 600; ++i )
+        {
+            char line[16];
+            sprintf ( line, "%04x %04x\n", ( i < 300 ? 0 : ( i / 7 ) % 10 ) | ( i % 11 < 3 ? 0x0100 : 0 ), ( i / 3 ) % 10 );
+            raw += line;
+        }
+    }
+
+    char file[] = "test_replay.repraw";
+    ofstream ( file, ios::binary ) << raw;
+
+    ReplayCreator creator;
+    ReplayCreator::ReplayFile rf = makeReplay();
+    creator.fixReplay ( &rf, file, 0 );
+
+    ReplayCreator::FrameReplay expanded, loaded;
+    creator.expandReplay ( &rf, expanded );
+    ASSERT_TRUE ( creator.loadRaw ( loaded, file ) );
+
+    remove ( file );
+
+    ASSERT_EQ ( 2u, loaded.size() );
+    EXPECT_EQ ( 600u, loaded[1][0].size() );
+    EXPECT_EQ ( 0x0100, loaded[0][0][0] );
+
+    for ( const ReplayCreator::RoundDiff& diff : creator.diffFrames ( expanded, loaded ) )
+        EXPECT_FALSE ( diff.differs() ) << creator.formatDiff ( expanded, loaded, diff, 4 );
+}
+
+TEST ( ReplayCreator, DiffFrames )
+{
+    ReplayCreator creator;
+
+    ReplayCreator::FrameReplay a ( 2 ), b;
+    a[0][0].assign ( 1000, 0x0105 );
+    a[0][1].assign ( 1000, 0x0002 );
+    a[1][0].assign ( 10, 0 );
+    b = a;
+
+    b[0][0][40] = 0x0005;
+    b[0][0][999] = 0x0005;
+    b[0][1].resize ( 990 );
+    b.pop_back();
+
+    const vector<ReplayCreator::RoundDiff> diffs = creator.diffFrames ( a, b );
+    ASSERT_EQ ( 2u, diffs.size() );
+
+    EXPECT_EQ ( 40u, diffs[0].firstDiff[0] );
+    EXPECT_EQ ( 2u, diffs[0].numDiffs[0] );
+    EXPECT_EQ ( 990u, diffs[0].firstDiff[1] );
+    EXPECT_EQ ( 10u, diffs[0].numDiffs[1] );
+
+    // Missing round
+    EXPECT_EQ ( 0u, diffs[1].firstDiff[0] );
+    EXPECT_EQ ( 10u, diffs[1].numDiffs[0] );
+    EXPECT_EQ ( UINT_MAX, diffs[1].firstDiff[1] );
+    EXPECT_TRUE ( diffs[1].differs() );
+
+    b = a;
+    EXPECT_FALSE ( creator.diffFrames ( a, b ) [0].differs() );
+}
+
+TEST ( ReplayCreator, RngStateDiff )
+{
+    ReplayCreator creator;
+
+    ReplayCreator::ReplayFile a = makeReplay(), b = makeReplay();
+    uint32_t index = 0;
+
+    ASSERT_TRUE ( creator.findRngStateDiff ( &a, &b, 1, index ) );
+    EXPECT_EQ ( UINT_MAX, index );
+
+    b.rounds[1].rngstates[70] ^= 1;
+    ASSERT_TRUE ( creator.findRngStateDiff ( &a, &b, 1, index ) );
+    EXPECT_EQ ( 70u, index );
+
+    b.rounds[0].rngstates.resize ( 50 );
+    ASSERT_TRUE ( creator.findRngStateDiff ( &a, &b, 0, index ) );
+    EXPECT_EQ ( 50u, index );
+
+    // numRounds claims more rounds than were read
+    b.rounds.pop_back();
+    EXPECT_FALSE ( creator.findRngStateDiff ( &a, &b, 1, index ) );
+    EXPECT_FALSE ( creator.findRngStateDiff ( &a, &b, -1, index ) );
+}
+
+TEST ( ReplayCreator, RawBinaryRoundTrip )
+{
+    const string text = "2\n3\n0010 0000\r\n0100 0a02\r\nffff 0001\r\n0\n";
+
+    ReplayCreator creator;
+    ReplayCreator::RawReplay rounds, loaded;
+    ASSERT_TRUE ( creator.parseRawInputs ( rounds, text.data(), text.size() ) );
+    ASSERT_EQ ( 2u, rounds.size() );
+    EXPECT_EQ ( 0x0a02, rounds[0][1][1] );
+    EXPECT_EQ ( 0xffff, rounds[0][0][2] );
+    EXPECT_TRUE ( rounds[1][0].empty() );
+
+    char file[] = "test_replay.repraw";
+    ASSERT_TRUE ( creator.dumpRaw ( rounds, file ) );
+    ASSERT_TRUE ( creator.loadRawInputs ( loaded, file ) );
+    EXPECT_TRUE ( rounds == loaded );
+
+    // 9 bytes of header, 4 for the rounds, then each round is 4 plus 4 per frame
+    ifstream fin ( file, ios::binary | ios::ate );
+    EXPECT_EQ ( 9 + 4 + ( 4 + 3 * 4 ) + 4, int ( fin.tellg() ) );
+    fin.close();
+
+    remove ( file );
+
+    EXPECT_FALSE ( creator.parseRawInputs ( loaded, text.data(), text.size() - 12 ) );
+}
+
+#endif // NOT RELEASE
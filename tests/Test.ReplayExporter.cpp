@@ -0,0 +1,66 @@
+#ifndef RELEASE
+
+#include "ReplayExporter.hpp"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <iterator>
+#include <cstdio>
+
+using namespace std;
+
+
+static string readFile ( const string& file )
+{
+    ifstream fin ( file.c_str(), ios::binary );
+    return string ( ( istreambuf_iterator<char> ( fin ) ), istreambuf_iterator<char>() );
+}
+
+
+TEST ( ReplayExporter, Export )
+{
+    ReplayCreator creator;
+
+    ReplayCreator::ReplayFile rf = ReplayCreator::ReplayFile();
+    rf.numRounds = 1;
+    rf.rounds.resize ( 1 );
+
+    char repFile[] = "test_export.rep";
+    creator.dump ( rf, repFile );
+
+    ReplayCreator::RawReplay rounds ( 1 ), snapshot;
+    rounds[0][0].assign ( 300, 0x0002 );
+    rounds[0][1].assign ( 300, 0x0100 );
+    snapshot = rounds;
+
+    const string resultsFile = "test_export.csv";
+    remove ( resultsFile.c_str() );
+
+    ReplayExporter exporter;
+    exporter.appendLine ( resultsFile, "a,C-Arc,2" );
+    exporter.exportInputs ( "test_export.repraw", move ( rounds ), repFile, "test_export2.rep" );
+    exporter.appendLine ( resultsFile, "b,H-Ryougi,1" );
+    exporter.appendLine ( resultsFile, "" );
+    exporter.close();
+
+    // An empty line is still appended
+    EXPECT_EQ ( "a,C-Arc,2\nb,H-Ryougi,1\n\n", readFile ( resultsFile ) );
+
+    ReplayCreator::RawReplay loaded;
+    ASSERT_TRUE ( creator.loadRawInputs ( loaded, "test_export.repraw" ) );
+    EXPECT_TRUE ( snapshot == loaded );
+
+    // The fixed replay has the inputs of the snapshot, 300 frames split at the 248 frame limit
+    ReplayCreator::ReplayFile fixed;
+    ASSERT_TRUE ( creator.load ( &fixed, "test_export2.rep" ) );
+    ASSERT_EQ ( 1u, fixed.rounds.size() );
+    ASSERT_EQ ( 2u, fixed.rounds[0].p1Inputs.size() );
+    EXPECT_EQ ( 2, fixed.rounds[0].p1Inputs[0].direction );
+    EXPECT_EQ ( 1, fixed.rounds[0].p2Inputs[0].buttonHold );
+
+    for ( const char *file : { "test_export.rep", "test_export2.rep", "test_export.repraw", resultsFile.c_str() } )
+        remove ( file );
+}
+
+#endif // NOT RELEASE
@@ -0,0 +1,120 @@
+#ifndef RELEASE
+
+#include "ReplayIndex.hpp"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <cstdio>
+
+using namespace std;
+
+
+static const string testRepRaw = "2\n3\n0010 0000\n0010 0000\n0000 0000\n1\n0000 0004\n";
+
+
+TEST ( ReplayIndex, ScanRepRaw )
+{
+    ReplayIndexEntry entry = ReplayIndexEntry();
+
+    ASSERT_TRUE ( ReplayIndex::scan ( "ReplayVS/RyougixV.Sion_260915-201530.repraw",
+                                      testRepRaw.data(), testRepRaw.size(), entry ) );
+
+    EXPECT_EQ ( ReplayIndexEntry::RepRaw, entry.format );
+    EXPECT_EQ ( 2u, entry.numRounds );
+    EXPECT_EQ ( 4u, entry.frames );
+    EXPECT_EQ ( 20260915u, entry.getDate() );
+    EXPECT_EQ ( 30u, entry.second );
+    EXPECT_EQ ( 33u, entry.chara[0] );
+    EXPECT_EQ ( 11u, entry.chara[1] );
+    EXPECT_EQ ( REPLAY_INDEX_ANY, entry.moon[0] );
+
+    // Fewer input lines than frames
+    EXPECT_FALSE ( ReplayIndex::scan ( "a.repraw", testRepRaw.data(), testRepRaw.size() - 10, entry ) );
+    EXPECT_EQ ( ReplayIndexEntry::Invalid, entry.format );
+}
+
+TEST ( ReplayIndex, Query )
+{
+    ReplayIndexEntry entry = ReplayIndexEntry();
+    entry.format = ReplayIndexEntry::Rep;
+    entry.year = 2026;
+    entry.month = 9;
+    entry.day = 15;
+    entry.chara[0] = 1;
+    entry.moon[0] = 0;
+    entry.chara[1] = 33;
+    entry.moon[1] = 2;
+
+    ReplayQuery query;
+    EXPECT_TRUE ( query.matches ( entry ) );
+
+    // Sides are matched either way around
+    ASSERT_TRUE ( ReplayQuery::parseCharacter ( "H-Ryougi", query.chara[0], query.moon[0] ) );
+    ASSERT_TRUE ( ReplayQuery::parseCharacter ( "arc", query.chara[1], query.moon[1] ) );
+    EXPECT_TRUE ( query.matches ( entry ) );
+
+    ASSERT_TRUE ( ReplayQuery::parseCharacter ( "F-Arc", query.chara[1], query.moon[1] ) );
+    EXPECT_FALSE ( query.matches ( entry ) );
+
+    ASSERT_TRUE ( ReplayQuery::parseCharacter ( "C-Arc", query.chara[1], query.moon[1] ) );
+    query.since = 20260901;
+    query.until = 20260930;
+    EXPECT_TRUE ( query.matches ( entry ) );
+
+    query.since = 20260916;
+    EXPECT_FALSE ( query.matches ( entry ) );
+
+    uint8_t chara, moon;
+    EXPECT_FALSE ( ReplayQuery::parseCharacter ( "X-Arc", chara, moon ) );
+    EXPECT_FALSE ( ReplayQuery::parseCharacter ( "Nobody", chara, moon ) );
+}
+
+TEST ( ReplayIndex, Refresh )
+{
+    const vector<string> paths = { "test_index_b_260102-030405.repraw", "test_index_a_260101-030405.repraw" };
+
+    vector<ReplayIndex::FileStat> files;
+
+    for ( const string& path : paths )
+    {
+        ofstream ( path.c_str(), ios::binary ) << testRepRaw;
+        files.push_back ( { path, testRepRaw.size(), 1 } );
+    }
+
+    ReplayIndex index;
+    EXPECT_EQ ( 2u, index.refresh ( files, 2 ) );
+    ASSERT_EQ ( 2u, index.size() );
+
+    // Sorted by path
+    EXPECT_EQ ( paths[1], index.getPath ( 0 ) );
+    EXPECT_EQ ( paths[0], index.getPath ( 1 ) );
+
+    const string indexFile = "test_index.idx";
+    ASSERT_TRUE ( index.save ( indexFile ) );
+
+    ReplayIndex loaded;
+    ASSERT_TRUE ( loaded.load ( indexFile ) );
+    ASSERT_EQ ( 2u, loaded.size() );
+    EXPECT_EQ ( paths[0], loaded.getPath ( 1 ) );
+    EXPECT_EQ ( 20260102u, loaded.getEntry ( 1 ).getDate() );
+
+    // Only the changed file is scanned again, and removed files are dropped
+    files[0].time = 2;
+    files.pop_back();
+    EXPECT_EQ ( 1u, loaded.refresh ( files, 2 ) );
+    ASSERT_EQ ( 1u, loaded.size() );
+    EXPECT_EQ ( 2, loaded.getEntry ( 0 ).fileTime );
+
+    // Newest first
+    const vector<size_t> results = index.query ( ReplayQuery() );
+    ASSERT_EQ ( 2u, results.size() );
+    EXPECT_EQ ( 1u, results[0] );
+
+    for ( const string& path : paths )
+        remove ( path.c_str() );
+
+    remove ( indexFile.c_str() );
+}
+
+#endif // NOT RELEASE
@@ -0,0 +1,133 @@
+#ifndef RELEASE
+
+#include "ReplayKeyframes.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace std;
+
+
+static IndexedFrame indexedFrame ( uint32_t index, uint32_t frame )
+{
+    IndexedFrame indexedFrame = {{ frame, index }};
+    return indexedFrame;
+}
+
+static vector<char> testState ( uint32_t seed )
+{
+    vector<char> state ( 64 * 1024 );
+
+    for ( size_t i = 0; i < state.size(); ++i )
+        state[i] = char ( ( i / 16 ) * seed );
+
+    return state;
+}
+
+
+TEST ( ReplayKeyframes, SaveLoad )
+{
+    ReplayKeyframes keyframes;
+    keyframes.interval = 60;
+
+    EXPECT_TRUE ( keyframes.isDue ( indexedFrame ( 2, 0 ) ) );
+    EXPECT_FALSE ( keyframes.isDue ( indexedFrame ( 2, 59 ) ) );
+
+    for ( uint32_t frame = 0; frame <= 180; frame += 60 )
+    {
+        const vector<char> state = testState ( frame + 1 );
+        keyframes.save ( NetplayState::InGame, 100, indexedFrame ( 2, frame ), &state[0], state.size() );
+    }
+
+    ASSERT_EQ ( 4u, keyframes.size() );
+    EXPECT_FALSE ( keyframes.isDue ( indexedFrame ( 2, 60 ) ) );
+    // All four compress to less than one uncompressed state
+    EXPECT_LT ( keyframes.getCompressedSize(), testState ( 1 ).size() );
+
+    // Nearest keyframe at or before the target
+    const ReplayKeyframes::Keyframe *keyframe = keyframes.find ( indexedFrame ( 2, 150 ) );
+    ASSERT_TRUE ( keyframe != 0 );
+    EXPECT_EQ ( 120u, keyframe->indexedFrame.parts.frame );
+    EXPECT_EQ ( NetplayState::InGame, keyframe->netplayState );
+    EXPECT_EQ ( 100u, keyframe->startWorldTime );
+
+    vector<char> state ( keyframe->size );
+    ASSERT_TRUE ( ReplayKeyframes::load ( *keyframe, &state[0] ) );
+    EXPECT_EQ ( testState ( 121 ), state );
+
+    EXPECT_EQ ( 180u, keyframes.find ( indexedFrame ( 2, 1000 ) )->indexedFrame.parts.frame );
+
+    // Keyframes from other indexes are never used
+    EXPECT_TRUE ( keyframes.find ( indexedFrame ( 3, 0 ) ) == 0 );
+    EXPECT_TRUE ( keyframes.find ( indexedFrame ( 1, 1000 ) ) == 0 );
+}
+
+TEST ( ReplayKeyframes, EraseAfter )
+{
+    ReplayKeyframes keyframes;
+    keyframes.interval = 60;
+
+    const vector<char> state = testState ( 1 );
+
+    for ( uint32_t frame = 0; frame <= 180; frame += 60 )
+        keyframes.save ( NetplayState::InGame, 0, indexedFrame ( 2, frame ), &state[0], state.size() );
+
+    const size_t compressedSize = keyframes.getCompressedSize();
+
+    // Rolling back to frame 100 drops the keyframes after it, so they are due again
+    keyframes.eraseAfter ( indexedFrame ( 2, 100 ) );
+    EXPECT_EQ ( 2u, keyframes.size() );
+    EXPECT_EQ ( compressedSize / 2, keyframes.getCompressedSize() );
+    EXPECT_TRUE ( keyframes.isDue ( indexedFrame ( 2, 120 ) ) );
+    EXPECT_EQ ( 60u, keyframes.find ( indexedFrame ( 2, 150 ) )->indexedFrame.parts.frame );
+
+    // Saving the same frame again replaces it
+    keyframes.save ( NetplayState::InGame, 0, indexedFrame ( 2, 60 ), &state[0], state.size() );
+    EXPECT_EQ ( 2u, keyframes.size() );
+    EXPECT_EQ ( compressedSize / 2, keyframes.getCompressedSize() );
+
+    keyframes.clear();
+    EXPECT_EQ ( 0u, keyframes.size() );
+    EXPECT_EQ ( 0u, keyframes.getCompressedSize() );
+    EXPECT_TRUE ( keyframes.find ( indexedFrame ( 2, 150 ) ) == 0 );
+}
+
+TEST ( ReplayKeyframes, MaxCompressedSize )
+{
+    ReplayKeyframes keyframes;
+    keyframes.interval = 60;
+
+    const vector<char> state = testState ( 1 );
+
+    keyframes.save ( NetplayState::InGame, 0, indexedFrame ( 1, 0 ), &state[0], state.size() );
+    keyframes.save ( NetplayState::InGame, 0, indexedFrame ( 1, 60 ), &state[0], state.size() );
+
+    const size_t compressedSize = keyframes.getCompressedSize() / 2;
+    keyframes.maxCompressedSize = 4 * compressedSize;
+
+    for ( uint32_t frame = 0; frame <= 180; frame += 60 )
+        keyframes.save ( NetplayState::InGame, 0, indexedFrame ( 2, frame ), &state[0], state.size() );
+
+    // The older index is dropped first
+    EXPECT_EQ ( 4u, keyframes.size() );
+    EXPECT_TRUE ( keyframes.find ( indexedFrame ( 1, 60 ) ) == 0 );
+    EXPECT_EQ ( 60u, keyframes.getSpacing() );
+
+    // Then every other keyframe, so the same range is still covered
+    keyframes.save ( NetplayState::InGame, 0, indexedFrame ( 2, 240 ), &state[0], state.size() );
+    ASSERT_EQ ( 3u, keyframes.size() );
+    EXPECT_LE ( keyframes.getCompressedSize(), keyframes.maxCompressedSize );
+    EXPECT_EQ ( 120u, keyframes.getSpacing() );
+    EXPECT_EQ ( 0u, keyframes.find ( indexedFrame ( 2, 100 ) )->indexedFrame.parts.frame );
+    EXPECT_EQ ( 120u, keyframes.find ( indexedFrame ( 2, 200 ) )->indexedFrame.parts.frame );
+    EXPECT_EQ ( 240u, keyframes.find ( indexedFrame ( 2, 300 ) )->indexedFrame.parts.frame );
+
+    EXPECT_FALSE ( keyframes.isDue ( indexedFrame ( 2, 300 ) ) );
+    EXPECT_TRUE ( keyframes.isDue ( indexedFrame ( 2, 360 ) ) );
+
+    keyframes.clear();
+    EXPECT_EQ ( 60u, keyframes.getSpacing() );
+}
+
+#endif // NOT RELEASE
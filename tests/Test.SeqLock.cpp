@@ -0,0 +1,90 @@
+#ifndef RELEASE
+
+#include "SeqLock.hpp"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <atomic>
+
+using namespace std;
+
+
+#define NUM_STORES      ( 200000 )
+
+
+// Every word is written with the same counter, so a torn read would have mismatched words
+struct TestValue
+{
+    uint32_t words[6];
+    uint64_t time;
+};
+
+
+TEST ( SeqLock, StoreLoad )
+{
+    SeqLock<TestValue> seqLock;
+
+    EXPECT_EQ ( 0u, seqLock.getVersion() );
+    EXPECT_EQ ( 0u, seqLock.load().time );
+
+    TestValue value = {{ 1, 2, 3, 4, 5, 6 }, 1234567890123ULL };
+    seqLock.store ( value );
+
+    const TestValue loaded = seqLock.load();
+
+    EXPECT_EQ ( 1u, seqLock.getVersion() );
+    EXPECT_EQ ( value.time, loaded.time );
+
+    for ( size_t i = 0; i < 6; ++i )
+        EXPECT_EQ ( value.words[i], loaded.words[i] );
+}
+
+// A reader racing a writer must never see a torn value, and must see the values in order
+TEST ( SeqLock, Concurrent )
+{
+    SeqLock<TestValue> seqLock;
+    atomic<bool> done ( false );
+
+    thread writer ( [&]
+    {
+        for ( uint32_t i = 1; i <= NUM_STORES; ++i )
+        {
+            TestValue value;
+
+            for ( uint32_t& word : value.words )
+                word = i;
+
+            value.time = i;
+            seqLock.store ( value );
+        }
+
+        done = true;
+    } );
+
+    size_t torn = 0, reads = 0;
+    uint64_t last = 0;
+    bool ordered = true;
+
+    while ( ! done )
+    {
+        const TestValue value = seqLock.load();
+
+        for ( uint32_t word : value.words )
+            if ( word != value.time )
+                ++torn;
+
+        ordered &= ( value.time >= last );
+        last = value.time;
+        ++reads;
+    }
+
+    writer.join();
+
+    EXPECT_EQ ( 0u, torn );
+    EXPECT_TRUE ( ordered );
+    EXPECT_GT ( reads, 0u );
+    EXPECT_EQ ( uint64_t ( NUM_STORES ), seqLock.load().time );
+}
+
+#endif // NOT RELEASE
@@ -0,0 +1,82 @@
+#ifndef RELEASE
+
+#include "Statistics.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+
+#define NUM_SAMPLES     ( 10000 )
+
+
+static double exactQuantile ( vector<double> samples, double q )
+{
+    sort ( samples.begin(), samples.end() );
+    return samples[size_t ( q * ( samples.size() - 1 ) )];
+}
+
+
+TEST ( Statistics, Quantiles )
+{
+    Statistics stats;
+    vector<double> samples;
+
+    srand ( 1234 );
+
+    for ( size_t i = 0; i < NUM_SAMPLES; ++i )
+    {
+        // Mostly low latency with a long tail
+        const double value = 20.0 + ( rand() % 1000 ) / 50.0 + ( rand() % 20 == 0 ? rand() % 300 : 0 );
+        stats.addSample ( value );
+        samples.push_back ( value );
+    }
+
+    for ( double q : { 0.0, 0.5, 0.9, 0.99, 1.0 } )
+    {
+        const double expected = exactQuantile ( samples, q );
+        EXPECT_NEAR ( expected, stats.getQuantile ( q ), expected * QUANTILE_SKETCH_ACCURACY );
+    }
+}
+
+// Merging must give the same results as adding all the samples to one Statistics
+TEST ( Statistics, Merge )
+{
+    Statistics all, first, second;
+
+    srand ( 5678 );
+
+    for ( size_t i = 0; i < NUM_SAMPLES; ++i )
+    {
+        const double value = ( i < NUM_SAMPLES / 4 ? 10 : 100 ) + rand() % 50;
+        all.addSample ( value );
+        ( i < NUM_SAMPLES / 4 ? first : second ).addSample ( value );
+    }
+
+    first.merge ( second );
+
+    EXPECT_EQ ( all.getNumSamples(), first.getNumSamples() );
+    EXPECT_DOUBLE_EQ ( all.getWorst(), first.getWorst() );
+    EXPECT_NEAR ( all.getMean(), first.getMean(), 1e-9 );
+    EXPECT_NEAR ( all.getVariance(), first.getVariance(), 1e-6 );
+
+    for ( double q : { 0.0, 0.25, 0.5, 0.9, 0.99, 1.0 } )
+        EXPECT_DOUBLE_EQ ( all.getQuantile ( q ), first.getQuantile ( q ) );
+}
+
+// A sample far below the others lands in the collapsed lowest bucket
+TEST ( Statistics, CollapsedLowSample )
+{
+    QuantileSketch sketch;
+    sketch.addSample ( 1e7 );
+    sketch.addSample ( 0.002 );
+
+    EXPECT_EQ ( 2u, sketch.getNumSamples() );
+    EXPECT_NEAR ( 1e7, sketch.getQuantile ( 1.0 ), 1e7 * QUANTILE_SKETCH_ACCURACY );
+}
+
+#endif // NOT RELEASE
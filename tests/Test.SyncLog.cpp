@@ -0,0 +1,131 @@
+#ifndef RELEASE
+
+#include "SyncLog.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <cstdio>
+
+using namespace std;
+
+
+static const vector<string> testLines =
+{
+    "In-game [1] NetplayState::InGame [3:120] Inputs: 0x0010 0x0a02",
+    "In-game [1] NetplayState::InGame [3:121] Reinputs: 0x0000 0xffff",
+    "In-game [1] NetplayState::InGame [3:122] Rollback: target=[3:118]; actual=[3:118]",
+    "Character-select [20] NetplayState::CharaSelect [1:0] P1: sel=1; C=3; M=0; c=2; P2: sel=1; C=4; M=1; c=0",
+    "In-game [1] NetplayState::InGame [3:125] Rollback to target=[3:100] failed!",
+    "State desync:",
+    "< [3:125] 00 01 02",
+    "In-game [1] NetplayState::InGame [3:200000] Inputs: 0x1 0x2",
+    "",
+};
+
+
+TEST ( SyncLog, TextRoundTrip )
+{
+    for ( const string& line : testLines )
+        EXPECT_EQ ( line, SyncLogRecord::fromText ( line ).toText() );
+
+    EXPECT_EQ ( SyncLogRecord::Inputs, SyncLogRecord::fromText ( testLines[0] ).type );
+    EXPECT_EQ ( SyncLogRecord::Reinputs, SyncLogRecord::fromText ( testLines[1] ).type );
+    EXPECT_EQ ( SyncLogRecord::Rollback, SyncLogRecord::fromText ( testLines[2] ).type );
+    EXPECT_EQ ( SyncLogRecord::Text, SyncLogRecord::fromText ( testLines[3] ).type );
+    EXPECT_EQ ( SyncLogRecord::Raw, SyncLogRecord::fromText ( testLines[5] ).type );
+
+    // Not the exact text of an Inputs line, so it must be kept as is
+    EXPECT_EQ ( SyncLogRecord::Raw, SyncLogRecord::fromText ( testLines[7] ).type );
+
+    SyncLogRecord record = SyncLogRecord::fromText ( testLines[2] );
+    EXPECT_EQ ( 1u, record.gameMode );
+    EXPECT_EQ ( NetplayState::InGame, record.netplayState.value );
+    EXPECT_EQ ( 3u, record.indexedFrame.parts.index );
+    EXPECT_EQ ( 122u, record.indexedFrame.parts.frame );
+    EXPECT_EQ ( 118u, record.target.parts.frame );
+}
+
+TEST ( SyncLog, RngStateText )
+{
+    SyncLogRecord record ( SyncLogRecord::RngState, 1, NetplayState::InGame, {{ 0, 3 }} );
+
+    for ( size_t i = 0; i < record.rngState.size(); ++i )
+        record.rngState[i] = char ( i * 7 );
+
+    const string line = record.toText();
+
+    // Same size as the RngState hex dump
+    EXPECT_EQ ( 695u, line.size() - line.find ( "RngState: " ) - 10 );
+
+    const SyncLogRecord parsed = SyncLogRecord::fromText ( line );
+    EXPECT_EQ ( SyncLogRecord::RngState, parsed.type );
+    EXPECT_TRUE ( parsed.rngState == record.rngState );
+}
+
+TEST ( SyncLog, BinaryRoundTrip )
+{
+    vector<string> lines = testLines;
+
+    SyncLogRecord rngState ( SyncLogRecord::RngState, 1, NetplayState::InGame, {{ 0, 3 }} );
+    rngState.rngState.fill ( char ( 0xAB ) );
+    lines.push_back ( rngState.toText() );
+
+    const string file = "test_sync.bin";
+
+    SyncLogWriter writer;
+    ASSERT_TRUE ( writer.open ( file ) );
+
+    for ( const string& line : lines )
+        writer.write ( SyncLogRecord::fromText ( line ) );
+
+    writer.close();
+    EXPECT_FALSE ( writer.isOpen() );
+
+    EXPECT_TRUE ( SyncLogReader::isBinary ( file ) );
+
+    SyncLogReader reader;
+    ASSERT_TRUE ( reader.open ( file ) );
+
+    SyncLogRecord record;
+    size_t count = 0;
+
+    for ( ; reader.next ( record ); ++count )
+    {
+        ASSERT_LT ( count, lines.size() );
+        EXPECT_EQ ( lines[count], record.toText() );
+    }
+
+    EXPECT_EQ ( lines.size(), count );
+
+    remove ( file.c_str() );
+}
+
+TEST ( SyncLog, SkipUnknownTypes )
+{
+    string buffer;
+
+    SyncLogRecord ( SyncLogRecord::Inputs, 1, NetplayState::InGame, {{ 5, 3 }} ).encode ( buffer );
+
+    // Size 3, unknown type, 2 bytes of payload
+    buffer += string ( "\x03\x7f\x01\x02", 4 );
+
+    SyncLogRecord ( SyncLogRecord::Reinputs, 1, NetplayState::InGame, {{ 6, 3 }} ).encode ( buffer );
+
+    // Truncated record at the end
+    buffer += string ( "\x10\x01", 2 );
+
+    SyncLogRecord record;
+    size_t pos = 0;
+
+    ASSERT_TRUE ( record.decode ( buffer.data(), buffer.size(), pos ) );
+    EXPECT_EQ ( SyncLogRecord::Inputs, record.type );
+
+    ASSERT_TRUE ( record.decode ( buffer.data(), buffer.size(), pos ) );
+    EXPECT_EQ ( SyncLogRecord::Reinputs, record.type );
+    EXPECT_EQ ( 6u, record.indexedFrame.parts.frame );
+
+    EXPECT_FALSE ( record.decode ( buffer.data(), buffer.size(), pos ) );
+}
+
+#endif // NOT RELEASE
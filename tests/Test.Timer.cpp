@@ -71,4 +71,44 @@ TEST ( Timer, RepeatRandom )
     TimerManager::get().deinitialize();
 }
 
+// Timers started in microseconds must not expire early
+TEST ( Timer, Microseconds )
+{
+    struct TestTimer : public Timer::Owner
+    {
+        Timer timer;
+        uint64_t start = 0, expired = 0;
+
+        void timerExpired ( Timer *timer ) override
+        {
+            expired = TimerManager::get().getNowUs ( true );
+            EventManager::get().stop();
+        }
+
+        TestTimer() : timer ( this )
+        {
+            start = TimerManager::get().getNowUs ( true );
+            timer.startUs ( 2500 );
+        }
+    };
+
+    TimerManager::get().initialize();
+    SocketManager::get().initialize();
+
+    EXPECT_EQ ( TimerManager::get().getNowUs ( true ) / 1000, TimerManager::get().getNow() );
+
+    TestTimer test;
+
+    EXPECT_EQ ( 2u, test.timer.getDelay() );
+    EXPECT_EQ ( 2500u, test.timer.getDelayUs() );
+
+    EventManager::get().start();
+
+    EXPECT_GE ( test.expired, test.start + 2500 );
+    EXPECT_LT ( test.expired, test.start + 1000 * EPSILON_MILLISECONDS );
+
+    SocketManager::get().deinitialize();
+    TimerManager::get().deinitialize();
+}
+
 #endif // NOT RELEASE
@@ -0,0 +1,343 @@
+#include "RollbackAddrs.hpp"
+#include "StateSnapshots.hpp"
+
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+
+// Locates the first diverged frame and the exact diverged bytes between two dumps of rollback states,
+// ie the desync_states_host.bin and desync_states_client.bin files written by each peer when a desync is detected.
+//
+// Each state is split into the regions saved by each MemDump / MemDumpPtr, which are hashed in parallel.
+// The frames common to both files are binary searched for the first frame where any region differs, assuming that
+// once the game state diverges it stays diverged. Pointer values are only compared as null / non-null.
+// Usage: desyncbisect <states A> <states B> [rollback.bin]
+
+
+// Maximum number of bytes of each diverged range to print
+#define MAX_PRINT_BYTES     ( 16 )
+
+
+struct Region
+{
+    // Offset into the saved state
+    size_t offset = 0;
+
+    size_t size = 0;
+
+    // Game address for top level ranges, otherwise 0
+    uint32_t addr = 0;
+
+    // Pointer chain from the top level range, eg [0x00555130]+0x10->[0x4]+0x0
+    string name;
+
+    // Offsets of child pointers inside this region, sorted
+    vector<size_t> ptrOffsets;
+};
+
+struct StatesFile
+{
+    string name;
+
+    FILE *fp = 0;
+
+    StateSnapshotsHeader header;
+
+    vector<uint64_t> frames;
+
+    ~StatesFile() { if ( fp ) fclose ( fp ); }
+
+    bool open ( const string& file )
+    {
+        name = file;
+        fp = fopen ( file.c_str(), "rb" );
+
+        if ( ! fp )
+        {
+            PRINT ( "Failed to open '%s'", file );
+            return false;
+        }
+
+        if ( fread ( &header, sizeof ( header ), 1, fp ) != 1
+                || memcmp ( header.magic, STATE_SNAPSHOTS_MAGIC, sizeof ( header.magic ) ) )
+        {
+            PRINT ( "'%s' is not a states file", file );
+            return false;
+        }
+
+        frames.resize ( header.numStates );
+
+        for ( uint32_t i = 0; i < header.numStates; ++i )
+        {
+            if ( fseek ( fp, offsetOf ( i ), SEEK_SET ) || fread ( &frames[i], sizeof ( frames[i] ), 1, fp ) != 1 )
+            {
+                PRINT ( "'%s' is truncated at state %u", file, i );
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool read ( uint32_t index, vector<char>& state ) const
+    {
+        state.resize ( header.stateSize );
+
+        return ( fseek ( fp, offsetOf ( index ) + sizeof ( uint64_t ), SEEK_SET ) == 0
+                 && fread ( &state[0], header.stateSize, 1, fp ) == 1 );
+    }
+
+private:
+
+    long offsetOf ( uint32_t index ) const
+    {
+        return sizeof ( header ) + long ( index ) * ( sizeof ( uint64_t ) + header.stateSize );
+    }
+};
+
+
+static vector<Region> regions;
+
+
+static string formatFrame ( uint64_t value )
+{
+    const IndexedFrame indexedFrame = { .value = value };
+    return format ( "%u:%u", indexedFrame.parts.index, indexedFrame.parts.frame );
+}
+
+// Flatten the layout into regions, in the same order as MemDumpBase::saveDump
+static void addRegions ( const MemDumpBase& mem, const string& name, uint32_t addr, size_t& offset )
+{
+    Region region;
+    region.offset = offset;
+    region.size = mem.size;
+    region.addr = addr;
+    region.name = name;
+
+    for ( const MemDumpPtr& ptr : mem.ptrs )
+        region.ptrOffsets.push_back ( ptr.srcOffset );
+
+    sort ( region.ptrOffsets.begin(), region.ptrOffsets.end() );
+
+    offset += mem.size;
+    regions.push_back ( region );
+
+    for ( const MemDumpPtr& ptr : mem.ptrs )
+        addRegions ( ptr, format ( "%s->[0x%x]+0x%x", name, ptr.srcOffset, ptr.dstOffset ), 0, offset );
+}
+
+static uint64_t hashRegion ( const Region& region, const char *state )
+{
+    const char *bytes = state + region.offset;
+    size_t offset = 0;
+    StateHasher hash;
+
+    for ( size_t ptrOffset : region.ptrOffsets )
+    {
+        hash.update ( bytes + offset, ptrOffset - offset );
+        hash.update ( uint32_t ( * ( const uint32_t * ) ( bytes + ptrOffset ) != 0 ) );
+        offset = ptrOffset + 4;
+    }
+
+    hash.update ( bytes + offset, region.size - offset );
+    return hash.digest();
+}
+
+// Get the indices of the regions that differ between two states, hashing regions in parallel
+static vector<size_t> diffRegions ( const vector<char>& a, const vector<char>& b )
+{
+    vector<uint8_t> differs ( regions.size(), 0 );
+    atomic<size_t> next ( 0 );
+
+    const auto worker = [&]()
+    {
+        for ( size_t i = next++; i < regions.size(); i = next++ )
+            differs[i] = ( hashRegion ( regions[i], &a[0] ) != hashRegion ( regions[i], &b[0] ) );
+    };
+
+    vector<thread> threads;
+
+    for ( size_t i = 1; i < max ( 1u, thread::hardware_concurrency() ); ++i )
+        threads.emplace_back ( worker );
+
+    worker();
+
+    for ( thread& t : threads )
+        t.join();
+
+    vector<size_t> result;
+
+    for ( size_t i = 0; i < regions.size(); ++i )
+        if ( differs[i] )
+            result.push_back ( i );
+
+    return result;
+}
+
+static void printDiff ( const Region& region, const vector<char>& a, const vector<char>& b )
+{
+    const char *x = &a[region.offset], *y = &b[region.offset];
+
+    const auto differs = [&] ( size_t i )
+    {
+        // Compare pointers as null / non-null
+        for ( size_t ptrOffset : region.ptrOffsets )
+            if ( i >= ptrOffset && i < ptrOffset + 4 )
+                return ( ( * ( const uint32_t * ) ( x + ptrOffset ) != 0 )
+                         != ( * ( const uint32_t * ) ( y + ptrOffset ) != 0 ) );
+
+        return ( x[i] != y[i] );
+    };
+
+    PRINT ( "%s { %u bytes }:", region.name, uint32_t ( region.size ) );
+
+    for ( size_t i = 0; i < region.size; )
+    {
+        if ( ! differs ( i ) )
+        {
+            ++i;
+            continue;
+        }
+
+        size_t end = i + 1;
+        while ( end < region.size && differs ( end ) )
+            ++end;
+
+        const size_t len = min<size_t> ( end - i, MAX_PRINT_BYTES );
+
+        PRINT ( "  +0x%x %s{ %u bytes }: %s | %s%s", uint32_t ( i ),
+                region.addr ? format ( "(0x%08x) ", uint32_t ( region.addr + i ) ) : string(), uint32_t ( end - i ),
+                formatAsHex ( x + i, len ), formatAsHex ( y + i, len ),
+                end - i > len ? " ..." : "" );
+
+        i = end;
+    }
+}
+
+
+int main ( int argc, char *argv[] )
+{
+    if ( argc < 3 )
+    {
+        PRINT ( "Usage: desyncbisect <states A> <states B> [rollback.bin]" );
+        return -1;
+    }
+
+    MemDumpList allAddrs;
+
+    if ( argc > 3 )
+    {
+        if ( ! allAddrs.load ( argv[3] ) )
+        {
+            PRINT ( "Failed to load layout '%s'", argv[3] );
+            return -1;
+        }
+    }
+    else
+    {
+        appendRollbackAddrs ( allAddrs );
+        allAddrs.update();
+    }
+
+    size_t offset = 0;
+
+    for ( const MemDump& mem : allAddrs.addrs )
+        addRegions ( mem, format ( "[0x%08x]", uint32_t ( ( uintptr_t ) mem.addr ) ), uint32_t ( ( uintptr_t ) mem.addr ),
+                     offset );
+
+    StatesFile fileA, fileB;
+
+    if ( ! fileA.open ( argv[1] ) || ! fileB.open ( argv[2] ) )
+        return -1;
+
+    for ( const StatesFile *file : { &fileA, &fileB } )
+    {
+        if ( file->header.stateSize != allAddrs.totalSize )
+        {
+            PRINT ( "'%s' has %u byte states, but the layout is %u bytes",
+                    file->name, file->header.stateSize, uint32_t ( allAddrs.totalSize ) );
+            return -1;
+        }
+    }
+
+    // Pairs of state indices for the frames in both files, states erased by a rollback are missing in each file
+    vector<pair<uint32_t, uint32_t>> common;
+
+    for ( uint32_t i = 0, j = 0; i < fileA.frames.size() && j < fileB.frames.size(); )
+    {
+        if ( fileA.frames[i] < fileB.frames[j] )
+            ++i;
+        else if ( fileB.frames[j] < fileA.frames[i] )
+            ++j;
+        else
+            common.push_back ( { i++, j++ } );
+    }
+
+    PRINT ( "Layout: %u bytes in %u regions; %u common frames out of %u / %u",
+            uint32_t ( allAddrs.totalSize ), uint32_t ( regions.size() ), uint32_t ( common.size() ),
+            uint32_t ( fileA.frames.size() ), uint32_t ( fileB.frames.size() ) );
+
+    if ( common.empty() )
+    {
+        PRINT ( "No common frames" );
+        return -1;
+    }
+
+    vector<char> stateA, stateB;
+
+    const auto diffAt = [&] ( size_t index )
+    {
+        if ( ! fileA.read ( common[index].first, stateA ) || ! fileB.read ( common[index].second, stateB ) )
+        {
+            PRINT ( "Failed to read the states at [%s]", formatFrame ( fileA.frames[common[index].first] ) );
+            exit ( -1 );
+        }
+
+        return diffRegions ( stateA, stateB );
+    };
+
+    if ( diffAt ( common.size() - 1 ).empty() )
+    {
+        PRINT ( "No divergence up to [%s]", formatFrame ( fileA.frames[common.back().first] ) );
+        return 0;
+    }
+
+    // Binary search for the first diverged frame, hi always diverged, lo never diverged
+    size_t lo = 0, hi = common.size() - 1;
+
+    if ( ! diffAt ( 0 ).empty() )
+    {
+        PRINT ( "Already diverged at the first common frame" );
+        hi = 0;
+    }
+
+    while ( hi > lo + 1 )
+    {
+        const size_t mid = ( lo + hi ) / 2;
+
+        if ( diffAt ( mid ).empty() )
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    if ( hi > 0 )
+        PRINT ( "Last matching frame: [%s]", formatFrame ( fileA.frames[common[lo].first] ) );
+
+    const vector<size_t> diverged = diffAt ( hi );
+
+    PRINT ( "First diverged frame: [%s]; %u regions differ", formatFrame ( fileA.frames[common[hi].first] ),
+            uint32_t ( diverged.size() ) );
+
+    for ( size_t i : diverged )
+        printDiff ( regions[i], stateA, stateB );
+
+    return 0;
+}
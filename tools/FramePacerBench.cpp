@@ -0,0 +1,113 @@
+#include "FramePacer.hpp"
+#include "StringUtils.hpp"
+
+#include <chrono>
+#include <thread>
+#include <ctime>
+#include <cstdlib>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+
+using namespace std;
+
+
+// Benchmarks the frame pacer with the real OS clock and sleep, to compare the frame timing and CPU usage against
+// a pure busy-wait. This runs the same pacing algorithm as the game, only the clock is different.
+// Usage: framepacerbench [fps] [frames]
+
+
+// Monotonic clock that sleeps with the OS scheduler
+struct SleepClock : public FramePacer::Clock
+{
+    uint64_t getNow() override
+    {
+        return chrono::duration_cast<chrono::microseconds> ( chrono::steady_clock::now().time_since_epoch() ).count();
+    }
+
+    void sleep ( uint64_t microseconds ) override
+    {
+        this_thread::sleep_for ( chrono::microseconds ( microseconds ) );
+    }
+};
+
+// Monotonic clock that never sleeps, so the pacer spins the whole frame
+struct SpinClock : public SleepClock
+{
+    void sleep ( uint64_t microseconds ) override {}
+};
+
+
+// Mean and percentiles of the samples
+static void printSamples ( const char *name, vector<double>& samples )
+{
+    if ( samples.empty() )
+        return;
+
+    sort ( samples.begin(), samples.end() );
+
+    const double mean = accumulate ( samples.begin(), samples.end(), 0.0 ) / samples.size();
+    const auto percentile = [&] ( double p ) { return samples[size_t ( p * ( samples.size() - 1 ) )]; };
+
+    PRINT ( "  %s: mean=%.1f us; p50=%.0f us; p99=%.0f us; worst=%.0f us",
+            name, mean, percentile ( 0.5 ), percentile ( 0.99 ), samples.back() );
+}
+
+static void runBench ( const char *name, FramePacer::Clock& clock, double fps, uint32_t frames )
+{
+    FramePacer pacer ( clock );
+    pacer.setFps ( fps );
+
+    // The first wait starts the schedule
+    pacer.wait();
+
+    vector<double> intervals, jitter;
+    intervals.reserve ( frames );
+    jitter.reserve ( frames );
+
+    const uint64_t start = clock.getNow();
+    const clock_t cpuStart = std::clock();
+
+    for ( uint32_t i = 0; i < frames; ++i )
+    {
+        pacer.wait();
+
+        if ( pacer.getLastInterval() )
+        {
+            intervals.push_back ( double ( pacer.getLastInterval() ) );
+            jitter.push_back ( double ( pacer.getLastJitter() ) );
+        }
+    }
+
+    const double elapsed = ( clock.getNow() - start ) / 1e6;
+    const double cpu = double ( std::clock() - cpuStart ) / CLOCKS_PER_SEC;
+
+    PRINT ( "%s: %.3f fps; cpu=%.1f%%; spin margin=%llu us",
+            name, frames / elapsed, 100 * cpu / elapsed, ( unsigned long long ) pacer.getSpinMargin() );
+
+    printSamples ( "interval", intervals );
+    printSamples ( "jitter", jitter );
+}
+
+
+int main ( int argc, char *argv[] )
+{
+    const double fps = ( argc > 1 ? atof ( argv[1] ) : 60.0 );
+    const uint32_t frames = ( argc > 2 ? uint32_t ( atoi ( argv[2] ) ) : 600 );
+
+    if ( fps <= 0 || frames == 0 )
+    {
+        PRINT ( "Usage: framepacerbench [fps] [frames]" );
+        return -1;
+    }
+
+    PRINT ( "Pacing %u frames at %.3f fps", frames, fps );
+
+    SleepClock sleepClock;
+    runBench ( "sleep+spin", sleepClock, fps, frames );
+
+    SpinClock spinClock;
+    runBench ( "spin", spinClock, fps, frames );
+
+    return 0;
+}
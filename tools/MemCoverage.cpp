@@ -0,0 +1,296 @@
+#include "RollbackAddrs.hpp"
+#include "StateSnapshots.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <emmintrin.h>
+
+#include <thread>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+
+// Checks the coverage of the rollback address list against raw game memory captured over consecutive frames,
+// ie the memory_capture.bin file written by DllMemoryCapture (Ctrl+F10 in a debug build).
+//
+// Every pair of consecutive frames is diffed with SSE2 over multiple threads, counting the number of times each
+// byte changed. Then this reports the ranges that change but aren't saved by any top level MemDump, which may cause
+// desyncs, and the saved ranges that never change, which may be dropped to make states cheaper. Only the top level
+// ranges can be checked, since the objects behind MemDumpPtrs aren't captured.
+// Usage: memcoverage <memory_capture.bin> [rollback.bin]
+
+
+// Uncovered changed bytes closer than this are reported as one range
+#define MERGE_GAP           ( 8 )
+
+// Minimum size of a covered range that never changes to report
+#define MIN_UNCHANGED_SIZE  ( 16 )
+
+// Number of bytes diffed per SSE2 compare
+#define VECTOR_SIZE         ( 16 )
+
+
+struct RawCapture
+{
+    RawSnapshotsHeader header;
+
+    vector<RawSnapshotsRange> ranges;
+
+    const char *frames = 0;
+
+    size_t numFrames = 0;
+
+    size_t mappedSize = 0;
+
+    ~RawCapture() { if ( mappedSize ) munmap ( ( void * ) mappedData, mappedSize ); }
+
+    bool open ( const string& file )
+    {
+        const int fd = ::open ( file.c_str(), O_RDONLY );
+
+        if ( fd < 0 )
+        {
+            PRINT ( "Failed to open '%s'", file );
+            return false;
+        }
+
+        struct stat st;
+        fstat ( fd, &st );
+        mappedSize = st.st_size;
+        mappedData = ( const char * ) mmap ( 0, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0 );
+        close ( fd );
+
+        if ( mappedData == MAP_FAILED )
+        {
+            PRINT ( "Failed to map '%s'", file );
+            mappedSize = 0;
+            return false;
+        }
+
+        memcpy ( &header, mappedData, min ( sizeof ( header ), mappedSize ) );
+
+        if ( mappedSize < sizeof ( header ) || memcmp ( header.magic, RAW_SNAPSHOTS_MAGIC, sizeof ( header.magic ) ) )
+        {
+            PRINT ( "'%s' is not a raw memory capture", file );
+            return false;
+        }
+
+        const size_t rangesEnd = sizeof ( header ) + header.numRanges * sizeof ( RawSnapshotsRange );
+
+        if ( mappedSize < rangesEnd )
+        {
+            PRINT ( "'%s' is truncated", file );
+            return false;
+        }
+
+        ranges.resize ( header.numRanges );
+        memcpy ( &ranges[0], mappedData + sizeof ( header ), header.numRanges * sizeof ( RawSnapshotsRange ) );
+
+        frames = mappedData + rangesEnd;
+        numFrames = ( mappedSize - rangesEnd ) / getRecordSize();
+        return true;
+    }
+
+    size_t getRecordSize() const { return sizeof ( uint64_t ) + header.frameSize; }
+
+    const char *getFrame ( size_t i ) const { return frames + i * getRecordSize() + sizeof ( uint64_t ); }
+
+private:
+
+    const char *mappedData = 0;
+};
+
+
+// Count how many times each byte in [begin, end) changed between consecutive frames
+static void countChanges ( const RawCapture& capture, size_t begin, size_t end, uint32_t *counts )
+{
+    for ( size_t f = 1; f < capture.numFrames; ++f )
+    {
+        const char *prev = capture.getFrame ( f - 1 );
+        const char *curr = capture.getFrame ( f );
+
+        size_t i = begin;
+
+        for ( ; i + VECTOR_SIZE <= end; i += VECTOR_SIZE )
+        {
+            const __m128i a = _mm_loadu_si128 ( ( const __m128i * ) ( prev + i ) );
+            const __m128i b = _mm_loadu_si128 ( ( const __m128i * ) ( curr + i ) );
+
+            uint32_t mask = ~_mm_movemask_epi8 ( _mm_cmpeq_epi8 ( a, b ) ) & 0xFFFF;
+
+            for ( ; mask; mask &= mask - 1 )
+                ++counts[i + __builtin_ctz ( mask )];
+        }
+
+        for ( ; i < end; ++i )
+            counts[i] += ( prev[i] != curr[i] );
+    }
+}
+
+static void printRange ( const char *prefix, uint32_t addr, size_t size, const char *suffix = "" )
+{
+    PRINT ( "%s{ 0x%08x, 0x%08x } %u bytes%s", prefix, addr, uint32_t ( addr + size ), uint32_t ( size ), suffix );
+}
+
+
+int main ( int argc, char *argv[] )
+{
+    if ( argc < 2 )
+    {
+        PRINT ( "Usage: memcoverage <memory_capture.bin> [rollback.bin]" );
+        return -1;
+    }
+
+    MemDumpList allAddrs;
+
+    if ( argc > 2 )
+    {
+        if ( ! allAddrs.load ( argv[2] ) )
+        {
+            PRINT ( "Failed to load layout '%s'", argv[2] );
+            return -1;
+        }
+    }
+    else
+    {
+        appendRollbackAddrs ( allAddrs );
+        allAddrs.update();
+    }
+
+    RawCapture capture;
+
+    if ( ! capture.open ( argv[1] ) )
+        return -1;
+
+    PRINT ( "Capture: %u frames of %u bytes in %u ranges",
+            uint32_t ( capture.numFrames ), capture.header.frameSize, capture.header.numRanges );
+
+    if ( capture.numFrames < 2 )
+    {
+        PRINT ( "Need at least 2 frames" );
+        return -1;
+    }
+
+    const size_t frameSize = capture.header.frameSize;
+
+    vector<uint32_t> counts ( frameSize, 0 );
+
+    // Split the frame into vector aligned chunks, so each thread owns its own counts
+    const size_t numThreads = max ( 1u, thread::hardware_concurrency() );
+    const size_t chunkSize = ( ( frameSize / numThreads ) + VECTOR_SIZE ) & ~size_t ( VECTOR_SIZE - 1 );
+
+    vector<thread> threads;
+
+    for ( size_t begin = 0; begin < frameSize; begin += chunkSize )
+        threads.emplace_back ( countChanges, cref ( capture ), begin, min ( begin + chunkSize, frameSize ), &counts[0] );
+
+    for ( thread& t : threads )
+        t.join();
+
+    // Mark the bytes covered by top level MemDumps, as offsets into the frame
+    vector<uint8_t> covered ( frameSize, 0 );
+    size_t coveredSize = 0, outside = 0;
+
+    for ( const MemDump& mem : allAddrs.addrs )
+    {
+        const uint32_t addr = ( uint32_t ) ( uintptr_t ) mem.addr;
+        size_t offset = 0;
+        bool found = false;
+
+        for ( const RawSnapshotsRange& range : capture.ranges )
+        {
+            if ( addr >= range.addr && addr + mem.size <= range.addr + range.size )
+            {
+                fill_n ( &covered[offset + addr - range.addr], mem.size, 1 );
+                coveredSize += mem.size;
+                found = true;
+                break;
+            }
+
+            offset += range.size;
+        }
+
+        if ( ! found )
+            ++outside;
+    }
+
+    PRINT ( "Layout: %u ranges; %u bytes captured; %u ranges outside the capture",
+            uint32_t ( allAddrs.addrs.size() ), uint32_t ( coveredSize ), uint32_t ( outside ) );
+
+    size_t offset = 0, uncoveredTotal = 0, unchangedTotal = 0;
+
+    PRINT ( "\nChanged but not covered:" );
+
+    for ( const RawSnapshotsRange& range : capture.ranges )
+    {
+        for ( size_t i = 0; i < range.size; )
+        {
+            if ( covered[offset + i] || ! counts[offset + i] )
+            {
+                ++i;
+                continue;
+            }
+
+            // Extend the range across small gaps of unchanged bytes
+            size_t end = i + 1, last = i;
+            uint32_t maxCount = counts[offset + i];
+
+            for ( ; end < range.size && end <= last + MERGE_GAP && ! covered[offset + end]; ++end )
+            {
+                if ( counts[offset + end] )
+                {
+                    last = end;
+                    maxCount = max ( maxCount, counts[offset + end] );
+                }
+            }
+
+            printRange ( "  ", range.addr + i, last + 1 - i,
+                         format ( "; changed %u / %u frames", maxCount, capture.numFrames - 1 ).c_str() );
+
+            uncoveredTotal += last + 1 - i;
+            i = last + 1;
+        }
+
+        offset += range.size;
+    }
+
+    PRINT ( "\nCovered but never changed:" );
+
+    offset = 0;
+
+    for ( const RawSnapshotsRange& range : capture.ranges )
+    {
+        for ( size_t i = 0; i < range.size; )
+        {
+            if ( ! covered[offset + i] || counts[offset + i] )
+            {
+                ++i;
+                continue;
+            }
+
+            size_t end = i + 1;
+            while ( end < range.size && covered[offset + end] && ! counts[offset + end] )
+                ++end;
+
+            if ( end - i >= MIN_UNCHANGED_SIZE )
+            {
+                printRange ( "  ", range.addr + i, end - i );
+                unchangedTotal += end - i;
+            }
+
+            i = end;
+        }
+
+        offset += range.size;
+    }
+
+    PRINT ( "\nTotal: %u bytes changed but not covered; %u bytes covered but never changed",
+            uint32_t ( uncoveredTotal ), uint32_t ( unchangedTotal ) );
+
+    return 0;
+}
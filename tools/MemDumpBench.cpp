@@ -0,0 +1,534 @@
+#include "RollbackAddrs.hpp"
+#include "Compression.hpp"
+
+#include <sys/mman.h>
+
+#include <chrono>
+#include <random>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+
+// Native benchmark and round-trip test for MemDump / MemDumpList, using the real rollback layout.
+//
+// The game's fixed addresses are mapped as anonymous memory at the same locations, and every MemDumpPtr is pointed
+// at a block in a synthetic heap that is also 32 bit addressable, so the exact same code paths run as in the game.
+// Usage: memdumpbench [iterations]
+
+
+#define LAYOUT_FILE         "memdumpbench.bin"
+
+// Synthetic heap for the objects referenced by MemDumpPtrs
+#define HEAP_ADDR           ( 0x20000000 )
+#define HEAP_SIZE           ( 64 * 1024 * 1024 )
+
+#define ARENA_ALIGN         ( 0x1000 )
+
+// Same number of states as the release build's rollback memory pool
+#define NUM_BENCH_STATES    ( 60 )
+
+#define DEFAULT_ITERATIONS  ( 1000 )
+
+
+struct Arena
+{
+    char *start = 0;
+
+    size_t size = 0;
+
+    // Bytes saved by the layout, and bytes that hold pointers
+    vector<uint8_t> covered, slots;
+
+    // Bump allocator offset
+    size_t used = 0;
+
+    bool map ( uintptr_t addr, size_t len )
+    {
+        addr &= ~uintptr_t ( ARENA_ALIGN - 1 );
+        len = ( len + ARENA_ALIGN - 1 ) & ~size_t ( ARENA_ALIGN - 1 );
+
+        void *ptr = mmap ( ( void * ) addr, len, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0 );
+
+        if ( ptr == MAP_FAILED || ptr != ( void * ) addr )
+        {
+            PRINT ( "Failed to map 0x%08x bytes at 0x%08x", uint32_t ( len ), uint32_t ( addr ) );
+            return false;
+        }
+
+        start = ( char * ) ptr;
+        size = len;
+        covered.assign ( size, 0 );
+        slots.assign ( size, 0 );
+        return true;
+    }
+
+    bool contains ( const char *addr, size_t len ) const
+    {
+        return ( addr >= start && addr + len <= start + size );
+    }
+
+    char *alloc ( size_t len )
+    {
+        const size_t offset = ( used + 15 ) & ~size_t ( 15 );
+
+        if ( offset + len > size )
+            return 0;
+
+        used = offset + len;
+        return start + offset;
+    }
+};
+
+static Arena global, heap;
+
+static vector<uint32_t *> ptrSlots;
+
+// Non-null pointers in the global arena, and the size of the heap block each one points to
+struct RootPtr { uint32_t *slot; size_t len; };
+static vector<RootPtr> rootPtrs;
+
+static mt19937 rng ( 12345 );
+
+
+static Arena *findArena ( const char *addr, size_t len )
+{
+    if ( global.contains ( addr, len ) )
+        return &global;
+
+    if ( heap.contains ( addr, len ) )
+        return &heap;
+
+    return 0;
+}
+
+static void randomize ( Arena& arena, bool skipSlots )
+{
+    for ( size_t i = 0; i < arena.size; ++i )
+        if ( ! skipSlots || ! arena.slots[i] )
+            arena.start[i] = char ( rng() );
+}
+
+// Point every MemDumpPtr at a new heap block, or leave it null like an unused game object
+static bool linkPtrs ( const MemDumpBase& mem )
+{
+    char *addr = mem.getAddr();
+
+    if ( ! addr )
+        return true;
+
+    for ( const MemDumpPtr& ptr : mem.ptrs )
+    {
+        uint32_t *slot = ( uint32_t * ) ( addr + ptr.srcOffset );
+        Arena *arena = findArena ( ( char * ) slot, 4 );
+
+        if ( ! arena )
+        {
+            PRINT ( "Pointer at 0x%08x is outside the mapped memory", uint32_t ( ( uintptr_t ) slot ) );
+            return false;
+        }
+
+        fill_n ( &arena->slots[ ( char * ) slot - arena->start ], 4, 1 );
+        ptrSlots.push_back ( slot );
+
+        if ( rng() % 8 == 0 )
+        {
+            *slot = 0;
+            continue;
+        }
+
+        char *block = heap.alloc ( ptr.dstOffset + ptr.size );
+
+        if ( ! block )
+        {
+            PRINT ( "Synthetic heap is full" );
+            return false;
+        }
+
+        *slot = uint32_t ( ( uintptr_t ) block );
+
+        if ( arena == &global )
+            rootPtrs.push_back ( { slot, ptr.dstOffset + ptr.size } );
+
+        if ( ! linkPtrs ( ptr ) )
+            return false;
+    }
+
+    return true;
+}
+
+static bool markCovered ( const MemDumpBase& mem )
+{
+    char *addr = mem.getAddr();
+
+    if ( ! addr )
+        return true;
+
+    Arena *arena = findArena ( addr, mem.size );
+
+    if ( ! arena )
+    {
+        PRINT ( "Range { 0x%08x, %u bytes } is outside the mapped memory",
+                uint32_t ( ( uintptr_t ) addr ), uint32_t ( mem.size ) );
+        return false;
+    }
+
+    fill_n ( &arena->covered[addr - arena->start], mem.size, 1 );
+
+    for ( const MemDumpPtr& ptr : mem.ptrs )
+        if ( ! markCovered ( ptr ) )
+            return false;
+
+    return true;
+}
+
+static size_t saveAll ( const MemDumpList& list, char *state )
+{
+    char *dump = state;
+
+    for ( const MemDump& mem : list.addrs )
+        mem.saveDump ( dump );
+
+    return dump - state;
+}
+
+static size_t saveAll ( const MemDumpList& list, char *state, uint64_t& digest )
+{
+    char *dump = state;
+    StateHasher hash;
+
+    for ( const MemDump& mem : list.addrs )
+        mem.saveDump ( dump, hash );
+
+    digest = hash.digest();
+    return dump - state;
+}
+
+static size_t loadAll ( const MemDumpList& list, const char *state )
+{
+    const char *dump = state;
+
+    for ( const MemDump& mem : list.addrs )
+        mem.loadDump ( dump );
+
+    return dump - state;
+}
+
+static bool samePtrs ( const vector<MemDumpPtr>& a, const vector<MemDumpPtr>& b )
+{
+    if ( a.size() != b.size() )
+        return false;
+
+    for ( size_t i = 0; i < a.size(); ++i )
+    {
+        if ( a[i].srcOffset != b[i].srcOffset || a[i].dstOffset != b[i].dstOffset || a[i].size != b[i].size )
+            return false;
+
+        if ( ! samePtrs ( a[i].ptrs, b[i].ptrs ) )
+            return false;
+    }
+
+    return true;
+}
+
+static bool checkSerialization ( const MemDumpList& allAddrs )
+{
+    if ( ! allAddrs.save ( LAYOUT_FILE ) )
+    {
+        PRINT ( "Failed to save '%s'", LAYOUT_FILE );
+        return false;
+    }
+
+    MemDumpList loaded;
+
+    if ( ! loaded.load ( LAYOUT_FILE ) )
+    {
+        PRINT ( "Failed to load '%s'", LAYOUT_FILE );
+        return false;
+    }
+
+    if ( loaded.totalSize != allAddrs.totalSize || loaded.addrs.size() != allAddrs.addrs.size() )
+    {
+        PRINT ( "Loaded layout has %u bytes in %u ranges, expected %u bytes in %u ranges",
+                uint32_t ( loaded.totalSize ), uint32_t ( loaded.addrs.size() ),
+                uint32_t ( allAddrs.totalSize ), uint32_t ( allAddrs.addrs.size() ) );
+        return false;
+    }
+
+    for ( size_t i = 0; i < loaded.addrs.size(); ++i )
+    {
+        const MemDump& a = allAddrs.addrs[i];
+        const MemDump& b = loaded.addrs[i];
+
+        if ( a.addr != b.addr || a.size != b.size || a.getTotalSize() != b.getTotalSize() || ! samePtrs ( a.ptrs, b.ptrs ) )
+        {
+            PRINT ( "Loaded range %u doesn't match { 0x%08x, %u bytes }",
+                    uint32_t ( i ), uint32_t ( ( uintptr_t ) a.addr ), uint32_t ( a.size ) );
+            return false;
+        }
+    }
+
+    ifstream fin ( LAYOUT_FILE, ifstream::binary );
+    string data ( ( istreambuf_iterator<char> ( fin ) ), istreambuf_iterator<char>() );
+
+    char md5[16];
+    getMD5 ( data, md5 );
+
+    PRINT ( "Layout file: %u bytes; md5=%s", uint32_t ( data.size() ), formatAsHex ( md5, sizeof ( md5 ) ) );
+
+    // A corrupted file must be rejected
+    data[data.size() / 2] ^= 0x5A;
+
+    if ( loaded.load ( &data[0], data.size() ) || ! loaded.empty() )
+    {
+        PRINT ( "Corrupted layout file was not rejected" );
+        return false;
+    }
+
+    return true;
+}
+
+static bool checkRoundTrip ( const MemDumpList& allAddrs )
+{
+    vector<char> stateA ( allAddrs.totalSize ), stateB ( allAddrs.totalSize );
+
+    const vector<char> global0 ( global.start, global.start + global.size );
+    const vector<char> heap0 ( heap.start, heap.start + heap.used );
+
+    if ( saveAll ( allAddrs, &stateA[0] ) != allAddrs.totalSize )
+    {
+        PRINT ( "saveDump didn't write totalSize bytes" );
+        return false;
+    }
+
+    // Simulate a few frames of the game changing everything, including pointers becoming null
+    randomize ( global, true );
+    randomize ( heap, true );
+
+    for ( uint32_t *slot : ptrSlots )
+        if ( rng() % 4 == 0 )
+            *slot = 0;
+
+    const vector<char> global1 ( global.start, global.start + global.size );
+    const vector<char> heap1 ( heap.start, heap.start + heap.used );
+
+    if ( loadAll ( allAddrs, &stateA[0] ) != allAddrs.totalSize )
+    {
+        PRINT ( "loadDump didn't read totalSize bytes" );
+        return false;
+    }
+
+    // Covered bytes must be restored, everything else must be untouched
+    const auto verify = [] ( const Arena& arena, size_t len, const vector<char>& before, const vector<char>& after )
+    {
+        for ( size_t i = 0; i < len; ++i )
+        {
+            if ( arena.start[i] != ( arena.covered[i] ? before[i] : after[i] ) )
+            {
+                PRINT ( "Mismatch at 0x%08x (%s)", uint32_t ( ( uintptr_t ) ( arena.start + i ) ),
+                        arena.covered[i] ? "not restored" : "clobbered" );
+                return false;
+            }
+        }
+        return true;
+    };
+
+    if ( ! verify ( global, global.size, global0, global1 ) || ! verify ( heap, heap.used, heap0, heap1 ) )
+        return false;
+
+    saveAll ( allAddrs, &stateB[0] );
+
+    if ( stateA != stateB )
+    {
+        PRINT ( "Re-saved state doesn't match the original state" );
+        return false;
+    }
+
+    return true;
+}
+
+static bool checkStateHash ( const MemDumpList& allAddrs )
+{
+    vector<char> stateA ( allAddrs.totalSize ), stateB ( allAddrs.totalSize );
+    uint64_t digestA, digestB;
+
+    saveAll ( allAddrs, &stateA[0] );
+
+    if ( saveAll ( allAddrs, &stateB[0], digestA ) != allAddrs.totalSize || stateA != stateB )
+    {
+        PRINT ( "Hashed saveDump doesn't match the plain saveDump" );
+        return false;
+    }
+
+    // The digest must not depend on how the bytes are split between updates
+    StateHasher whole, pieces;
+    whole.update ( &stateA[0], stateA.size() );
+
+    for ( size_t i = 0, n = 1; i < stateA.size(); i += n, n = n * 3 % 97 + 1 )
+        pieces.update ( &stateA[i], min ( n, stateA.size() - i ) );
+
+    if ( whole.digest() != pieces.digest() )
+    {
+        PRINT ( "StateHasher depends on the update sizes" );
+        return false;
+    }
+
+    // Flipping any covered byte that isn't a pointer must change the digest
+    size_t index = 0;
+    while ( ! global.covered[index] || global.slots[index] )
+        ++index;
+
+    global.start[index] ^= 1;
+    saveAll ( allAddrs, &stateB[0], digestB );
+    global.start[index] ^= 1;
+
+    if ( digestA == digestB )
+    {
+        PRINT ( "StateHasher didn't change after modifying 0x%08x", uint32_t ( ( uintptr_t ) ( global.start + index ) ) );
+        return false;
+    }
+
+    // Pointer values are only hashed as null / non-null, so moving a heap block doesn't change the digest
+    auto it = find_if ( rootPtrs.begin(), rootPtrs.end(), [] ( const RootPtr& p ) { return *p.slot != 0; } );
+
+    if ( it != rootPtrs.end() )
+    {
+        uint32_t *slot = it->slot;
+        const uint32_t value = *slot;
+        char *block = heap.alloc ( it->len );
+
+        if ( ! block )
+        {
+            PRINT ( "Synthetic heap is full" );
+            return false;
+        }
+
+        memcpy ( block, ( char * ) ( uintptr_t ) value, it->len );
+        *slot = uint32_t ( ( uintptr_t ) block );
+        saveAll ( allAddrs, &stateB[0], digestB );
+        *slot = value;
+
+        if ( digestA != digestB )
+        {
+            PRINT ( "StateHasher changed after moving the pointer at 0x%08x", uint32_t ( ( uintptr_t ) slot ) );
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void printTimings ( const char *name, vector<double>& micros, size_t bytes )
+{
+    sort ( micros.begin(), micros.end() );
+
+    double total = 0;
+    for ( double us : micros )
+        total += us;
+
+    const double mean = total / micros.size();
+
+    PRINT ( "%s: mean=%.1fus; min=%.1fus; p50=%.1fus; p99=%.1fus; max=%.1fus; %.0f MB/s", name, mean, micros.front(),
+            micros[micros.size() / 2], micros[micros.size() * 99 / 100], micros.back(), bytes / mean );
+}
+
+static void benchmark ( const MemDumpList& allAddrs, size_t iterations )
+{
+    vector<char> pool ( NUM_BENCH_STATES * allAddrs.totalSize );
+    vector<double> saves, hashedSaves, loads;
+    saves.reserve ( iterations );
+    hashedSaves.reserve ( iterations );
+    loads.reserve ( iterations );
+    uint64_t digest;
+
+    for ( size_t i = 0; i < NUM_BENCH_STATES; ++i )
+        saveAll ( allAddrs, &pool[i * allAddrs.totalSize] );
+
+    // Save every iteration, and load an older state like a rollback would
+    for ( size_t i = 0; i < iterations; ++i )
+    {
+        char *saveState = &pool[ ( i % NUM_BENCH_STATES ) * allAddrs.totalSize ];
+        const char *loadState = &pool[ ( ( i * 7 ) % NUM_BENCH_STATES ) * allAddrs.totalSize ];
+
+        auto start = chrono::steady_clock::now();
+        saveAll ( allAddrs, saveState );
+        auto end = chrono::steady_clock::now();
+        saves.push_back ( chrono::duration<double, micro> ( end - start ).count() );
+
+        start = chrono::steady_clock::now();
+        saveAll ( allAddrs, saveState, digest );
+        end = chrono::steady_clock::now();
+        hashedSaves.push_back ( chrono::duration<double, micro> ( end - start ).count() );
+
+        start = chrono::steady_clock::now();
+        loadAll ( allAddrs, loadState );
+        end = chrono::steady_clock::now();
+        loads.push_back ( chrono::duration<double, micro> ( end - start ).count() );
+    }
+
+    printTimings ( "saveDump", saves, allAddrs.totalSize );
+    printTimings ( "saveDump+hash", hashedSaves, allAddrs.totalSize );
+    printTimings ( "loadDump", loads, allAddrs.totalSize );
+}
+
+
+int main ( int argc, char *argv[] )
+{
+    const size_t iterations = ( argc > 1 ? max ( 1, atoi ( argv[1] ) ) : DEFAULT_ITERATIONS );
+
+    MemDumpList allAddrs;
+    appendRollbackAddrs ( allAddrs );
+    allAddrs.update();
+
+    size_t numPtrs = 0;
+    for ( const MemDump& mem : allAddrs.addrs )
+        numPtrs += mem.ptrs.size();
+
+    PRINT ( "Layout: %u bytes in %u ranges with %u pointers",
+            uint32_t ( allAddrs.totalSize ), uint32_t ( allAddrs.addrs.size() ), uint32_t ( numPtrs ) );
+
+    const uintptr_t start = ( uintptr_t ) allAddrs.addrs.front().addr;
+    const uintptr_t end = ( uintptr_t ) allAddrs.addrs.back().addr + allAddrs.addrs.back().size;
+
+    if ( ! global.map ( start, end - ( start & ~uintptr_t ( ARENA_ALIGN - 1 ) ) ) || ! heap.map ( HEAP_ADDR, HEAP_SIZE ) )
+        return -1;
+
+    randomize ( global, false );
+    randomize ( heap, false );
+
+    for ( const MemDump& mem : allAddrs.addrs )
+        if ( ! linkPtrs ( mem ) )
+            return -1;
+
+    for ( const MemDump& mem : allAddrs.addrs )
+        if ( ! markCovered ( mem ) )
+            return -1;
+
+    PRINT ( "Synthetic heap: %u bytes", uint32_t ( heap.used ) );
+
+    bool passed = true;
+
+    if ( checkSerialization ( allAddrs ) )
+        PRINT ( "Serialization: OK" );
+    else
+        passed = false;
+
+    if ( checkRoundTrip ( allAddrs ) )
+        PRINT ( "Round-trip: OK" );
+    else
+        passed = false;
+
+    if ( checkStateHash ( allAddrs ) )
+        PRINT ( "State hash: OK" );
+    else
+        passed = false;
+
+    benchmark ( allAddrs, iterations );
+
+    return ( passed ? 0 : -1 );
+}
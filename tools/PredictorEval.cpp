@@ -0,0 +1,188 @@
+#include "InputPredictor.hpp"
+#include "ReplayCreator.hpp"
+#include "StringUtils.hpp"
+
+#include <memory>
+#include <cstdio>
+#include <climits>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+
+// Compares the remote input predictors offline, by replaying the raw inputs exported with each replay (.repraw).
+//
+// Each player of each round is treated as the remote player, with the remote inputs arriving a fixed number of frames
+// late. Predictions are kept per frame like in the game, so a rollback only happens when a confirmed input differs
+// from the input the frame was run with. This reports the misprediction rate and the rollbacks each predictor causes.
+// Usage: predictoreval <.repraw files...>
+
+
+// Number of frames the remote inputs arrive late, ie the frames of rollback needed to hide the latency
+static const uint32_t evalDelays[] = { 1, 2, 4, 6, 8 };
+
+// Short names of each PredictorType, as accepted by InputPredictor::parseType
+static const char *predictorNames[] = { "", "hold", "release", "learned" };
+
+// Frames per minute for the reported rates
+#define FRAMES_PER_MINUTE   ( 60 * 60 )
+
+
+struct EvalResult
+{
+    // Number of frames run for the first time
+    size_t frames = 0;
+
+    // Number of frames that were run with a predicted input, and how many of those were wrong
+    size_t predicted = 0, mispredicted = 0;
+
+    // Number of rollbacks, the total number of frames re-run, and the deepest rollback
+    size_t rollbacks = 0, rerunFrames = 0, maxDepth = 0;
+};
+
+
+// Load the inputs of each in-game index, as rounds -> frame -> { P1, P2 }
+static bool loadRaw ( const string& file, vector<vector<pair<uint16_t, uint16_t>>>& rounds )
+{
+    ReplayCreator::RawReplay raw;
+
+    if ( ! ReplayCreator().loadRawInputs ( raw, file.c_str() ) )
+    {
+        PRINT ( "Failed to read '%s'", file );
+        return false;
+    }
+
+    for ( const auto& round : raw )
+    {
+        rounds.emplace_back();
+        rounds.back().reserve ( round[0].size() );
+
+        for ( size_t j = 0; j < round[0].size() && j < round[1].size(); ++j )
+            rounds.back().push_back ( { round[0][j], round[1][j] } );
+    }
+
+    return true;
+}
+
+static void simulate ( const vector<uint16_t>& inputs, InputPredictor& predictor, uint32_t delay, EvalResult& result )
+{
+    // The input each frame was last run with, ie the confirmed input or the stored prediction
+    vector<uint16_t> used;
+    used.reserve ( inputs.size() );
+
+    uint32_t confirmed = 0;
+
+    predictor.reset();
+
+    for ( uint32_t frame = 0; frame < inputs.size(); ++frame )
+    {
+        // The input of each frame arrives when running the frame delay frames after it
+        const uint32_t arrived = ( frame + 1 > delay ? frame + 1 - delay : 0 );
+        uint32_t changed = UINT_MAX;
+
+        // Check the newly confirmed inputs against the inputs those frames were run with
+        for ( ; confirmed < arrived; ++confirmed )
+        {
+            if ( confirmed < used.size() )
+            {
+                ++result.predicted;
+
+                if ( used[confirmed] != inputs[confirmed] )
+                {
+                    ++result.mispredicted;
+                    changed = min ( changed, confirmed );
+                }
+            }
+
+            predictor.observe ( inputs[confirmed] );
+        }
+
+        if ( changed != UINT_MAX )
+        {
+            const size_t depth = frame - changed;
+
+            ++result.rollbacks;
+            result.rerunFrames += depth;
+            result.maxDepth = max ( result.maxDepth, depth );
+
+            // The frames after the confirmed inputs are re-run with new predictions
+            used.resize ( confirmed );
+        }
+
+        // Keep the known inputs, and predict the frames that don't have a stored prediction yet
+        for ( uint32_t i = used.size(); i < confirmed; ++i )
+            used.push_back ( inputs[i] );
+
+        for ( uint32_t i = used.size(); i <= frame; ++i )
+            used.push_back ( predictor.predict ( i + 1 - confirmed ) );
+
+        ++result.frames;
+    }
+}
+
+
+int main ( int argc, char *argv[] )
+{
+    if ( argc < 2 )
+    {
+        PRINT ( "Usage: predictoreval <.repraw files...>" );
+        return -1;
+    }
+
+    vector<vector<pair<uint16_t, uint16_t>>> rounds;
+
+    for ( int i = 1; i < argc; ++i )
+        if ( ! loadRaw ( argv[i], rounds ) )
+            return -1;
+
+    size_t totalFrames = 0;
+    for ( const auto& round : rounds )
+        totalFrames += round.size();
+
+    PRINT ( "Loaded %u rounds, %u frames", uint32_t ( rounds.size() ), uint32_t ( totalFrames ) );
+
+    // Split the rounds into the input sequence of each player
+    vector<vector<uint16_t>> sequences;
+
+    for ( const auto& round : rounds )
+    {
+        sequences.emplace_back();
+        sequences.emplace_back();
+
+        for ( const auto& inputs : round )
+        {
+            sequences[sequences.size() - 2].push_back ( inputs.first );
+            sequences[sequences.size() - 1].push_back ( inputs.second );
+        }
+    }
+
+    for ( uint32_t delay : evalDelays )
+    {
+        PRINT ( "\n%u frames late:", delay );
+        PRINT ( "  %-14s %12s %14s %12s %10s", "predictor", "mispredicted", "rollbacks/min", "avg depth", "max depth" );
+
+        for ( uint8_t type = PredictorType::HoldLast; type <= PredictorType::Learned; ++type )
+        {
+            const PredictorType predictorType = ( PredictorType::Enum ) type;
+
+            // Each player has its own predictor, which keeps learning across rounds like in the game
+            unique_ptr<InputPredictor> predictors[2];
+            predictors[0].reset ( InputPredictor::create ( predictorType ) );
+            predictors[1].reset ( InputPredictor::create ( predictorType ) );
+
+            EvalResult result;
+
+            for ( size_t i = 0; i < sequences.size(); ++i )
+                simulate ( sequences[i], *predictors[i % 2], delay, result );
+
+            PRINT ( "  %-14s %11.2f%% %14.1f %12.2f %10u", predictorNames[type],
+                    100.0 * result.mispredicted / max<size_t> ( 1, result.predicted ),
+                    double ( result.rollbacks ) * FRAMES_PER_MINUTE / max<size_t> ( 1, result.frames ),
+                    double ( result.rerunFrames ) / max<size_t> ( 1, result.rollbacks ),
+                    uint32_t ( result.maxDepth ) );
+        }
+    }
+
+    return 0;
+}
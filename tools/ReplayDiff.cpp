@@ -0,0 +1,209 @@
+#include "ReplayCreator.hpp"
+#include "StringUtils.hpp"
+
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <climits>
+
+using namespace std;
+
+
+// Diffs the per frame inputs of pairs of replays, either .rep files written by the game or .repraw exports.
+//
+// The run length inputs of .rep files are expanded to one entry per frame, and the raw inputs of .repraw files are
+// converted to the same directions and held buttons, then every round is diffed with SIMD compares. The RNG states
+// are also compared when both replays are .rep files. Pairs are diffed in parallel, and the summary mode prints one
+// line per pair, otherwise the frames around the first difference are shown.
+// Usage: replaydiff [--summary] [--context N] <a> <b> [<a> <b>]...
+//        replaydiff [--summary] [--context N] --pairs <file with two paths per line>
+
+
+struct DiffPair
+{
+    string a, b;
+
+    // Output for the pair, and if the replays differ or couldn't be read
+    string output;
+    bool differs = false;
+};
+
+static double elapsedMs ( chrono::steady_clock::time_point start )
+{
+    return chrono::duration<double, milli> ( chrono::steady_clock::now() - start ).count();
+}
+
+static bool isRaw ( const string& file )
+{
+    return ( file.size() > 7 && file.compare ( file.size() - 7, 7, ".repraw" ) == 0 );
+}
+
+static bool loadFrames ( const string& file, ReplayCreator::FrameReplay& frames, ReplayCreator::ReplayFile& rf )
+{
+    ReplayCreator creator;
+
+    if ( isRaw ( file ) )
+        return creator.loadRaw ( frames, file.c_str() );
+
+    if ( ! creator.load ( &rf, file.c_str() ) )
+        return false;
+
+    creator.expandReplay ( &rf, frames );
+    return true;
+}
+
+static void diffPair ( DiffPair& pair, bool summary, int context )
+{
+    ReplayCreator creator;
+    ReplayCreator::FrameReplay framesA, framesB;
+    ReplayCreator::ReplayFile rfA, rfB;
+
+    if ( ! loadFrames ( pair.a, framesA, rfA ) || ! loadFrames ( pair.b, framesB, rfB ) )
+    {
+        pair.output = format ( "ERROR %s %s: failed to read\n", pair.a, pair.b );
+        pair.differs = true;
+        return;
+    }
+
+    const vector<ReplayCreator::RoundDiff> diffs = creator.diffFrames ( framesA, framesB );
+
+    string details;
+
+    for ( const ReplayCreator::RoundDiff& diff : diffs )
+    {
+        if ( ! diff.differs() )
+            continue;
+
+        if ( ! pair.differs )
+        {
+            const int p = ( diff.firstDiff[0] <= diff.firstDiff[1] ? 0 : 1 );
+
+            pair.output = format ( "DIFF %s %s: round %d p%d frame %u, %u + %u frames differ\n", pair.a, pair.b,
+                                   diff.round, p + 1, diff.firstDiff[p], diff.numDiffs[0], diff.numDiffs[1] );
+        }
+
+        pair.differs = true;
+
+        if ( ! summary )
+            details += creator.formatDiff ( framesA, framesB, diff, context );
+    }
+
+    // RNG states are only in .rep files
+    if ( ! isRaw ( pair.a ) && ! isRaw ( pair.b ) )
+    {
+        for ( int r = 0; r < min ( rfA.numRounds, rfB.numRounds ); ++r )
+        {
+            uint32_t i;
+
+            if ( ! creator.findRngStateDiff ( &rfA, &rfB, r, i ) )
+            {
+                if ( ! pair.differs )
+                    pair.output = format ( "DIFF %s %s: round %d is missing\n", pair.a, pair.b, r );
+
+                pair.differs = true;
+                break;
+            }
+
+            if ( i == UINT_MAX )
+                continue;
+
+            if ( ! pair.differs )
+                pair.output = format ( "DIFF %s %s: round %d RNG state %u\n", pair.a, pair.b, r, i );
+
+            pair.differs = true;
+
+            if ( ! summary )
+                details += format ( "round %d: RNG state %u differs\n", r, i );
+        }
+    }
+
+    if ( ! pair.differs )
+        pair.output = format ( "OK %s %s\n", pair.a, pair.b );
+
+    pair.output += details;
+}
+
+int main ( int argc, char *argv[] )
+{
+    bool summary = false;
+    int context = 8;
+    vector<string> files;
+
+    for ( int i = 1; i < argc; ++i )
+    {
+        const string arg = argv[i];
+
+        if ( arg == "--summary" )
+        {
+            summary = true;
+        }
+        else if ( arg == "--context" && i + 1 < argc )
+        {
+            context = max ( 0, atoi ( argv[++i] ) );
+        }
+        else if ( arg == "--pairs" && i + 1 < argc )
+        {
+            ifstream fin ( argv[++i] );
+            string a, b;
+
+            while ( fin >> a >> b )
+            {
+                files.push_back ( a );
+                files.push_back ( b );
+            }
+        }
+        else
+        {
+            files.push_back ( arg );
+        }
+    }
+
+    if ( files.empty() || files.size() % 2 )
+    {
+        PRINT ( "Usage: replaydiff [--summary] [--context N] <a> <b> [<a> <b>]...\n"
+                "       replaydiff [--summary] [--context N] --pairs <file with two paths per line>" );
+        return 1;
+    }
+
+    const auto start = chrono::steady_clock::now();
+
+    vector<DiffPair> pairs ( files.size() / 2 );
+
+    for ( size_t i = 0; i < pairs.size(); ++i )
+    {
+        pairs[i].a = files[2 * i];
+        pairs[i].b = files[2 * i + 1];
+    }
+
+    atomic<size_t> next ( 0 );
+
+    const auto worker = [&]()
+    {
+        for ( size_t i = next++; i < pairs.size(); i = next++ )
+            diffPair ( pairs[i], summary, context );
+    };
+
+    vector<thread> threads;
+
+    for ( size_t i = 1; i < min ( size_t ( max ( 1u, thread::hardware_concurrency() ) ), pairs.size() ); ++i )
+        threads.emplace_back ( worker );
+
+    worker();
+
+    for ( thread& t : threads )
+        t.join();
+
+    size_t numDiffs = 0;
+
+    for ( const DiffPair& pair : pairs )
+    {
+        if ( pair.differs || ! summary )
+            fwrite ( pair.output.data(), 1, pair.output.size(), stdout );
+
+        numDiffs += pair.differs;
+    }
+
+    PRINT ( "%u of %u pairs differ, in %.1f ms", uint32_t ( numDiffs ), uint32_t ( pairs.size() ), elapsedMs ( start ) );
+    return ( numDiffs ? 2 : 0 );
+}
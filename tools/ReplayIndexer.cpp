@@ -0,0 +1,190 @@
+#include "ReplayIndex.hpp"
+#include "CharacterSelect.hpp"
+#include "StringUtils.hpp"
+
+#include <filesystem>
+#include <chrono>
+#include <thread>
+#include <ctime>
+#include <cstring>
+
+using namespace std;
+
+
+// Indexes folders of replays (.rep and .repraw) and queries the index.
+//
+// Each --scan folder is searched recursively, and only the replays that are new or changed since the index was last
+// saved are scanned again. Replays that no longer exist are dropped, so every indexed folder must be passed each time
+// the index is refreshed. Without --scan the saved index is queried as is.
+// Usage: replayindexer <index> [--scan <folder>]... [--threads N]
+//                      [--chara [M-]Name] [--vs [M-]Name] [--stage N] [--since yyyy-mm-dd] [--until yyyy-mm-dd]
+//                      [--days N]
+// eg: replayindexer replays.idx --scan ReplayVS --chara H-Ryougi --vs C-Arc --days 30
+
+
+static double elapsedMs ( chrono::steady_clock::time_point start )
+{
+    return chrono::duration<double, milli> ( chrono::steady_clock::now() - start ).count();
+}
+
+static bool parseDate ( const char *str, uint32_t& date )
+{
+    uint32_t year, month, day;
+
+    if ( sscanf ( str, "%u-%u-%u", &year, &month, &day ) != 3 )
+        return false;
+
+    date = year * 10000 + month * 100 + day;
+    return true;
+}
+
+static void listReplays ( const string& folder, vector<ReplayIndex::FileStat>& files )
+{
+    error_code error;
+
+    for ( filesystem::recursive_directory_iterator it ( folder, error ), end; ! error && it != end; it.increment ( error ) )
+    {
+        const string ext = it->path().extension().string();
+
+        if ( ! it->is_regular_file() || ( ext != ".rep" && ext != ".repraw" ) )
+            continue;
+
+        files.push_back ( { it->path().string(), uint64_t ( it->file_size() ),
+                            int64_t ( it->last_write_time().time_since_epoch().count() ) } );
+    }
+
+    if ( error )
+        PRINT ( "Failed to list '%s': %s", folder, error.message() );
+}
+
+static string playerStr ( const ReplayIndexEntry& entry, size_t player )
+{
+    static const char *moons[] = { "C-", "F-", "H-" };
+
+    string str = ( entry.moon[player] < 3 ? moons[entry.moon[player]] : "" );
+
+    if ( entry.chara[player] == REPLAY_INDEX_ANY )
+        return str + "?";
+
+    return str + getShortCharaName ( entry.chara[player] );
+}
+
+int main ( int argc, char *argv[] )
+{
+    if ( argc < 2 )
+    {
+        PRINT ( "Usage: replayindexer <index> [--scan <folder>]... [--threads N] [--chara [M-]Name] [--vs [M-]Name] "
+                "[--stage N] [--since yyyy-mm-dd] [--until yyyy-mm-dd] [--days N]" );
+        return 1;
+    }
+
+    const string indexFile = argv[1];
+
+    vector<string> folders;
+    size_t numThreads = max ( 1u, thread::hardware_concurrency() );
+    ReplayQuery query;
+    bool hasQuery = false;
+
+    for ( int i = 2; i < argc; ++i )
+    {
+        const string arg = argv[i];
+        const char *value = ( i + 1 < argc ? argv[i + 1] : "" );
+        bool valid = ( i + 1 < argc );
+
+        if ( arg == "--scan" )
+        {
+            folders.push_back ( value );
+        }
+        else if ( arg == "--threads" )
+        {
+            numThreads = max ( 1, atoi ( value ) );
+        }
+        else if ( arg == "--chara" || arg == "--vs" )
+        {
+            const size_t side = ( arg == "--vs" ? 1 : 0 );
+            valid = valid && ReplayQuery::parseCharacter ( value, query.chara[side], query.moon[side] );
+        }
+        else if ( arg == "--stage" )
+        {
+            query.stage = atoi ( value );
+        }
+        else if ( arg == "--since" )
+        {
+            valid = valid && parseDate ( value, query.since );
+        }
+        else if ( arg == "--until" )
+        {
+            valid = valid && parseDate ( value, query.until );
+        }
+        else if ( arg == "--days" )
+        {
+            const time_t since = time ( 0 ) - time_t ( atoi ( value ) ) * 24 * 60 * 60;
+            const tm *date = localtime ( &since );
+            query.since = ( date->tm_year + 1900 ) * 10000 + ( date->tm_mon + 1 ) * 100 + date->tm_mday;
+        }
+        else
+        {
+            valid = false;
+        }
+
+        if ( ! valid )
+        {
+            PRINT ( "Invalid argument: %s %s", arg, value );
+            return 1;
+        }
+
+        hasQuery = hasQuery || ( arg != "--scan" && arg != "--threads" );
+        ++i;
+    }
+
+    ReplayIndex index;
+
+    auto start = chrono::steady_clock::now();
+
+    if ( index.load ( indexFile ) )
+        PRINT ( "Loaded %u replays in %.2f ms", uint32_t ( index.size() ), elapsedMs ( start ) );
+
+    if ( ! folders.empty() )
+    {
+        start = chrono::steady_clock::now();
+
+        vector<ReplayIndex::FileStat> files;
+
+        for ( const string& folder : folders )
+            listReplays ( folder, files );
+
+        const size_t scanned = index.refresh ( files, numThreads );
+
+        PRINT ( "Indexed %u replays, scanned %u new or changed, in %.1f ms",
+                uint32_t ( index.size() ), uint32_t ( scanned ), elapsedMs ( start ) );
+
+        if ( ! index.save ( indexFile ) )
+        {
+            PRINT ( "Failed to save '%s'", indexFile );
+            return 1;
+        }
+    }
+
+    if ( ! hasQuery )
+        return 0;
+
+    start = chrono::steady_clock::now();
+
+    const vector<size_t> results = index.query ( query );
+
+    const double queryMs = elapsedMs ( start );
+
+    for ( size_t i : results )
+    {
+        const ReplayIndexEntry& entry = index.getEntry ( i );
+        const uint32_t seconds = entry.frames / 60;
+
+        PRINT ( "%04u-%02u-%02u %02u:%02u  %-10s vs %-10s  %u rounds  %2u:%02u  %s",
+                entry.year, entry.month, entry.day, entry.hour, entry.minute,
+                playerStr ( entry, 0 ), playerStr ( entry, 1 ), entry.numRounds, seconds / 60, seconds % 60,
+                index.getPath ( i ) );
+    }
+
+    PRINT ( "%u matches in %.2f ms", uint32_t ( results.size() ), queryMs );
+    return 0;
+}
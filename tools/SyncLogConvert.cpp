@@ -0,0 +1,113 @@
+#include "SyncLog.hpp"
+#include "StringUtils.hpp"
+
+#include <fstream>
+#include <chrono>
+
+using namespace std;
+
+
+// Converts a sync log between the binary and text formats, the direction is detected from the input file.
+// Text lines that don't have a typed record are kept as is, so text -> binary -> text gives back the same lines.
+// Usage: synclogconvert <input> <output>
+
+
+static double elapsedMs ( chrono::steady_clock::time_point start )
+{
+    return chrono::duration<double, milli> ( chrono::steady_clock::now() - start ).count();
+}
+
+static bool binaryToText ( const string& input, const string& output )
+{
+    const auto start = chrono::steady_clock::now();
+
+    SyncLogReader reader;
+
+    if ( ! reader.open ( input ) )
+    {
+        PRINT ( "Failed to read '%s'", input );
+        return false;
+    }
+
+    FILE *fp = fopen ( output.c_str(), "w" );
+
+    if ( ! fp )
+    {
+        PRINT ( "Failed to open '%s'", output );
+        return false;
+    }
+
+    SyncLogRecord record;
+    size_t count = 0;
+
+    for ( ; reader.next ( record ); ++count )
+    {
+        const string line = record.toText();
+        fwrite ( line.c_str(), 1, line.size(), fp );
+        fputc ( '\n', fp );
+    }
+
+    fclose ( fp );
+
+    PRINT ( "Converted %u records to text in %.1f ms", uint32_t ( count ), elapsedMs ( start ) );
+    return true;
+}
+
+static bool textToBinary ( const string& input, const string& output )
+{
+    const auto start = chrono::steady_clock::now();
+
+    ifstream fin ( input.c_str() );
+
+    if ( ! fin.good() )
+    {
+        PRINT ( "Failed to read '%s'", input );
+        return false;
+    }
+
+    SyncLogWriter writer;
+
+    if ( ! writer.open ( output ) )
+    {
+        PRINT ( "Failed to open '%s'", output );
+        return false;
+    }
+
+    string line;
+    size_t count = 0, typed = 0;
+
+    while ( getline ( fin, line ) )
+    {
+        // The Logger writes Windows line endings
+        if ( ! line.empty() && line.back() == '\r' )
+            line.pop_back();
+
+        const SyncLogRecord record = SyncLogRecord::fromText ( line );
+
+        if ( record.type != SyncLogRecord::Raw && record.type != SyncLogRecord::Text )
+            ++typed;
+
+        writer.write ( record );
+        ++count;
+    }
+
+    writer.close();
+
+    PRINT ( "Converted %u lines (%u typed) to binary in %.1f ms", uint32_t ( count ), uint32_t ( typed ),
+            elapsedMs ( start ) );
+    return true;
+}
+
+int main ( int argc, char *argv[] )
+{
+    if ( argc != 3 )
+    {
+        PRINT ( "Usage: synclogconvert <input> <output>" );
+        return 1;
+    }
+
+    if ( SyncLogReader::isBinary ( argv[1] ) )
+        return binaryToText ( argv[1], argv[2] ) ? 0 : 1;
+
+    return textToBinary ( argv[1], argv[2] ) ? 0 : 1;
+}